@@ -20,11 +20,14 @@
 #include <format>
 #include <signal.h>
 #include <future>
+#include <optional>
 // Networking libraries.
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
 #include <fcntl.h>
 // Data, configuration, and logging.
@@ -43,11 +46,23 @@
 // Database.
 #include <hiredis/hiredis.h>
 #include <hiredis/async.h>
+// Memory accounting.
+#include "nsb_checksum.h"
+#include "nsb_memory.h"
 
 #define SERVER_CONNECTION_TIMEOUT 10
 #define DAEMON_RESPONSE_TIMEOUT 30
 #define RECEIVE_BUFFER_SIZE 4096
 #define SEND_BUFFER_SIZE 4096
+#define MAX_DATAGRAM_SIZE 65507
+#define RECONNECT_INITIAL_BACKOFF_MS 10
+#define RECONNECT_MAX_BACKOFF_MS 1000
+// Server addresses with this prefix name a Unix domain socket (e.g., of nsb_proxy).
+#define LOCAL_ADDRESS_PREFIX "unix:"
+// Not all platforms can suppress SIGPIPE per call.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 
 namespace nsb {
 
@@ -80,6 +95,12 @@ namespace nsb {
             }
     };
 
+    /** @brief The address and port of a Redis instance used to store payloads. */
+    struct DBShard {
+        std::string address;
+        int port;
+    };
+
     /**
      * @brief Configuration parameters struct.
      * 
@@ -114,10 +135,43 @@ namespace nsb {
         std::string DB_ADDRESS;
         int DB_PORT;
         int DB_NUM;
+        /**
+         * @brief The Redis instances payloads are spread across, if more than 
+         * one is configured.
+         * 
+         * When empty, payloads are only stored at DB_ADDRESS:DB_PORT. 
+         * Otherwise, DB_ADDRESS:DB_PORT is the first shard.
+         * 
+         * @see RedisConnector
+         */
+        std::vector<DBShard> DB_SHARDS;
+        /**
+         * @brief Whether or not small messages may be carried over the 
+         * datagram (UDP) channel.
+         * 
+         * Messages that serialize to at most DGRAM_MAX_SIZE bytes are sent as 
+         * single datagrams to the daemon's DGRAM_PORT, avoiding head-of-line 
+         * blocking behind other messages on the stream channels. Larger 
+         * messages always use the stream channels.
+         */
+        bool USE_DGRAM;
+        int DGRAM_PORT;
+        int DGRAM_MAX_SIZE;
+        /**
+         * @brief Whether or not payloads carry a CRC32C checksum.
+         * 
+         * The checksum is computed by the client that sends or posts a 
+         * payload and verified by the client that fetches or receives it, 
+         * which discards payloads that fail the check.
+         * 
+         * @see crc32c()
+         */
+        bool USE_CHECKSUM;
 
         /**  @brief Blank constructor for a new Config object. */
         Config() : SYSTEM_MODE(SystemMode::PULL), SIMULATOR_MODE(SimulatorMode::SYSTEM_WIDE),
-                   USE_DB(false), DB_ADDRESS(""), DB_PORT(0), DB_NUM(0) {}
+                   USE_DB(false), DB_ADDRESS(""), DB_PORT(0), DB_NUM(0),
+                   USE_DGRAM(false), DGRAM_PORT(0), DGRAM_MAX_SIZE(0), USE_CHECKSUM(false) {}
         /** @brief Constructor for a new Config object using NSB message. */
         Config(nsb::nsbm msg) {
             nsb::nsbm::ConfigParams cfg = msg.config();
@@ -128,7 +182,21 @@ namespace nsb {
                 DB_ADDRESS = cfg.db_address();
                 DB_PORT = cfg.db_port();
                 DB_NUM = cfg.db_num();
+                for (const nsb::nsbm::ConfigParams::DBShard& shard : cfg.db_shards()) {
+                    DB_SHARDS.push_back({shard.address(), shard.port()});
+                }
+            }
+            USE_DGRAM = cfg.use_dgram();
+            DGRAM_PORT = USE_DGRAM ? cfg.dgram_port() : 0;
+            DGRAM_MAX_SIZE = USE_DGRAM ? cfg.dgram_max_size() : 0;
+            USE_CHECKSUM = cfg.use_checksum();
+        }
+        /** @brief Gets every Redis instance payloads may be stored in. */
+        std::vector<DBShard> dbShards() const {
+            if (DB_SHARDS.empty()) {
+                return {{DB_ADDRESS, DB_PORT}};
             }
+            return DB_SHARDS;
         }
     };
     /**
@@ -148,6 +216,18 @@ namespace nsb {
         std::string payload_obj;
         /** @brief The size of the payload. */
         int payload_size;
+        /** @brief When the entry was placed in a buffer (set by the daemon). */
+        std::chrono::steady_clock::time_point timestamp;
+        /**
+         * @brief The database key the payload is still stored under, if any.
+         * 
+         * Set by clients that retain fetched payloads in the database.
+         * 
+         * @see NSBSimClient::setRetainPayloads()
+         */
+        std::string payload_key;
+        /** @brief The CRC32C of the payload, if integrity checks are enabled. */
+        std::optional<uint32_t> checksum;
         // Constructors.
         /** @brief Blank constructor. */
         MessageEntry() : source(""), destination(""), payload_obj(""), payload_size(0) {}
@@ -182,8 +262,10 @@ namespace nsb {
         enum class Channel {
             CTRL = 0,
             SEND = 1,
-            RECV = 2
+            RECV = 2,
+            DGRAM = 3
         };
+        /** @brief The stream channels that every client connects. */
         const std::vector<Channel> Channels = {Channel::CTRL, Channel::SEND, Channel::RECV};
         /**
          * @brief Helper function to get channel name with enumerated value.
@@ -198,7 +280,8 @@ namespace nsb {
         const std::map<Channel, std::string> ChannelName = {
             {Channel::CTRL, "CTRL"},
             {Channel::SEND, "SEND"},
-            {Channel::RECV, "RECV"}
+            {Channel::RECV, "RECV"},
+            {Channel::DGRAM, "DGRAM"}
         };
     };
 
@@ -217,10 +300,14 @@ namespace nsb {
          * @brief Constructor for a new SocketInterface object.
          * 
          * Sets the address and port of the server at the NSB daemon before 
-         * connecting to it.
+         * connecting to it. If the daemon cannot be reached, the interface is 
+         * left disconnected (see isConnected()) so that the caller can retry 
+         * with reconnect().
          * 
-         * @param server_address 
-         * @param server_port
+         * @param server_address The daemon's IPv4 address, or LOCAL_ADDRESS_PREFIX
+         *                       followed by the path of a local proxy's Unix 
+         *                       domain socket.
+         * @param server_port The daemon's port (unused for a local proxy).
          * 
          * @see SocketInterface::connectToServer()
          */
@@ -236,7 +323,9 @@ namespace nsb {
          * port.
          * 
          * This method configures and connects sockets for each of the client's 
-         * channels and then attempts to connect to the daemon.
+         * channels and then attempts to connect to the daemon. Failed attempts 
+         * are retried with exponential backoff, starting at 
+         * RECONNECT_INITIAL_BACKOFF_MS and capped at RECONNECT_MAX_BACKOFF_MS.
          * 
          * @param timeout Maximum time in seconds to wait to connect to the 
          *                daemon.
@@ -249,6 +338,52 @@ namespace nsb {
          * Attempts to shutdown the socket, then closes it.
          */
         void closeConnection();
+        /**
+         * @brief Closes any remaining sockets and connects to the daemon again.
+         * 
+         * @param timeout Maximum time in seconds to wait to connect to the 
+         *                daemon.
+         * @return int Returns 0 if connection was successful, else -1.
+         */
+        int reconnect(int timeout);
+        /**
+         * @brief Checks whether the stream channels are connected.
+         * 
+         * The interface is marked as disconnected when it fails to connect, 
+         * when the daemon closes a channel, or when sending on a channel fails.
+         * 
+         * @return bool True if all stream channels are believed to be connected.
+         */
+        bool isConnected() const { return connected; }
+        /** @brief Whether or not the server is reached over a Unix domain socket. */
+        bool isLocal() const { return serverAddress.rfind(LOCAL_ADDRESS_PREFIX, 0) == 0; }
+        /**
+         * @brief Gets the identifier of a channel connected over a Unix domain 
+         * socket.
+         * 
+         * Local channels are bound to abstract addresses of five hex digits 
+         * chosen by the kernel, which the client advertises in place of port 
+         * numbers and the proxy sees as their peer addresses.
+         * 
+         * @param address The channel's address.
+         * @param length The length of the address.
+         * @return int The identifier, or -1 if the address is not abstract.
+         */
+        static int localChannelId(const sockaddr_un& address, socklen_t length);
+        /**
+         * @brief Gets the socket file descriptor of a channel.
+         * 
+         * This allows external event loops to wait on a channel's socket 
+         * alongside their own descriptors instead of blocking in 
+         * receiveMessage().
+         * 
+         * @param channel The channel whose socket to get.
+         * @return int The file descriptor, or -1 if the channel is not open.
+         */
+        int getFd(Comms::Channel channel) const {
+            auto it = conns.find(channel);
+            return it == conns.end() ? -1 : it->second;
+        }
         /**
          * @brief Sends a message to the server.
          * 
@@ -285,10 +420,34 @@ namespace nsb {
          * @return std::future<std::string> 
          */
         std::future<std::string> listenForMessage(Comms::Channel channel, int* timeout);
+        /**
+         * @brief Opens the datagram channel on an ephemeral local port.
+         * 
+         * The socket is bound but not yet connected, so that its port can be 
+         * advertised to the daemon during initialization.
+         * 
+         * @return int The local port of the datagram channel, else -1.
+         */
+        int openDatagram();
+        /**
+         * @brief Connects the datagram channel to the daemon's datagram port.
+         * 
+         * Once connected, the DGRAM channel can be used with sendMessage(), and
+         * receiveMessage() on the RECV channel will also pick up datagrams.
+         * 
+         * @param port The daemon's datagram port.
+         * @return int Returns 0 if successful, else -1.
+         */
+        int connectDatagram(int port);
+        /**
+         * @brief Closes the datagram channel if it is open.
+         */
+        void closeDatagram();
         std::map<Channel, int> conns;
     private:
         std::string serverAddress;
         int serverPort;
+        bool connected;
     };
 
     /**
@@ -335,6 +494,9 @@ namespace nsb {
         }
     };
 
+    /** @brief Virtual nodes placed on the hash ring for each Redis shard. */
+    const int DB_SHARD_VNODES = 64;
+
     /**
      * @brief Connector for offloading payloads to a Redis database.
      * 
@@ -343,6 +505,15 @@ namespace nsb {
      * payloads over sockets. Using this option may be beneficial for 
      * applications with larger payloads (>32KB). Database can be configured in 
      * the configuration file.
+     * 
+     * As Redis is single-threaded, payloads may be spread across several 
+     * instances (shards) so that throughput scales with their number. Each new
+     * payload is placed on a shard by consistent hashing of its generated ID, 
+     * and the shard's index is encoded in its key as a "{n}" prefix, so that 
+     * any connector configured with the same shards finds it without hashing.
+     * Keys without a prefix are on the first shard. Commands for many keys 
+     * (storeMany(), checkOutMany(), reclaim()) are pipelined on every shard 
+     * involved before any reply is read.
      */
     class RedisConnector : public DBConnector {
     public:
@@ -358,6 +529,15 @@ namespace nsb {
          * @param db_port The port to be used to access the Redis server.
          */
         RedisConnector(const std::string& clientIdentifier, std::string& db_address, int db_port);
+        /**
+         * @brief Constructor for a new RedisConnector spread across shards.
+         * 
+         * @param clientIdentifier The identifier of the client using this 
+         *                         connector.
+         * @param db_shards The Redis instances, in the same order for every 
+         *                  connector sharing them.
+         */
+        RedisConnector(const std::string& clientIdentifier, const std::vector<DBShard>& db_shards);
         /**
          * @brief Destructor for the RedisConnector object.
          * 
@@ -382,6 +562,26 @@ namespace nsb {
          * @return std::string The generated key the message was stored with.
          */
         std::string store(const std::string& value);
+        /**
+         * @brief Stores many payloads in one round trip per shard.
+         * 
+         * @param values The values (payloads) to be stored.
+         * @return std::vector<std::string> The generated keys, in the order of
+         *         the values ("" for any that could not be stored).
+         */
+        std::vector<std::string> storeMany(const std::vector<std::string>& values);
+        /**
+         * @brief Puts checked-out payloads back under their keys.
+         * 
+         * This method is used to give back payloads that were checked out 
+         * ahead of time but never used, so that they can be checked out 
+         * again. Keys that have been stored again since are left as they are.
+         * 
+         * @param keys The keys the payloads were checked out from.
+         * @param values The payloads, in the order of the keys.
+         * @return int The number of payloads put back.
+         */
+        int restoreMany(const std::vector<std::string>& keys, const std::vector<std::string>& values);
         /**
          * @brief Checks out a payload.
          * 
@@ -393,6 +593,18 @@ namespace nsb {
          * @return std::string NSBAppClient::receive()
          */
         std::string checkOut(const std::string& key);
+        /**
+         * @brief Checks out many payloads in one round trip.
+         * 
+         * This method pipelines a GETDEL for each key, sending all of them 
+         * before reading any reply, so checking out a batch of payloads costs
+         * a single round trip to each Redis shard involved.
+         * 
+         * @param keys The keys of the payloads to check out.
+         * @return std::vector<std::string> The payloads, in the order of the 
+         *         keys ("" for any that were not found).
+         */
+        std::vector<std::string> checkOutMany(const std::vector<std::string>& keys);
         /**
          * @brief Peeks at the payload at the given key.
          * 
@@ -405,12 +617,42 @@ namespace nsb {
          * @return std::string The retrieved payload.
          */
         std::string peek(const std::string& key);
+        /**
+         * @brief Deletes payloads that will never be checked out.
+         * 
+         * This method deletes all of the given keys with a single DEL command
+         * per shard, so that payloads of messages dropped in simulation do not remain in 
+         * the database.
+         * 
+         * @param keys The keys of the payloads to delete.
+         * @return int The number of payloads deleted.
+         */
+        int reclaim(const std::vector<std::string>& keys);
     private:
-        std::string address;
-        int port;
-        redisContext* context;
+        struct Shard {
+            std::string address;
+            int port;
+            redisContext* context;
+        };
+        std::vector<Shard> shards;
+        /** @brief Hash ring of (point, shard index) pairs, sorted by point. */
+        std::vector<std::pair<uint64_t, std::size_t>> ring;
         bool connect();
         void disconnect();
+        /** @brief Hashes a string onto the ring. */
+        static uint64_t hashKey(const std::string& value);
+        /** @brief Generates a key for a new payload, placing it on a shard. */
+        std::string newKey();
+        /** @brief Gets the index of the shard a key is stored on. */
+        std::size_t shardOf(const std::string& key) const;
+        /**
+         * @brief Sets many keys in one round trip per shard.
+         * 
+         * @param keys The keys, of which any that could not be set are cleared.
+         * @param values The values, in the order of the keys.
+         * @param onlyNew Whether to leave keys that already exist as they are.
+         */
+        void setMany(std::vector<std::string>* keys, const std::vector<std::string>& values, bool onlyNew);
     };
 
     
@@ -0,0 +1,35 @@
+// nsb_checksum.h
+
+#ifndef NSB_CHECKSUM_H
+#define NSB_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nsb {
+
+    /**
+     * @brief Computes the CRC32C (Castagnoli) checksum of a buffer.
+     *
+     * Uses the CPU's CRC32C instructions when available (SSE4.2 on x86-64,
+     * the CRC extension on ARMv8), checked once at run time, running three
+     * independent streams over large buffers so that the instructions are
+     * kept busy, and combining them afterwards. Otherwise falls back to a
+     * table-driven (slicing-by-8) implementation.
+     *
+     * @param data The buffer.
+     * @param size The size of the buffer (bytes).
+     * @param crc The checksum of preceding data, to extend it (0 to start).
+     * @return uint32_t The checksum.
+     */
+    uint32_t crc32c(const void* data, std::size_t size, uint32_t crc = 0);
+
+    /**
+     * @brief Gets the name of the CRC32C implementation in use.
+     *
+     * @return const char* "sse4.2", "armv8", or "software".
+     */
+    const char* crc32cImplementation();
+}
+
+#endif // NSB_CHECKSUM_H
@@ -4,25 +4,431 @@
 #define NSB_CLIENT_H
 
 #include "nsb.h"
+#include "nsb_metrics.h"
+#include "nsb_relay.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace nsb {
 
+    /** @brief The most payloads a PayloadPrefetcher holds or has in flight. */
+    const std::size_t PREFETCH_MAX_PAYLOADS = 1024;
+    /** @brief How long a prefetched payload is held for before it is given back (milliseconds). */
+    const int PREFETCH_EXPIRY_MS = 10000;
+    /** @brief The most rejected messages an NSBAppClient keeps for takeRejected(). */
+    const std::size_t MAX_REJECTED_ENTRIES = 1024;
+
+    /**
+     * @brief Checks out payloads from the database ahead of their delivery.
+     * 
+     * When the database is in use, delivering a message takes a round trip to 
+     * the daemon for its key and then another to the database for its 
+     * payload. The prefetcher takes the second one off the delivery path: as 
+     * soon as a client learns the keys of messages waiting for it (from a 
+     * doorbell or a batch response), it passes them to prefetch(), and a 
+     * background thread with its own database connection checks them all out
+     * in one pipelined round trip. When the message itself is delivered, 
+     * take() usually finds its payload already in memory.
+     * 
+     * Payloads are deleted from the database as they are prefetched, so every
+     * prefetched key must be taken by the client that prefetched it. Payloads
+     * that are not taken within PREFETCH_EXPIRY_MS, or that make room for 
+     * newer keys once PREFETCH_MAX_PAYLOADS are held, are given back to the 
+     * database, as are those still held when the prefetcher is destroyed.
+     */
+    class PayloadPrefetcher {
+    public:
+        /**
+         * @brief Constructor for a new PayloadPrefetcher.
+         * 
+         * @param clientIdentifier The identifier of the client using it.
+         * @param dbShards The Redis instances payloads are stored in.
+         */
+        PayloadPrefetcher(const std::string& clientIdentifier, const std::vector<DBShard>& dbShards);
+        /** @brief Stops the background thread and closes its connection. */
+        ~PayloadPrefetcher();
+        /**
+         * @brief Starts checking out payloads in the background.
+         * 
+         * Keys that are already held or in flight are ignored. Once 
+         * PREFETCH_MAX_PAYLOADS are, the oldest payloads held are given back
+         * to make room, and new keys are ignored while the rest are in flight.
+         * 
+         * @param keys The keys of the payloads to check out.
+         */
+        void prefetch(const std::vector<std::string>& keys);
+        /**
+         * @brief Takes a prefetched payload, waiting for it if it is in flight.
+         * 
+         * @param key The key of the payload.
+         * @param payload Where to move the payload.
+         * @return bool True if the key had been prefetched, else false (and 
+         *              the caller should check it out itself).
+         */
+        bool take(const std::string& key, std::string* payload);
+        /** @brief Gets how many payloads were taken from memory. */
+        int64_t hits() const { return hitCount; }
+        /** @brief Gets how many payloads were asked for without being prefetched. */
+        int64_t misses() const { return missCount; }
+    private:
+        using Clock = std::chrono::steady_clock;
+        /** @brief A prefetched payload (empty while in flight). */
+        struct Prefetched {
+            std::optional<std::string> payload;
+            /** @brief When the key was prefetched. */
+            Clock::time_point since;
+        };
+        void run();
+        /**
+         * @brief Queues the oldest payloads held to be given back, if they
+         * have expired or room is needed. Called with the mutex held.
+         * 
+         * @param room How many more keys need room.
+         */
+        void evict(std::size_t room);
+        RedisConnector db;
+        std::mutex mutex;
+        std::condition_variable cv;
+        /** @brief Keys waiting to be checked out by the background thread. */
+        std::deque<std::string> queue;
+        /** @brief Prefetched payloads by key. */
+        std::unordered_map<std::string, Prefetched> payloads;
+        /** @brief Prefetched keys, oldest first (including some already taken). */
+        std::deque<std::pair<std::string, Clock::time_point>> order;
+        /** @brief Payloads waiting to be given back by the background thread. */
+        std::vector<std::pair<std::string, std::string>> evicted;
+        /** @brief Keys of evicted payloads until they have been given back. */
+        std::unordered_set<std::string> returning;
+        bool stopping = false;
+        std::atomic<int64_t> hitCount{0};
+        std::atomic<int64_t> missCount{0};
+        std::thread worker;
+    };
+
     class NSBClient {
     public:
         NSBClient(const std::string& identifier, std::string serverAddress, int serverPort);
         ~NSBClient();
         const std::string getId() const { return clientId; }
-        void initialize();
+        /** @brief Gets the configuration received from the daemon at initialization. */
+        const Config& getConfig() const { return cfg; }
+        /**
+         * @brief Initializes the client with the daemon.
+         * 
+         * This method sends an NSB INIT message over the CTRL channel with the
+         * client's identifier and channel details (and session token, if it 
+         * has one), then applies the configuration the daemon responds with, 
+         * connecting to the database if it is in use. If initialization fails,
+         * the client is left disconnected, so that its next operation 
+         * reconnects and tries again.
+         * 
+         * @return bool True if the client was initialized.
+         */
+        bool initialize();
         bool ping();
+        /**
+         * @brief Requests runtime statistics from the daemon.
+         * 
+         * This method sends an NSB STATS message over the CTRL channel and 
+         * waits for the daemon's report, which includes per-subsystem memory 
+         * accounting (bytes held, peak bytes, and allocation counts).
+         * 
+         * @return nsb::nsbm::StatsReport The daemon's report, or an empty 
+         *                                report if none was received.
+         */
+        nsb::nsbm::StatsReport daemonStats();
+        /**
+         * @brief Asks the daemon to profile itself.
+         * 
+         * This method sends an NSB PROFILE message over the CTRL channel. The 
+         * daemon samples its own call stacks for the given duration and then 
+         * writes them as folded stacks (for flame graphs) on its host.
+         * 
+         * @param durationMs How long to profile for (0 for the daemon's default).
+         * @param frequencyHz Samples per second (0 for the daemon's default).
+         * @param path The name of the file the daemon writes the profile to, 
+         *             in its profile directory ("" for its default).
+         * @return std::string The path the profile will be written to, or "" 
+         *                     if the daemon could not start profiling (or 
+         *                     does not accept remote profiling).
+         */
+        std::string profileDaemon(int durationMs = 0, int frequencyHz = 0, const std::string& path = "");
         void exit();
+        /**
+         * @brief Reconnects to the daemon and resumes the client's session.
+         * 
+         * This method closes the client's channels, connects them again with 
+         * bounded exponential backoff, and repeats the INIT transaction with 
+         * the session token issued at initialization, so that the daemon 
+         * rebinds the new connections to the client's existing identity, 
+         * queued messages, and messages held for it while it was away. Client 
+         * operations call this automatically when the connection drops.
+         * 
+         * @return bool True if the client is connected and initialized again.
+         */
+        bool reconnect();
+        /**
+         * @brief Gets the session token issued by the daemon at initialization.
+         * 
+         * @return const std::string& The token, or "" if not initialized.
+         */
+        const std::string& getSessionToken() const { return sessionToken; }
+        /**
+         * @brief Gets the polling hints from the last FETCH or RECEIVE response.
+         * 
+         * @return const nsb::nsbm::PollHints& The hints, which are empty if no 
+         *                                     response has carried any yet.
+         * @see AdaptivePoller
+         */
+        const nsb::nsbm::PollHints& pollHints() const { return lastHints; }
+        /**
+         * @brief Gets the socket file descriptor of one of the client's channels.
+         * 
+         * Simulator integrations can wait on the RECV and DGRAM descriptors in 
+         * their own event loops and only call into the client once a response 
+         * or forwarded message is ready to be read.
+         * 
+         * @param channel The channel whose socket to get.
+         * @return int The file descriptor, or -1 if the channel is not open.
+         */
+        int getFd(Comms::Channel channel) const { return comms.getFd(channel); }
+        /**
+         * @brief Waits for the daemon to announce that messages are waiting.
+         * 
+         * In PULL mode, once doorbells are enabled (see setDoorbellEnabled()) 
+         * and a batch request (fetchBatch() or receiveBatch()) has drained 
+         * everything queued for the client, the daemon rings its doorbell 
+         * when the next message arrives: a single NOTIFY carrying 
+         * the number of messages and payload bytes now waiting, sent at most 
+         * once until the client has drained its queue again. The client then
+         * pulls everything with batch requests, so a burst of messages costs
+         * one notification and a few round trips instead of one poll each.
+         * 
+         * Use only batch requests while relying on the doorbell, draining 
+         * until pollHints() reports an empty queue before waiting again:
+         * 
+         * @code
+         * simClient.setDoorbellEnabled(true);
+         * while (simClient.awaitDoorbell(-1) >= 0) {
+         *     do {
+         *         for (MessageEntry& entry : simClient.fetchBatch()) { ... }
+         *     } while (simClient.pollHints().queue_depth() > 0);
+         * }
+         * @endcode
+         * 
+         * @param timeout The amount of time in seconds to wait, or -1 to wait
+         *                indefinitely.
+         * @return int The number of messages waiting (see pollHints() for 
+         *             their size), 0 if the timeout passed, or -1 on error.
+         */
+        int awaitDoorbell(int timeout);
+        /**
+         * @brief Sets whether batch requests arm the client's doorbell (they 
+         * do not by default).
+         * 
+         * The daemon sends a NOTIFY on the RECV channel only to clients whose
+         * batch requests ask for it, as any other response read there would 
+         * be out of step with its request. Any request sent without it, 
+         * including a plain fetch() or receive(), disarms the doorbell.
+         * 
+         * @param enable Whether to arm the doorbell.
+         * @see awaitDoorbell()
+         */
+        void setDoorbellEnabled(bool enable) { doorbellEnabled = enable; }
+        /**
+         * @brief Sets whether payloads are prefetched from the database.
+         * 
+         * When enabled (and the database is in use), the payloads of messages
+         * waiting for the client are checked out in the background as soon 
+         * as their keys are known: when a doorbell is rung, the daemon lists 
+         * their keys in the NOTIFY, and the batch requests that follow then 
+         * find their payloads in memory. Batch responses are always checked 
+         * out with a single pipelined round trip.
+         * 
+         * Prefetching checks payloads out, so it cannot be enabled while 
+         * fetched payloads are retained (see NSBSimClient::setRetainPayloads()).
+         * 
+         * @param enable Whether to prefetch payloads.
+         * @see PayloadPrefetcher
+         */
+        void setPrefetchPayloads(bool enable);
+        /**
+         * @brief Gets the payload prefetcher, if enabled.
+         * 
+         * @return const PayloadPrefetcher* The prefetcher, or nullptr.
+         */
+        const PayloadPrefetcher* getPrefetcher() const { return prefetcher.get(); }
+        /**
+         * @brief Sets whether small messages are sent as datagrams (they are 
+         * not by default).
+         * 
+         * When enabled and the datagram channel was negotiated at 
+         * initialization, SEND and POST messages that fit in a single 
+         * datagram are sent over the DGRAM channel. Datagrams are not 
+         * retransmitted, so only enable this for messages the application 
+         * can afford to lose; otherwise, everything is sent over the SEND 
+         * channel.
+         * 
+         * @param enable Whether to send small messages as datagrams.
+         * @see Config::USE_DGRAM
+         */
+        void setUseDatagrams(bool enable) { useDatagrams = enable; }
+        /**
+         * @brief Gets the number of fetched or received payloads discarded 
+         * because they failed their checksum.
+         * 
+         * @see Config::USE_CHECKSUM
+         */
+        int64_t checksumFailures() const { return checksumFailureCount; }
+        /**
+         * @brief Gets the client's performance metrics.
+         * 
+         * Every operation (send, receive, fetch, post, and their batches) is 
+         * counted and timed, as is each of its steps: serializing and parsing
+         * messages, writing to the daemon's sockets, waiting for the daemon's
+         * response, and storing and checking out payloads in the database. 
+         * Each metric reports its count, errors, timeouts, and empty results
+         * alongside latency percentiles.
+         * 
+         * @return std::vector<ClientMetrics::Snapshot> Every metric measured 
+         *                                              since the last reset.
+         */
+        std::vector<ClientMetrics::Snapshot> stats() const { return metrics.snapshots(); }
+        /** @brief Forgets every metric measured so far. */
+        void resetStats() { metrics.reset(); }
+        /**
+         * @brief Sets whether metrics are measured (they are by default).
+         * 
+         * @param enable Whether to measure metrics.
+         */
+        void setMetricsEnabled(bool enable) { metrics.setEnabled(enable); }
+        /**
+         * @brief Pushes the client's metrics to the daemon.
+         * 
+         * This method sends an NSB STATS message carrying the client's 
+         * metrics over the CTRL channel without waiting for a response. The 
+         * daemon keeps the latest metrics pushed by each client and includes
+         * them in the reports returned by daemonStats().
+         * 
+         * @return bool True if the metrics were sent.
+         */
+        bool pushMetrics();
     protected:
         std::string msgGetPayloadObj(nsb::nsbm msg);
         void msgSetPayloadObj(std::string payloadObj, nsb::nsbm msg);
+        /**
+         * @brief Sends a serialized SEND or POST message to the daemon.
+         * 
+         * If datagrams were enabled (see setUseDatagrams()), the datagram 
+         * channel was negotiated at initialization, and the message fits in a
+         * single datagram, it is sent over the DGRAM channel; otherwise, it is
+         * sent over the SEND channel.
+         * 
+         * @param message The serialized NSB message.
+         * @return int Returns 0 if send is successful, else -1.
+         */
+        int sendDataMessage(const std::string& message);
+        /**
+         * @brief Writes a serialized message to one of the daemon's sockets, timing it.
+         * 
+         * @param channel The channel to write to.
+         * @param message The serialized NSB message.
+         * @return int Returns 0 if the write is successful, else -1.
+         */
+        int writeMessage(Comms::Channel channel, const std::string& message);
+        /** @brief Serializes an outgoing message, timing it. */
+        std::string serialize(const nsb::nsbm& message);
+        /** @brief Parses an incoming message, timing it. */
+        bool parse(const std::string& data, nsb::nsbm* message);
+        /**
+         * @brief Reconnects and resumes the session if the connection dropped.
+         * 
+         * @return bool True if the client is connected.
+         * @see reconnect()
+         */
+        bool ensureConnected();
+        /**
+         * @brief Sends a request and waits for the daemon's response.
+         * 
+         * If the connection drops while sending or waiting, the session is 
+         * resumed and the request is repeated once.
+         * 
+         * @param channel The channel to send the request and await the response on.
+         * @param request The serialized request, or "" to only await a message.
+         * @param timeout Maximum time in seconds to wait for the response.
+         * @return std::string The response, or "" if none was received.
+         */
+        std::string exchange(Comms::Channel channel, const std::string& request, int* timeout);
+        /**
+         * @brief Sends a batch request over the RECV channel and parses the response.
+         * 
+         * A doorbell that arrives first is set aside for awaitDoorbell().
+         * 
+         * @param request The serialized FETCH or RECEIVE request.
+         * @param timeout Maximum time in seconds to wait for the response.
+         * @param response The message to parse the response into.
+         * @return bool True if a response was received.
+         */
+        bool exchangeBatch(const std::string& request, int timeout, nsb::nsbm* response);
+        /**
+         * @brief Unpacks the batch of a FETCH or RECEIVE response.
+         * 
+         * @param response The response.
+         * @param retain Whether to leave payloads in the database.
+         * @return std::vector<MessageEntry> The entries, with their full payloads.
+         */
+        std::vector<MessageEntry> unpackBatch(const nsb::nsbm& response, bool retain);
+        /**
+         * @brief Checks out a payload, from memory if it was prefetched.
+         * 
+         * @param key The key of the payload.
+         * @return std::string The payload.
+         */
+        std::string checkOutPayload(const std::string& key);
+        /** @brief Prefetches the payloads listed in a doorbell, if enabled. */
+        void prefetchNotified(const nsb::nsbm& notification);
+        /**
+         * @brief Sets the checksum of an outgoing payload, if enabled.
+         * 
+         * @param payload The payload.
+         * @param metadata The metadata to set the checksum in.
+         * @param checksum A checksum already computed for the payload, if any.
+         */
+        void setChecksum(const std::string& payload, nsb::nsbm::Metadata* metadata,
+                         std::optional<uint32_t> checksum = std::nullopt);
+        /**
+         * @brief Verifies the checksum of an incoming payload, if it has one.
+         * 
+         * @param metadata The metadata the payload arrived with.
+         * @param entry The entry holding the payload, whose checksum is set.
+         * @return bool False if the payload failed its checksum.
+         */
+        bool verifyChecksum(const nsb::nsbm::Metadata& metadata, MessageEntry* entry);
         const std::string clientId;
         SocketInterface comms;
         nsb::nsbm::Manifest::Originator* originIndicator;
         Config cfg;
         RedisConnector* db;
+        nsb::nsbm::PollHints lastHints;
+        std::string sessionToken;
+        /** @brief Whether a doorbell was set aside while awaiting a response. */
+        bool doorbellRung = false;
+        /** @brief Whether batch requests arm the doorbell (see setDoorbellEnabled()). */
+        bool doorbellEnabled = false;
+        std::unique_ptr<PayloadPrefetcher> prefetcher;
+        /** @brief Whether fetched payloads are left in the database (see NSBSimClient::setRetainPayloads()). */
+        bool retainPayloads = false;
+        /** @brief Whether small messages are sent as datagrams (see setUseDatagrams()). */
+        bool useDatagrams = false;
+        int64_t checksumFailureCount = 0;
+        /** @brief Counters and latencies of the client's operations and their steps. */
+        ClientMetrics metrics;
     };
 
     class NSBAppClient : public NSBClient {
@@ -78,6 +484,137 @@ namespace nsb {
             }
         }
         MessageEntry listenReceive();
+        /**
+         * @brief Receives all (or up to _maxMessages_) waiting payloads in one 
+         * round trip.
+         * 
+         * This method is only available in PULL mode. It sends a single 
+         * RECEIVE request for a batch and returns the messages in the order 
+         * they were posted; pollHints() then reports how many remain. Draining
+         * the queue this way arms the client's doorbell, if enabled (see 
+         * awaitDoorbell()).
+         * 
+         * @param destId Pointer to the identifier of the destination, or 
+         *               nullptr to receive messages for this client.
+         * @param maxMessages The most messages to receive, or 0 for all.
+         * @param timeout The amount of time in seconds to wait for the response.
+         * @return std::vector<MessageEntry> The received messages, which is 
+         *         empty if none were waiting.
+         */
+        std::vector<MessageEntry> receiveBatch(std::string* destId=nullptr, int maxMessages=0,
+                                               int timeout=DAEMON_RESPONSE_TIMEOUT);
+        /**
+         * @brief Gets the number of sent messages the daemon has rejected 
+         * because of rate limiting.
+         * 
+         * Rejections arrive on the SEND channel after the messages they 
+         * reject, so this picks up any that have arrived since the last call
+         * before counting them.
+         * 
+         * @see takeRejected()
+         */
+        int64_t rejectedSends();
+        /**
+         * @brief Takes the sent messages the daemon has rejected since the 
+         * last call.
+         * 
+         * Each entry carries the rejected message's source, destination, 
+         * payload size and checksum, and the key send() returned for it (as 
+         * its payload key) if the database is in use. Its payload has already 
+         * been removed from the database. Only the latest 
+         * MAX_REJECTED_ENTRIES are kept.
+         * 
+         * @return std::vector<MessageEntry> The rejected messages, oldest first.
+         */
+        std::vector<MessageEntry> takeRejected();
+    private:
+        std::string receiveRequest(std::string* destId, int maxBatch=0);
+        /** @brief Reads the rejections waiting on the SEND channel, without blocking. */
+        void collectRejections();
+        int64_t rejectedSendCount = 0;
+        std::deque<MessageEntry> rejected;
+        /** @brief Rejections read off the SEND channel, each framed (see packFrame()). */
+        FrameReader rejectionFrames;
+        /** @brief The SEND channel the frames were read from, to drop partial ones after reconnecting. */
+        int rejectionFd = -1;
+    };
+
+    /**
+     * @brief Helper to schedule polls using the daemon's polling hints.
+     * 
+     * Clients that poll with receive() or fetch() can pass each result to 
+     * update() to get the delay before their next poll. The delay is the 
+     * minimum while messages keep coming, follows the daemon's suggestion when
+     * the queue is empty, and backs off exponentially when no hint is given. 
+     * Delays are returned in seconds so they can be used directly with 
+     * simulator schedulers.
+     * 
+     * @code
+     * AdaptivePoller poller;
+     * MessageEntry entry = simClient.fetch();
+     * double delay = poller.update(entry, simClient.pollHints());
+     * Simulator::Schedule(Seconds(delay), &PollToFetch);
+     * @endcode
+     */
+    class AdaptivePoller {
+    public:
+        /**
+         * @brief Constructor for a new AdaptivePoller.
+         * 
+         * @param minDelay The shortest delay between polls, in seconds.
+         * @param maxDelay The longest delay between polls, in seconds.
+         */
+        AdaptivePoller(double minDelay=0.001, double maxDelay=1.0);
+        /**
+         * @brief Updates the poller with the result of a poll.
+         * 
+         * @param result The entry returned by the poll.
+         * @param hints The hints returned with it.
+         * @return double The delay before the next poll, in seconds.
+         */
+        double update(const MessageEntry& result, const nsb::nsbm::PollHints& hints);
+        /** @brief Gets the current delay before the next poll, in seconds. */
+        double nextDelay() const { return delay; }
+    private:
+        double minDelay;
+        double maxDelay;
+        double delay;
+    };
+
+    /**
+     * @brief The outcome of a simulated transmission, reported with 
+     * NSBSimClient::postBatch().
+     */
+    struct PostEntry {
+        /** @brief What happened to the message in the simulated network. */
+        enum class Verdict {
+            DELIVERED = 0,
+            DROPPED = 1,
+            CORRUPTED = 2
+        };
+        /** @brief The source identifier. */
+        std::string source;
+        /** @brief The destination identifier. */
+        std::string destination;
+        /** @brief The payload (only sent for delivered messages). */
+        std::string payload;
+        /** @brief The database key the payload is still stored under, if any. */
+        std::string key;
+        /** @brief The verdict for this message. */
+        Verdict verdict;
+        /**
+         * @brief The checksum of the payload, if it was fetched with one, so
+         * that it is not computed again. Reset it if the payload is changed.
+         */
+        std::optional<uint32_t> checksum;
+        /** @brief Populated constructor. */
+        PostEntry(std::string src, std::string dest, std::string data, Verdict v=Verdict::DELIVERED)
+            : source(std::move(src)), destination(std::move(dest)), payload(std::move(data)), verdict(v) {}
+        /** @brief Constructor for a fetched entry, keeping its retained key. */
+        PostEntry(MessageEntry entry, Verdict v=Verdict::DELIVERED)
+            : source(std::move(entry.source)), destination(std::move(entry.destination)),
+              payload(std::move(entry.payload_obj)), key(std::move(entry.payload_key)), verdict(v),
+              checksum(entry.checksum) {}
     };
 
     class NSBSimClient : public NSBClient {
@@ -95,7 +632,89 @@ namespace nsb {
             }
         }
         MessageEntry listenFetch();
-        std::string post(std::string srcId, std::string destId, std::string &payload);
+        /**
+         * @brief Sends a FETCH request without waiting for the response.
+         * 
+         * This is the first half of fetch() for event-driven integrations: 
+         * after sending the request, wait for the RECV descriptor (see getFd())
+         * to become readable and then call collectFetch(). In PUSH mode no 
+         * request is needed, so this does nothing.
+         * 
+         * @param srcId Pointer to the identifier of the target source, or 
+         *              nullptr to fetch a message from any source.
+         * @return int Returns 0 if the request was sent (or none was needed), 
+         *             else -1.
+         * @see collectFetch()
+         */
+        int requestFetch(std::string* srcId=nullptr);
+        /**
+         * @brief Reads a FETCH response or FORWARD message that has arrived.
+         * 
+         * This is the second half of fetch(). It parses whatever message is 
+         * waiting on the RECV channel, waiting at most _timeout_ seconds for 
+         * one, and updates pollHints() like fetch() does.
+         * 
+         * @param timeout The amount of time in seconds to wait for a message.
+         * @return MessageEntry The fetched entry if a message was found, 
+         *                      otherwise an empty MessageEntry.
+         * @see requestFetch()
+         */
+        MessageEntry collectFetch(int timeout=0);
+        /**
+         * @brief Fetches all (or up to _maxMessages_) waiting payloads in one 
+         * round trip.
+         * 
+         * This method is only available in PULL mode. It sends a single FETCH
+         * request for a batch and returns the messages in the order they were
+         * sent; pollHints() then reports how many remain. Draining the queue 
+         * this way arms the client's doorbell, if enabled (see 
+         * awaitDoorbell()).
+         * 
+         * @param srcId Pointer to the identifier of the target source, or 
+         *              nullptr to fetch messages from any source.
+         * @param maxMessages The most messages to fetch, or 0 for all.
+         * @param timeout The amount of time in seconds to wait for the response.
+         * @return std::vector<MessageEntry> The fetched messages, which is 
+         *         empty if none were waiting.
+         */
+        std::vector<MessageEntry> fetchBatch(std::string* srcId=nullptr, int maxMessages=0,
+                                             int timeout=DAEMON_RESPONSE_TIMEOUT);
+        std::string post(std::string srcId, std::string destId, const std::string &payload);
+        /**
+         * @brief Posts the outcomes of many simulated transmissions at once.
+         * 
+         * This method reports a verdict for every message in _entries_ (e.g.,
+         * all messages resolved in a simulation tick) in a single POST 
+         * message. The daemon makes delivered messages available to their 
+         * destinations in one pass, and counts dropped and corrupted messages,
+         * which are never received. If the database is in use, payloads of 
+         * dropped and corrupted messages that are still stored (see 
+         * setRetainPayloads()) are deleted right away, and delivered ones are 
+         * passed on under the key they are already stored under instead of 
+         * being stored again.
+         * 
+         * @param entries The messages and their verdicts.
+         * @return int Returns 0 if the batch was sent, else -1.
+         */
+        int postBatch(const std::vector<PostEntry>& entries);
+        /**
+         * @brief Sets whether fetched payloads are left in the database.
+         * 
+         * By default, fetching a payload from the database deletes it. When 
+         * retained, it is read without being deleted and its key is kept in 
+         * MessageEntry::payload_key, so that postBatch() can pass it on 
+         * without storing it again, or reclaim it if the message is dropped.
+         * Retained payloads must be posted with postBatch() to be released.
+         * Payloads cannot be retained while they are prefetched (see 
+         * setPrefetchPayloads()), as prefetching checks them out.
+         * 
+         * @param retain Whether to retain fetched payloads.
+         */
+        void setRetainPayloads(bool retain);
+    private:
+        std::string fetchRequest(std::string* srcId, int maxBatch=0);
+        /** @brief Parses a FETCH response, setting the outcome of the operation being timed. */
+        MessageEntry parseFetchResponse(const std::string& response, std::string* srcId, MetricTimer* timer);
     };
 }
 
@@ -4,10 +4,39 @@
 #define NSB_DAEMON_H
 
 #include "nsb.h"
+#include "nsb_governor.h"
+#include "nsb_heavyhitters.h"
+#include "nsb_profiler.h"
+#include "nsb_queue.h"
+#include "nsb_ratelimit.h"
+#include "nsb_rcu.h"
+#include "nsb_relay.h"
+#include "nsb_resp.h"
+
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
 
 namespace nsb {
     /** @brief The maximum buffer size for sending and receiving messages. */
     const int MAX_BUFFER_SIZE = 4096;
+    /** @brief The maximum number of datagrams received or sent in one batch. */
+    const int DGRAM_BATCH_SIZE = 64;
+    /** @brief The shortest next-poll delay suggested to an idle client (microseconds). */
+    const int64_t MIN_POLL_HINT_US = 1000;
+    /** @brief The longest next-poll delay suggested to an idle client (microseconds). */
+    const int64_t MAX_POLL_HINT_US = 1000000;
+    /** @brief The most payload keys listed in a doorbell for the client to prefetch. */
+    const int DOORBELL_MAX_KEYS = 64;
+    /** @brief The first of the virtual file descriptors given to channels relayed by proxies. */
+    const int RELAY_FD_BASE = 1 << 30;
+    /** @brief Byte buffer used for socket reads and serialized responses. */
+    using ConnectionBuffer = std::vector<char, TaggedAllocator<char, MemoryTag::CONNECTION>>;
+    /** @brief Lookup table keyed by identifier or "address:port" strings. */
+    template <typename V>
+    using Registry = std::map<std::string, V, std::less<std::string>,
+                              TaggedAllocator<std::pair<const std::string, V>, MemoryTag::REGISTRY>>;
 
     class NSBDaemon {
     public:
@@ -70,26 +99,134 @@ namespace nsb {
             int ch_SEND_fd;
             int ch_RECV_port;
             int ch_RECV_fd;
+            /** @brief The client's datagram port, or 0 if it has none. */
+            int ch_DGRAM_port;
+            /** @brief The token the client presents to resume its session. */
+            std::string session_token;
+            /** @brief When the client lost a channel (zero while connected). */
+            std::chrono::steady_clock::time_point detached_since;
             ClientDetails() : address(""), ch_CTRL_port(0), ch_CTRL_fd(-1), ch_SEND_port(0),
-                            ch_SEND_fd(-1), ch_RECV_port(0), ch_RECV_fd(-1) {}
-            ClientDetails(nsb::nsbm* nsb_msg, std::map<std::string, int> fd_lookup) {
+                            ch_SEND_fd(-1), ch_RECV_port(0), ch_RECV_fd(-1), ch_DGRAM_port(0) {}
+            ClientDetails(nsb::nsbm* nsb_msg, const Registry<int>& fd_lookup) {
                 identifier = nsb_msg->intro().identifier();
                 address = nsb_msg->intro().address();
                 ch_CTRL_port = nsb_msg->intro().ch_ctrl();
                 ch_SEND_port = nsb_msg->intro().ch_send();
                 ch_RECV_port = nsb_msg->intro().ch_recv();
+                ch_DGRAM_port = nsb_msg->intro().ch_dgram();
                 // Populate the file descriptors.
                 std::string ctrl_addr = address + ":" + std::to_string(ch_CTRL_port);
                 ch_CTRL_fd = fd_lookup.find(ctrl_addr) != fd_lookup.end() ?
-                            fd_lookup[ctrl_addr] : -1;
+                            fd_lookup.at(ctrl_addr) : -1;
                 std::string send_addr = address + ":" + std::to_string(ch_SEND_port);
                 ch_SEND_fd = fd_lookup.find(send_addr) != fd_lookup.end() ?
-                            fd_lookup[send_addr] : -1;
+                            fd_lookup.at(send_addr) : -1;
                 std::string recv_addr = address + ":" + std::to_string(ch_RECV_port);
                 ch_RECV_fd = fd_lookup.find(recv_addr) != fd_lookup.end() ?
-                            fd_lookup[recv_addr] : -1;
+                            fd_lookup.at(recv_addr) : -1;
             
             }
+            /** @brief Whether or not the client has lost a channel and not yet resumed. */
+            bool detached() const { return detached_since.time_since_epoch().count() != 0; }
+        };
+
+        /**
+         * @brief Arrival rate estimator for a stream of messages.
+         * 
+         * This struct keeps an exponentially weighted moving average of the 
+         * interval between arrivals, which is used to suggest when a client 
+         * should poll next.
+         */
+        struct ArrivalEstimator {
+            /** @brief Smoothed interval between arrivals, in seconds (0 if unknown). */
+            double interval = 0;
+            /** @brief When the last message arrived. */
+            std::chrono::steady_clock::time_point last;
+            /** @brief Records a new arrival. */
+            void record(std::chrono::steady_clock::time_point now) {
+                if (last.time_since_epoch().count() != 0) {
+                    double dt = std::chrono::duration<double>(now - last).count();
+                    interval = interval == 0 ? dt : 0.2 * dt + 0.8 * interval;
+                }
+                last = now;
+            }
+            /**
+             * @brief Gets the expected interval until the next arrival.
+             * 
+             * A stream that has been quiet for longer than its usual interval is
+             * treated as slowing down, so the time since the last arrival is 
+             * used instead.
+             */
+            double expected(std::chrono::steady_clock::time_point now) const {
+                if (interval == 0) {
+                    return 0;
+                }
+                return std::max(interval, std::chrono::duration<double>(now - last).count());
+            }
+        };
+
+        /**
+         * @brief The two halves of the daemon, each served by its own thread.
+         * 
+         * The control plane accepts connections and handles INIT, PING, 
+         * STATS, PROFILE, and EXIT messages, along with session bookkeeping.
+         * The data plane handles SEND, FETCH, POST, and RECEIVE messages, and
+         * owns the message buffers. Once a client is initialized, its SEND 
+         * and RECV channels are handed over to the data plane, so that bursts
+         * of control traffic (such as hundreds of clients connecting at once)
+         * do not hold up message delivery.
+         */
+        enum class Plane {
+            CONTROL = 0,
+            DATA = 1
+        };
+
+        /** @brief Work passed from one plane's thread to the other's. */
+        struct Handoff {
+            enum class Kind {
+                /** @brief (To the data plane) Start serving a channel, handling any message that came with it. */
+                ADOPT_FD,
+                /** @brief (To the data plane) Deliver messages held for a client that has resumed. */
+                RESUMED,
+                /** @brief (To the data plane) Discard messages held for a client whose session expired. */
+                EXPIRED,
+                /** @brief (To the control plane) A channel was closed by its client. */
+                CLOSED_FD,
+                /** @brief (To the control plane) Handle a control message that arrived on a data channel. */
+                MESSAGE,
+                /** @brief (To the control plane) Register a channel relayed by a proxy under its address. */
+                RELAY_CHANNEL
+            };
+            Kind kind;
+            int fd;
+            std::string key;
+            ConnectionBuffer data;
+            Handoff(Kind kind, int fd = -1, std::string key = "", ConnectionBuffer data = ConnectionBuffer()) :
+                kind(kind), fd(fd), key(std::move(key)), data(std::move(data)) {}
+        };
+
+        /**
+         * @brief A queue of handoffs to one plane, with a pipe that wakes its 
+         * thread from select().
+         * 
+         * Only taken when channels change hands or sessions change, never 
+         * for each message.
+         */
+        struct Mailbox {
+            std::mutex mutex;
+            std::vector<Handoff> items;
+            /** @brief The pipe's read and write ends (-1 while closed). */
+            int wake_fds[2] = {-1, -1};
+            /** @brief Opens the wake pipe; returns false on failure. */
+            bool open();
+            /** @brief Closes the wake pipe. */
+            void close();
+            /** @brief Queues a handoff and wakes the receiving thread. */
+            void post(Handoff item);
+            /** @brief Wakes the receiving thread without a handoff. */
+            void wake();
+            /** @brief Takes every queued handoff, clearing the wake pipe. */
+            std::vector<Handoff> drain();
         };
 
         /* PRIVATE VARIABLES */
@@ -100,28 +237,212 @@ namespace nsb {
         std::atomic<bool> running;
         /** @brief The server port accessible to client connections. */
         int server_port;
-        /** @brief A mapping of simulator client identifiers to their details. */
-        std::map<std::string, ClientDetails> sim_client_lookup;
-        /** @brief A mapping of application client identifiers to their details. */
-        std::map<std::string, ClientDetails> app_client_lookup;
-        /** @brief A mapping of "address:port" strings to their file descriptors. */
-        std::map<std::string, int> fd_lookup;
+        /**
+         * @brief Reclamation of the client lookups, which the data plane reads 
+         * without locking while the control plane replaces them.
+         * 
+         * The data plane is offline while blocked in select() and online 
+         * while handling messages.
+         */
+        QsbrDomain rcu;
+        /**
+         * @brief A mapping of simulator client identifiers to their details.
+         * 
+         * Written (copy-on-write) by the control plane only.
+         */
+        RcuPointer<Registry<ClientDetails>> sim_client_lookup;
+        /**
+         * @brief A mapping of application client identifiers to their details.
+         * 
+         * Written (copy-on-write) by the control plane only.
+         */
+        RcuPointer<Registry<ClientDetails>> app_client_lookup;
+        /** @brief A mapping of "address:port" strings to their file descriptors (control plane). */
+        Registry<int> fd_lookup;
+        /** @brief Channels served by the control plane, including any not yet initialized. */
+        std::vector<int> control_fds;
+        /** @brief Channels served by the data plane. */
+        std::vector<int> data_fds;
+        /** @brief Handoffs to the control plane. */
+        Mailbox to_control;
+        /** @brief Handoffs to the data plane. */
+        Mailbox to_data;
+        /** @brief The thread serving the data plane. */
+        std::thread data_plane;
+        /**
+         * @brief A link from a proxy that relays the channels of many local 
+         * clients, served by the data plane.
+         * 
+         * Each relayed channel is given a virtual file descriptor (from 
+         * RELAY_FD_BASE up) that stands in for it everywhere a client's 
+         * channel is used, and is registered under the link's address and the
+         * channel's identifier, as a directly connected channel would be under
+         * its IP address and port.
+         */
+        struct RelayLink {
+            /** @brief The address the link's channels are registered under. */
+            std::string address;
+            /** @brief Whether the proxy asked for compressed envelopes. */
+            bool compress = false;
+            RelayReader reader;
+            /** @brief Frames waiting to be sent to the proxy. */
+            nsb::nsbm::Relay outgoing;
+            /** @brief The virtual file descriptors of the link's channels, by channel identifier. */
+            std::map<uint32_t, int> channels;
+        };
+        /** @brief Where a virtual file descriptor is relayed. */
+        struct RelayChannel {
+            int link_fd;
+            uint32_t channel;
+        };
+        /** @brief Relay links by file descriptor. */
+        std::map<int, RelayLink> relay_links;
+        /** @brief Relayed channels by virtual file descriptor. */
+        std::map<int, RelayChannel> relay_channels;
+        /** @brief The next virtual file descriptor to give out. */
+        int next_relay_fd = RELAY_FD_BASE;
+        /** @brief How many relay links have been opened, to name them. */
+        int relay_link_count = 0;
+        /** @brief Guards relay_links and relay_channels, which either plane may write to. */
+        std::mutex relay_mutex;
+        /**
+         * @brief Guards the counters that the data plane updates and the 
+         * control plane reports: rate_limiter, governor, delivery_counts,
+         * hot_sources, and hot_destinations.
+         */
+        std::mutex stats_mutex;
         /**
          * @brief Transmission buffer to store sent payloads waiting to be fetched.
          * 
          * @see MessageEntry
          * @see handle_send()
          * @see handle_fetch()
+         * @see QueueBackend
          */
-        std::list<MessageEntry> tx_buffer;
+        std::unique_ptr<QueueBackend> tx_buffer;
         /**
          * @brief Reception buffer to store posted payloads waiting to be received.
          * 
          * @see MessageEntry
          * @see handle_post()
          * @see handle_receive()
+         * @see QueueBackend
          */
-        std::list<MessageEntry> rx_buffer;
+        std::unique_ptr<QueueBackend> rx_buffer;
+        /**
+         * @brief Per-client and per-namespace limiter applied to SEND messages.
+         * 
+         * @see handle_send()
+         */
+        RateLimiter rate_limiter;
+        /**
+         * @brief Paces SEND messages to the simulator's drain rate when the 
+         * transmission buffer holds a standing queue (PULL mode only).
+         * 
+         * @see handle_send()
+         * @see record_drain()
+         */
+        AdmissionGovernor governor;
+        /**
+         * @brief A mapping of paused file descriptors to when they may be read again.
+         * 
+         * File descriptors are paused when a client exceeds its rate limits and
+         * the overflow action is DELAY, or when the governor paces its SEND 
+         * messages, leaving the backlog in its socket. SEND datagrams from a 
+         * paused client are dropped instead (see handle_datagram()).
+         */
+        std::map<int, std::chrono::steady_clock::time_point> paused_fds;
+        /** @brief Arrival estimators for the transmission buffer, by source ("" for all). */
+        Registry<ArrivalEstimator> tx_arrivals;
+        /** @brief Arrival estimators for the reception buffer, by destination ("" for all). */
+        Registry<ArrivalEstimator> rx_arrivals;
+        /** @brief A datagram waiting to be sent in the next batch. */
+        struct OutgoingDatagram {
+            sockaddr_in address;
+            ConnectionBuffer data;
+        };
+        /** @brief The datagram server file descriptor, or -1 if not in use. */
+        int dgram_fd = -1;
+        /** @brief Receive slots for a batch of incoming datagrams. */
+        ConnectionBuffer dgram_buffer;
+        /**
+         * @brief Datagrams queued while handling messages.
+         * 
+         * These are sent together at the end of each server loop iteration.
+         * 
+         * @see flush_datagrams()
+         */
+        std::vector<OutgoingDatagram> dgram_outbox;
+        /** @brief How long a disconnected client's session is kept for it to resume. */
+        std::chrono::seconds session_timeout{30};
+        /**
+         * @brief Serialized messages held for clients that could not be forwarded to.
+         * 
+         * Keyed the same way as the client lookups, these are delivered when the
+         * client resumes its session and discarded if its session expires.
+         * 
+         * @see forward()
+         */
+        Registry<std::vector<ConnectionBuffer>> pending_forwards;
+        /** @brief Source of session tokens. */
+        std::mt19937_64 token_generator{std::random_device{}()};
+        /**
+         * @brief Connection used to reclaim payloads of undelivered messages, 
+         * if the database is in use.
+         * 
+         * @see handle_post_batch()
+         */
+        std::unique_ptr<RedisConnector> db;
+        /**
+         * @brief Payload store hosted by the daemon at DB_ADDRESS:DB_PORT, if
+         * the database is embedded rather than an external Redis server.
+         */
+        std::unique_ptr<RespServer> embedded_db;
+        /** @brief Counts of verdicts reported in POST batches. */
+        struct DeliveryCounters {
+            int64_t delivered = 0;
+            int64_t dropped = 0;
+            int64_t corrupted = 0;
+            int64_t reclaimed = 0;
+        };
+        DeliveryCounters delivery_counts;
+        /** @brief The sources sending the most messages and bytes. */
+        HeavyHitters hot_sources;
+        /** @brief The destinations posted the most messages and bytes. */
+        HeavyHitters hot_destinations;
+        /** @brief The metrics last pushed by each client, by identifier. */
+        Registry<nsb::nsbm::StatsReport::ClientMetrics> client_metrics;
+        /**
+         * @brief Doorbell state for a buffer.
+         * 
+         * A requester is armed when a batch FETCH or RECEIVE that asks for it
+         * (arm_doorbell) leaves nothing queued for it. The next message queued
+         * for it makes its doorbell due, and a single NOTIFY is sent at the 
+         * end of the server loop iteration, however many messages arrived. 
+         * The requester is then disarmed until it drains its queue again, and
+         * any request that does not ask for the doorbell disarms it too, as 
+         * only clients awaiting it expect a NOTIFY on their RECV channel.
+         * 
+         * @see handle_batch_request()
+         * @see ring_doorbells()
+         */
+        struct Doorbells {
+            /** @brief Lookup keys of armed clients, by the key they requested with ("" for all). */
+            Registry<std::string> armed;
+            /** @brief Requested keys that have had messages queued since they were armed. */
+            std::set<std::string> due;
+        };
+        /** @brief Doorbells of simulator clients waiting on the transmission buffer. */
+        Doorbells tx_doorbells;
+        /** @brief Doorbells of application clients waiting on the reception buffer. */
+        Doorbells rx_doorbells;
+        /**
+         * @brief Profiler of the daemon's threads, started by PROFILE messages
+         * or SIGUSR2.
+         * 
+         * @see handle_profile()
+         */
+        std::unique_ptr<SamplingProfiler> profiler;
 
         /* PRIVATE LAMBDAS */
 
@@ -142,6 +463,86 @@ namespace nsb {
             }
         }
 
+        void entry_get_checksum(const nsb::nsbm::Metadata& metadata, MessageEntry* entry) {
+            if (metadata.has_payload_crc32c()) {
+                entry->checksum = metadata.payload_crc32c();
+            }
+        }
+
+        void entry_set_checksum(const MessageEntry& entry, nsb::nsbm::Metadata* metadata) {
+            if (entry.checksum) {
+                metadata->set_payload_crc32c(*entry.checksum);
+            }
+        }
+
+        /**
+         * @brief Records an arrival for a key and for the buffer as a whole.
+         * 
+         * @param arrivals The estimators for the buffer the message arrived in.
+         * @param key The source or destination the message is queued for.
+         */
+        void record_arrival(Registry<ArrivalEstimator>& arrivals, const std::string& key) {
+            auto now = std::chrono::steady_clock::now();
+            arrivals[key].record(now);
+            if (!key.empty()) {
+                arrivals[""].record(now);
+            }
+        }
+        /**
+         * @brief Records messages taken from the transmission buffer with the 
+         * admission governor, which measures their sojourn times.
+         * 
+         * @param taken The messages taken.
+         */
+        void record_drain(const std::vector<MessageEntry>& taken) {
+            if (!governor.enabled() || taken.empty()) {
+                return;
+            }
+            auto now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            for (const MessageEntry& entry : taken) {
+                governor.dequeued(entry.timestamp, now);
+            }
+        }
+        /**
+         * @brief Marks doorbells due for a message newly queued under a key.
+         * 
+         * @param doorbells The doorbells of the buffer the message was queued in.
+         * @param key The source or destination the message is queued for.
+         */
+        void mark_doorbells(Doorbells& doorbells, const std::string& key) {
+            for (const std::string& requested : {key, std::string()}) {
+                if (doorbells.armed.count(requested)) {
+                    doorbells.due.insert(requested);
+                }
+            }
+        }
+        /**
+         * @brief Disarms the doorbell of a requester that no longer awaits it.
+         * 
+         * @param doorbells The doorbells of the buffer requested from.
+         * @param key The key the requester requested with ("" for all).
+         */
+        void disarm_doorbell(Doorbells& doorbells, const std::string& key) {
+            doorbells.armed.erase(key);
+            doorbells.due.erase(key);
+        }
+        /**
+         * @brief Populates the polling hints of a FETCH or RECEIVE response.
+         * 
+         * The hints carry how many messages (and payload bytes) remain queued 
+         * for the requester, how long the oldest of them has been waiting, and 
+         * a suggested delay before the next poll: none while messages remain, otherwise about 
+         * half the expected interval until the next arrival.
+         * 
+         * @param buffer The buffer that was polled.
+         * @param arrivals The estimators for that buffer.
+         * @param key The value matched against, or "" for the whole buffer.
+         * @param outgoing_msg The response to populate.
+         */
+        void set_poll_hints(QueueBackend& buffer, const Registry<ArrivalEstimator>& arrivals,
+                            const std::string& key, nsb::nsbm* outgoing_msg);
+
         /* PRIVATE METHODS */
 
         /**
@@ -165,6 +566,9 @@ namespace nsb {
          * come in from existing connections, they will be passed onto the 
          * handle_message method.
          * 
+         * The calling thread serves the control plane, and a second thread is 
+         * started to serve the data plane (see run_data_plane()).
+         * 
          * This method is invoked by the start() method.
          * 
          * @param port The port that will be accessible for clients to connect.
@@ -173,6 +577,195 @@ namespace nsb {
          * @see handle_message()
          */
         void start_server(int port);
+        /**
+         * @brief Serves the data plane until the daemon stops.
+         * 
+         * Reads the SEND and RECV channels handed over by the control plane 
+         * and incoming datagrams, handles their messages, and rings doorbells 
+         * and flushes datagrams after each round. Channels that close are 
+         * handed back to the control plane to detach and close.
+         * 
+         * @see Plane
+         */
+        void run_data_plane();
+        /**
+         * @brief Handles the handoffs queued for a plane.
+         * 
+         * @param plane The plane of the calling thread.
+         */
+        void handle_handoffs(Plane plane);
+        /**
+         * @brief Hands a channel served by the control plane over to the data plane.
+         * 
+         * @param fd The channel's file descriptor (ignored if not served by the control plane).
+         * @param data A message to handle once it has been adopted, if any.
+         */
+        void hand_over_fd(int fd, ConnectionBuffer data = ConnectionBuffer());
+        /**
+         * @brief Gets the plane that handles an operation.
+         * 
+         * @param op The operation.
+         * @return Plane DATA for SEND, FETCH, POST, and RECEIVE, else CONTROL.
+         */
+        static Plane plane_of(nsb::nsbm::Manifest::Operation op);
+        /** @brief Whether or not a file descriptor is a channel relayed by a proxy. */
+        static bool is_relay_fd(int fd) { return fd >= RELAY_FD_BASE; }
+        /**
+         * @brief Writes a message to a client's channel, directly or through 
+         * its proxy's link.
+         * 
+         * @param fd The channel's (possibly virtual) file descriptor.
+         * @param data The message.
+         * @param size The size of the message.
+         * @param flags Flags for send().
+         * @return int 0 if the message was written or queued for the link, else -1.
+         */
+        int write_channel(int fd, const char* data, std::size_t size, int flags);
+        /**
+         * @brief Queues a frame for a relayed channel, to be sent to its proxy 
+         * by flush_relays().
+         * 
+         * @param fd The channel's virtual file descriptor.
+         * @param frame The frame, whose channel is filled in.
+         * @return true if the channel's link is still open.
+         */
+        bool relay_frame(int fd, nsb::nsbm::Relay::Frame frame);
+        /**
+         * @brief Handles bytes read from a relay link, handling the messages of
+         * each complete envelope on the data plane.
+         * 
+         * @param link_fd The link's file descriptor.
+         * @param data The bytes read.
+         * @param size How many bytes were read.
+         * @return true if the link is intact, false if it must be closed.
+         */
+        bool handle_relay(int link_fd, const char* data, std::size_t size);
+        /**
+         * @brief Closes a relay link, detaching all of its channels.
+         * 
+         * Called by the data plane only.
+         * 
+         * @param link_fd The link's file descriptor.
+         */
+        void close_relay(int link_fd);
+        /**
+         * @brief Sends the frames queued for each relay link as one envelope 
+         * per link.
+         */
+        void flush_relays();
+        /**
+         * @brief Opens the datagram server socket on the configured port.
+         * 
+         * @return int The datagram server file descriptor, or -1 on failure.
+         */
+        int open_datagram_server();
+        /**
+         * @brief Receives and handles all pending datagrams.
+         * 
+         * Datagrams are read in batches of up to DGRAM_BATCH_SIZE (with 
+         * recvmmsg() where available), and each is passed on to 
+         * handle_datagram() as a complete message.
+         */
+        void receive_datagrams();
+        /**
+         * @brief Handles a datagram if it is a SEND or POST message from the 
+         * datagram channel of a registered client.
+         * 
+         * Datagrams are unauthenticated and unconnected, so all other 
+         * operations, and datagrams from any other address, are dropped. An 
+         * accepted message is handled as if it had arrived on the client's 
+         * SEND channel, where any response is sent. SEND datagrams are dropped
+         * while that channel is paused, as they cannot be held back.
+         * 
+         * @param from The address the datagram was sent from.
+         * @param data The datagram.
+         * @param size The size of the datagram.
+         */
+        void handle_datagram(const sockaddr_in& from, const char* data, std::size_t size);
+        /**
+         * @brief Queues a message to be forwarded to a client as a datagram.
+         * 
+         * @param target The client to forward the message to.
+         * @param message The message to forward.
+         * @return true if the message was queued, false if the client has no 
+         *         datagram channel or the message is too large for one datagram.
+         */
+        bool queue_datagram(const ClientDetails& target, nsb::nsbm* message);
+        /**
+         * @brief Sends all queued datagrams in batches.
+         * 
+         * Uses sendmmsg() where available, so that messages forwarded within 
+         * one server loop iteration cost a single system call per batch.
+         */
+        void flush_datagrams();
+        /**
+         * @brief Generates a new random session token.
+         * 
+         * @return std::string A 128-bit token in hexadecimal.
+         */
+        std::string generate_session_token();
+        /**
+         * @brief Cleans up after a client connection has been closed.
+         * 
+         * Removes the file descriptor from the lookups and marks the client 
+         * that owned it as detached, keeping its identity, session, and queued
+         * messages so that it can resume. The file descriptor is closed once
+         * the data plane can no longer be using an older lookup that refers 
+         * to it, so that its number is not reused under it.
+         * 
+         * Called by the control plane only.
+         * 
+         * @param fd The file descriptor that was disconnected.
+         */
+        void detach_fd(int fd);
+        /**
+         * @brief Removes clients that have been detached for longer than the 
+         * session timeout, along with any messages held for them.
+         */
+        void expire_sessions();
+        /**
+         * @brief Forwards a message to a client's RECV (or DGRAM) channel.
+         * 
+         * If the client is registered but currently detached, or the send 
+         * fails, the message is held in pending_forwards until it resumes.
+         * 
+         * @param lookup The lookup the client is registered in.
+         * @param key The client's key in the lookup.
+         * @param message The FORWARD message to send.
+         */
+        void forward(const Registry<ClientDetails>& lookup, const std::string& key, nsb::nsbm* message);
+        /**
+         * @brief Delivers any messages held for a client that has resumed.
+         * 
+         * @param key The client's key in its lookup.
+         * @param target The client's (new) details.
+         */
+        void flush_pending_forwards(const std::string& key, const ClientDetails& target);
+        /**
+         * @brief Sends a NOTIFY to every client whose doorbell is due.
+         * 
+         * Called once per server loop iteration, before the datagrams are 
+         * flushed, so that all messages queued during the iteration are 
+         * announced together. The NOTIFY carries polling hints with the 
+         * number of messages and payload bytes waiting, and is sent over the 
+         * client's DGRAM channel if possible, else its RECV channel. If the 
+         * database is in use, it also lists the keys of (up to 
+         * DOORBELL_MAX_KEYS of) the waiting payloads, so that the client can 
+         * prefetch them.
+         * 
+         * @see PayloadPrefetcher
+         */
+        void ring_doorbells();
+        /**
+         * @brief Rings the due doorbells of one buffer.
+         * 
+         * @param doorbells The doorbells of the buffer.
+         * @param buffer The buffer the messages are waiting in.
+         * @param arrivals The estimators for that buffer.
+         * @param lookup The lookup the requesting clients are registered in.
+         */
+        void ring_doorbells(Doorbells& doorbells, QueueBackend& buffer,
+                            const Registry<ArrivalEstimator>& arrivals, const Registry<ClientDetails>& lookup);
         /**
          * @brief A multiplexer to parse messages and redirect them to handlers.
          * 
@@ -184,8 +777,15 @@ namespace nsb {
          * If the operation is not understood, the server will respond with a negative 
          * PING message.
          * 
+         * A message for the other plane is handed off to it: a control message
+         * that arrived on a data channel is passed to the control plane, and a
+         * channel that carries a data message to the control plane is handed 
+         * over to the data plane along with the message.
+         * 
          * @param fd The file descriptor of the client connection.
-         * @param message The incoming message to parse and handle.
+         * @param data The incoming message to parse and handle.
+         * @param size The size of the incoming message.
+         * @param plane The plane of the calling thread.
          * 
          * @see start_server()
          * @see handle_ping()
@@ -193,8 +793,10 @@ namespace nsb {
          * @see handle_fetch()
          * @see handle_post()
          * @see handle_receive()
+         * @see handle_stats()
+         * @see handle_profile()
          */
-        void handle_message(int fd, std::vector<char> message);
+        void handle_message(int fd, const char* data, std::size_t size, Plane plane);
 
         /* Operation-specific handlers. */
 
@@ -205,6 +807,11 @@ namespace nsb {
          * the identifier of the client, its address, and its different channel port 
          * information. In response, it will pass on the configuration parameters to
          * the client so that they can be inherited across the NSB system.
+         * 
+         * Each client is issued a session token. A client that reconnects and 
+         * presents its token resumes its session: its new channels are bound to
+         * its existing registration and messages held for it are delivered. A 
+         * new client may also take over the identifier of a detached one.
          */
         void handle_init(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required);
         /**
@@ -229,16 +836,26 @@ namespace nsb {
          * will be pushed back in the transmission buffer where it will be ready to be 
          * fetched by the NSB Simulator Client.
          * 
+         * @param fd The file descriptor the message arrived on.
          * @param incoming_msg The incoming message that is being handled.
          * @param outgoing_msg A template message that can be used if a response is 
          *                     required.
          * @param response_required Whether or not a response is required and the 
          *                          outgoing message will be sent back to the client.
          * 
+         * If rate limiting is enabled, the message is first checked against the 
+         * sending client's limits, and the configured overflow action is taken 
+         * if they are exceeded. The sending client is the one registered with
+         * the SEND channel the message arrived on, whatever source the message
+         * claims (or the channel itself, if no client registered it). If the admission governor is throttling, the 
+         * client's SEND channel is paused until its next admission slot.
+         * 
          * @see MessageEntry
          * @see handle_fetch()
+         * @see RateLimiter
+         * @see AdmissionGovernor
          */
-        void handle_send(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required);
+        void handle_send(int fd, nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required);
         /**
          * @brief Handles FETCH messages from the NSB Simulator Client.
          * 
@@ -259,7 +876,10 @@ namespace nsb {
          * @param response_required Whether or not a response is required and the 
          *                          outgoing message will be sent back to the client.
          * 
+         * The response also carries polling hints for the requester.
+         * 
          * @see MessageEntry
+         * @see set_poll_hints()
          */
         void handle_fetch(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required);
         /**
@@ -280,6 +900,22 @@ namespace nsb {
          * @see handle_receive()
          */
         void handle_post(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required);
+        /**
+         * @brief Handles POST messages carrying a batch of verdicts.
+         * 
+         * Delivered messages are handled in one pass as in handle_post(): 
+         * buffered for receiving in PULL mode, or forwarded in PUSH mode. 
+         * Dropped and corrupted messages are counted and never delivered, and 
+         * any of their payloads still held in the database are deleted with a 
+         * single command.
+         * 
+         * @param incoming_msg The incoming message that is being handled.
+         * @param outgoing_msg A template message used to forward messages.
+         * @param response_required Always set to false.
+         * 
+         * @see NSBSimClient::postBatch()
+         */
+        void handle_post_batch(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required);
         /**
          * @brief Handles RECEIVE messages from the NSB Application Client.
          * 
@@ -300,9 +936,92 @@ namespace nsb {
          * @param response_required Whether or not a response is required and the 
          *                          outgoing message will be sent back to the client.
          * 
+         * The response also carries polling hints for the requester.
+         * 
          * @see MessageEntry
+         * @see set_poll_hints()
          */
         void handle_receive(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required);
+        /**
+         * @brief Handles FETCH and RECEIVE messages requesting a batch.
+         * 
+         * Up to max_batch matching messages (all of them if negative) are 
+         * taken out of the buffer, oldest first, and returned together in the
+         * response's batch, followed by polling hints. If nothing remains 
+         * queued for the requester and it asked for it, its doorbell is armed;
+         * otherwise, it is disarmed.
+         * 
+         * @param buffer The buffer to take the messages from.
+         * @param arrivals The estimators for that buffer.
+         * @param doorbells The doorbells of that buffer.
+         * @param key The value to match, or "" for any message.
+         * @param requester The lookup key of the requesting client.
+         * @param incoming_msg The incoming request.
+         * @param outgoing_msg The response to populate.
+         * 
+         * @see NSBSimClient::fetchBatch()
+         * @see NSBAppClient::receiveBatch()
+         */
+        void handle_batch_request(QueueBackend& buffer, const Registry<ArrivalEstimator>& arrivals,
+                                  Doorbells& doorbells, const std::string& key, const std::string& requester,
+                                  nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg);
+        /**
+         * @brief Handles STATS messages.
+         * 
+         * This method populates the outgoing message with a StatsReport 
+         * containing the daemon's per-subsystem memory accounting, rate 
+         * limiting counters, and heaviest sources and destinations, so that 
+         * clients and tools can monitor where the daemon's memory and traffic 
+         * are going.
+         * 
+         * @param incoming_msg The incoming message that is being handled.
+         * @param outgoing_msg A template message that can be used if a response is 
+         *                     required.
+         * @param response_required Whether or not a response is required and the 
+         *                          outgoing message will be sent back to the client.
+         * 
+         * @see MemoryAccounting
+         * @see HeavyHitters
+         */
+        void handle_stats(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required);
+        /**
+         * @brief Handles PROFILE messages.
+         * 
+         * This method starts a time-boxed sampling profile of the daemon with 
+         * the requested duration, frequency, and file name in the profile 
+         * directory (falling back to the configured defaults), and responds at
+         * once with the parameters used. The profile is written when the 
+         * duration has passed, without pausing the server loop. A FAILURE code
+         * is returned if remote profiling is disabled, the file name is 
+         * refused, a profile is already in progress, or sampling is not 
+         * permitted.
+         * 
+         * @param incoming_msg The incoming message that is being handled.
+         * @param outgoing_msg A template message that can be used if a response is 
+         *                     required.
+         * @param response_required Whether or not a response is required and the 
+         *                          outgoing message will be sent back to the client.
+         * 
+         * @see SamplingProfiler
+         */
+        void handle_profile(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required);
+        /**
+         * @brief Handles RELAY messages from an NSB proxy.
+         * 
+         * A RELAY message opens a link on a new connection: the connection is 
+         * handed over to the data plane as a relay link, and from then on 
+         * carries envelopes of frames for the proxy's channels.
+         * 
+         * @param fd The file descriptor of the connection.
+         * @param incoming_msg The incoming message that is being handled.
+         * @param outgoing_msg A template message that can be used if a response is 
+         *                     required.
+         * @param response_required Whether or not a response is required and the 
+         *                          outgoing message will be sent back to the client.
+         * 
+         * @see RelayLink
+         */
+        void handle_relay_link(int fd, nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required);
     };
 }
 #endif // NSB_DAEMON_H
\ No newline at end of file
@@ -0,0 +1,129 @@
+// nsb_governor.h
+
+#ifndef NSB_GOVERNOR_H
+#define NSB_GOVERNOR_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace nsb {
+
+    /** @brief The least fraction of the drain rate the governor admits while throttling. */
+    const double GOVERNOR_MIN_ADMIT_FRACTION = 0.25;
+    /** @brief The multiple of the drain rate admitted for a while after throttling stops. */
+    const double GOVERNOR_PROBE_FACTOR = 1.1;
+    /** @brief How many intervals pacing continues after throttling stops. */
+    const int GOVERNOR_HOLD_INTERVALS = 16;
+
+    /**
+     * @brief Admission governor configuration parameters.
+     *
+     * These parameters are loaded from the _governor_ section of the
+     * configuration file and are only used by the daemon.
+     */
+    struct GovernorConfig {
+        bool ENABLED;
+        /** @brief The queueing delay, in milliseconds, that messages waiting to be fetched are kept under. */
+        double TARGET_MS;
+        /**
+         * @brief How long, in milliseconds, the queueing delay must stay above
+         * the target before SEND messages are paced; also the window over
+         * which the simulator's drain rate is measured.
+         */
+        double INTERVAL_MS;
+        /** @brief The longest, in milliseconds, a client's SEND channel is paused at once. */
+        double MAX_DELAY_MS;
+
+        /** @brief Blank constructor with the governor disabled. */
+        GovernorConfig() : ENABLED(false), TARGET_MS(5), INTERVAL_MS(100), MAX_DELAY_MS(1000) {}
+    };
+
+    /**
+     * @brief Closed-loop admission control of SEND traffic, paced to the
+     * simulator's drain rate.
+     *
+     * The governor follows CoDel: it measures the sojourn time of every
+     * message fetched from the transmission buffer, and once the sojourn has
+     * stayed above the target for a whole interval (a standing queue rather
+     * than a burst), it starts throttling. While throttling, SEND messages
+     * are admitted at a rate paced below the rate at which the simulator
+     * has been fetching, so that the excess queue drains within
+     * INTERVAL / sqrt(count), where count grows the longer the queue stands.
+     * Each sender is paused until its next admission slot. Throttling stops
+     * as soon as a message is fetched within the target, after which senders
+     * are still paced, slightly above the drain rate, for a few intervals:
+     * this keeps them from refilling the queue at once, while letting
+     * throughput follow a simulator that speeds up.
+     */
+    class AdmissionGovernor {
+    public:
+        using Clock = std::chrono::steady_clock;
+        /** @brief The governor's state, as reported in STATS. */
+        struct Status {
+            bool throttling = false;
+            /** @brief Messages per second fetched while the simulator was backlogged. */
+            double drain_rate = 0;
+            /** @brief Messages per second admitted (the drain rate unless throttling). */
+            double admit_rate = 0;
+            /** @brief The sojourn time of the last message fetched. */
+            int64_t sojourn_us = 0;
+            /** @brief How many times throttling has started. */
+            int64_t throttles = 0;
+            /** @brief How many SEND messages have paused their senders. */
+            int64_t paced = 0;
+        };
+        /** @brief Blank constructor for a disabled governor. */
+        AdmissionGovernor() : AdmissionGovernor(GovernorConfig()) {}
+        /** @brief Constructor for a new AdmissionGovernor with the given targets. */
+        AdmissionGovernor(const GovernorConfig& config);
+        /** @brief Whether or not the governor is enabled. */
+        bool enabled() const { return cfg.ENABLED; }
+        /**
+         * @brief Records a message fetched from the transmission buffer.
+         *
+         * @param queued When the message was queued.
+         * @param now When it was fetched.
+         */
+        void dequeued(Clock::time_point queued, Clock::time_point now);
+        /**
+         * @brief Paces a SEND message, which is always accepted.
+         *
+         * @param now When the message arrived.
+         * @return Clock::duration How long the sender's SEND channel should be
+         *         paused (zero unless throttling).
+         */
+        Clock::duration admit(Clock::time_point now);
+        /** @brief Gets the governor's state. */
+        Status status() const;
+    private:
+        /** @brief Closes the drain-rate window if an interval has passed. */
+        void roll(Clock::time_point now);
+        /** @brief Messages per second to admit while throttling. */
+        double admitRate() const;
+        GovernorConfig cfg;
+        Clock::duration target;
+        Clock::duration interval;
+        Clock::duration max_delay;
+        // CoDel state.
+        bool throttling = false;
+        /** @brief When the sojourn will have stayed above the target for an interval (zero if below). */
+        Clock::time_point first_above{};
+        /** @brief When the pacing is next tightened, by raising count. */
+        Clock::time_point next_tighten{};
+        int count = 0;
+        Clock::duration last_sojourn{};
+        /** @brief Until when senders are still paced after throttling stopped. */
+        Clock::time_point hold_until{};
+        // Drain rate measurement.
+        Clock::time_point window_start{};
+        int64_t window_dequeued = 0;
+        bool window_backlogged = false;
+        double drain_rate = 0;
+        // Pacing.
+        Clock::time_point next_slot{};
+        int64_t throttles = 0;
+        int64_t paced = 0;
+    };
+}
+
+#endif // NSB_GOVERNOR_H
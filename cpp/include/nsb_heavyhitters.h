@@ -0,0 +1,134 @@
+// nsb_heavyhitters.h
+
+#ifndef NSB_HEAVYHITTERS_H
+#define NSB_HEAVYHITTERS_H
+
+#include "nsb.h"
+
+#include <unordered_map>
+
+namespace nsb {
+
+    /** @brief The most rows a CountMinSketch may have. */
+    const int SKETCH_MAX_DEPTH = 8;
+    /** @brief How many messages are recorded between checks for decay. */
+    const int64_t HEAVY_HITTER_CLOCK_INTERVAL = 64;
+
+    /**
+     * @brief Configuration parameters for heavy-hitter tracking.
+     *
+     * These parameters are loaded from the _heavy_hitters_ section of the
+     * configuration file and are only used by the daemon.
+     */
+    struct HeavyHitterConfig {
+        bool ENABLED;
+        /** @brief How many of the heaviest keys are reported. */
+        int TOP_K;
+        /** @brief Counters per row of each sketch. */
+        int WIDTH;
+        /** @brief Rows (independent hashes) of each sketch, at most SKETCH_MAX_DEPTH. */
+        int DEPTH;
+        /** @brief Counts are halved this often, so that the report follows current traffic (0 never). */
+        double HALF_LIFE_SECONDS;
+
+        /** @brief Blank constructor tracking the top 10 keys over a one-minute half-life. */
+        HeavyHitterConfig() : ENABLED(true), TOP_K(10), WIDTH(2048), DEPTH(4), HALF_LIFE_SECONDS(60) {}
+    };
+
+    /**
+     * @brief A count-min sketch of weights by key hash.
+     *
+     * Estimates never undercount, and overcount by at most e/WIDTH of the
+     * total weight with probability 1 - e^-DEPTH. Updates are conservative
+     * (only the smallest counters are raised), which tightens the estimates
+     * of light keys considerably.
+     */
+    class CountMinSketch {
+    public:
+        CountMinSketch(int width, int depth);
+        /**
+         * @brief Adds weight to a key.
+         *
+         * @param hash The key's hash.
+         * @param weight The weight to add.
+         * @return int64_t The key's new estimated weight.
+         */
+        int64_t add(uint64_t hash, int64_t weight);
+        /** @brief Estimates a key's weight from its hash. */
+        int64_t estimate(uint64_t hash) const;
+        /** @brief Divides every counter by 2^shift. */
+        void decay(int shift);
+    private:
+        std::size_t width;
+        std::size_t depth;
+        std::vector<int64_t> counters;
+        /** @brief Gets the counter of a key in a row. */
+        std::size_t slot(uint64_t hash, std::size_t row) const;
+    };
+
+    /**
+     * @brief Streaming detection of the keys that carry the most traffic.
+     *
+     * Every message is recorded against a key (such as its source) with
+     * its size. Messages and bytes are counted in a CountMinSketch each,
+     * and the TOP_K keys with the highest estimates of each are kept as
+     * candidates, so that memory stays constant however many keys are
+     * seen, and recording a message costs a few hash lookups. All counts
+     * decay by half every HALF_LIFE_SECONDS, so the top keys reflect
+     * recent traffic.
+     */
+    class HeavyHitters {
+    public:
+        /** @brief A heavy key with its estimated messages and bytes. */
+        struct Entry {
+            std::string key;
+            int64_t messages;
+            int64_t bytes;
+        };
+        explicit HeavyHitters(HeavyHitterConfig config = HeavyHitterConfig());
+        /** @brief Checks whether tracking is enabled. */
+        bool enabled() const { return config.ENABLED; }
+        /**
+         * @brief Records a message.
+         *
+         * @param key The key to count the message against.
+         * @param bytes The size of the message's payload.
+         */
+        void record(const std::string& key, int64_t bytes);
+        /**
+         * @brief Gets the heaviest keys, heaviest first.
+         *
+         * @param by_bytes Whether to rank keys by bytes rather than messages.
+         * @return std::vector<Entry> Up to TOP_K keys.
+         */
+        std::vector<Entry> top(bool by_bytes) const;
+        /** @brief Gets the (decayed) number of messages recorded. */
+        int64_t totalMessages() const { return total_messages; }
+        /** @brief Gets the (decayed) number of bytes recorded. */
+        int64_t totalBytes() const { return total_bytes; }
+    private:
+        /** @brief The keys with the highest estimates seen, and their estimates. */
+        struct Candidates {
+            std::unordered_map<std::string, int64_t> counts;
+            /** @brief A lower bound on the smallest estimate held. */
+            int64_t floor = 0;
+            /** @brief Offers a key with its new estimate. */
+            void offer(const std::string& key, int64_t estimate, std::size_t capacity);
+        };
+        HeavyHitterConfig config;
+        CountMinSketch message_sketch;
+        CountMinSketch byte_sketch;
+        Candidates message_candidates;
+        Candidates byte_candidates;
+        int64_t total_messages;
+        int64_t total_bytes;
+        /** @brief Number of messages ever recorded (not decayed). */
+        int64_t records;
+        /** @brief When counts were last halved. */
+        std::chrono::steady_clock::time_point last_decay;
+        /** @brief Halves all counts once per half-life elapsed. */
+        void decay(std::chrono::steady_clock::time_point now);
+    };
+}
+
+#endif // NSB_HEAVYHITTERS_H
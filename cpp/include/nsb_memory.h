@@ -0,0 +1,172 @@
+// nsb_memory.h
+
+#ifndef NSB_MEMORY_H
+#define NSB_MEMORY_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace nsb {
+
+    /**
+     * @brief Subsystem tags used for memory accounting.
+     *
+     * Each tag owns its own set of counters in MemoryAccounting, so memory
+     * usage can be broken down by where it is held in the daemon.
+     */
+    enum class MemoryTag {
+        /** @brief Nodes of the transmission and reception buffers. */
+        QUEUE = 0,
+        /** @brief Payloads (or payload keys) held in queued entries. */
+        PAYLOAD = 1,
+        /** @brief Parsed Protobuf messages being handled. */
+        PROTOBUF = 2,
+        /** @brief Socket read and response buffers. */
+        CONNECTION = 3,
+        /** @brief Client and file descriptor lookup tables. */
+        REGISTRY = 4,
+        /** @brief Number of tags; not a tag itself. */
+        COUNT = 5
+    };
+
+    /**
+     * @brief Process-wide, per-tag memory counters.
+     *
+     * Counters are updated with relaxed atomics so that accounting stays
+     * cheap enough to be left on. Allocations can be recorded either through
+     * the TaggedAllocator on standard containers, or explicitly with record()
+     * and release() for memory that is not owned by a container (like
+     * payload strings and Protobuf objects).
+     *
+     * @see TaggedAllocator
+     */
+    class MemoryAccounting {
+    public:
+        /** @brief A point-in-time copy of the counters for a single tag. */
+        struct Snapshot {
+            /** @brief Bytes currently held. */
+            int64_t bytes;
+            /** @brief Highest number of bytes held at once. */
+            int64_t peak_bytes;
+            /** @brief Total number of allocations made. */
+            int64_t allocations;
+            /** @brief Total number of bytes ever allocated. */
+            int64_t total_bytes;
+            /** @brief Allocations that have not yet been released. */
+            int64_t live_allocations;
+        };
+        /**
+         * @brief Records an allocation of the given size under a tag.
+         *
+         * @param tag The subsystem the memory belongs to.
+         * @param size The number of bytes allocated.
+         */
+        static void record(MemoryTag tag, std::size_t size) {
+            Counters& c = counters()[static_cast<std::size_t>(tag)];
+            int64_t now = c.bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed)
+                          + static_cast<int64_t>(size);
+            c.allocations.fetch_add(1, std::memory_order_relaxed);
+            c.total_bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+            c.live_allocations.fetch_add(1, std::memory_order_relaxed);
+            // Raise the peak if this allocation exceeded it.
+            int64_t peak = c.peak_bytes.load(std::memory_order_relaxed);
+            while (now > peak && !c.peak_bytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+        }
+        /**
+         * @brief Records the release of a previously recorded allocation.
+         *
+         * @param tag The subsystem the memory belonged to.
+         * @param size The number of bytes released.
+         */
+        static void release(MemoryTag tag, std::size_t size) {
+            Counters& c = counters()[static_cast<std::size_t>(tag)];
+            c.bytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+            c.live_allocations.fetch_sub(1, std::memory_order_relaxed);
+        }
+        /**
+         * @brief Gets a copy of the counters for a tag.
+         *
+         * @param tag The subsystem to report on.
+         * @return Snapshot The current counter values.
+         */
+        static Snapshot snapshot(MemoryTag tag) {
+            const Counters& c = counters()[static_cast<std::size_t>(tag)];
+            return Snapshot{
+                c.bytes.load(std::memory_order_relaxed),
+                c.peak_bytes.load(std::memory_order_relaxed),
+                c.allocations.load(std::memory_order_relaxed),
+                c.total_bytes.load(std::memory_order_relaxed),
+                c.live_allocations.load(std::memory_order_relaxed)
+            };
+        }
+        /**
+         * @brief Helper function to get the tag name with enumerated value.
+         *
+         * @param tag The tag enumeration.
+         * @return std::string The name of the tag.
+         */
+        static std::string tagName(MemoryTag tag) {
+            switch (tag) {
+                case MemoryTag::QUEUE:      return "QUEUE";
+                case MemoryTag::PAYLOAD:    return "PAYLOAD";
+                case MemoryTag::PROTOBUF:   return "PROTOBUF";
+                case MemoryTag::CONNECTION: return "CONNECTION";
+                case MemoryTag::REGISTRY:   return "REGISTRY";
+                default:                    return "UNKNOWN";
+            }
+        }
+    private:
+        struct Counters {
+            std::atomic<int64_t> bytes{0};
+            std::atomic<int64_t> peak_bytes{0};
+            std::atomic<int64_t> allocations{0};
+            std::atomic<int64_t> total_bytes{0};
+            std::atomic<int64_t> live_allocations{0};
+        };
+        static std::array<Counters, static_cast<std::size_t>(MemoryTag::COUNT)>& counters() {
+            static std::array<Counters, static_cast<std::size_t>(MemoryTag::COUNT)> instance;
+            return instance;
+        }
+    };
+
+    /**
+     * @brief Standard allocator that accounts its allocations under a tag.
+     *
+     * This is a drop-in replacement for std::allocator that can be used with
+     * standard containers to attribute their memory to a subsystem.
+     *
+     * @tparam T The allocated type.
+     * @tparam Tag The MemoryTag to account allocations under.
+     */
+    template <typename T, MemoryTag Tag>
+    class TaggedAllocator {
+    public:
+        using value_type = T;
+        template <typename U>
+        struct rebind { using other = TaggedAllocator<U, Tag>; };
+
+        TaggedAllocator() noexcept = default;
+        template <typename U>
+        TaggedAllocator(const TaggedAllocator<U, Tag>&) noexcept {}
+
+        T* allocate(std::size_t n) {
+            T* ptr = std::allocator<T>().allocate(n);
+            MemoryAccounting::record(Tag, n * sizeof(T));
+            return ptr;
+        }
+        void deallocate(T* ptr, std::size_t n) noexcept {
+            MemoryAccounting::release(Tag, n * sizeof(T));
+            std::allocator<T>().deallocate(ptr, n);
+        }
+        template <typename U>
+        bool operator==(const TaggedAllocator<U, Tag>&) const noexcept { return true; }
+        template <typename U>
+        bool operator!=(const TaggedAllocator<U, Tag>&) const noexcept { return false; }
+    };
+}
+
+#endif // NSB_MEMORY_H
@@ -0,0 +1,191 @@
+// nsb_metrics.h
+
+#ifndef NSB_METRICS_H
+#define NSB_METRICS_H
+
+#include "nsb.h"
+
+namespace nsb {
+
+    /**
+     * @brief A histogram of latencies with bounded relative error.
+     *
+     * Latencies (in nanoseconds) are counted in buckets whose width is an
+     * eighth of their lower bound, so that percentiles are accurate to
+     * within about 6% across every scale from nanoseconds to hours, with a
+     * fixed 4 KiB of counters. Recording is lock-free, so a histogram may
+     * be read while it is being recorded into.
+     */
+    class LatencyHistogram {
+    public:
+        /** @brief log2 of the number of buckets per power of two. */
+        static const int SUB_BUCKET_BITS = 3;
+        static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        static const int BUCKETS = (63 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+        LatencyHistogram() { reset(); }
+        /** @brief Records a latency (negative latencies are counted as 0). */
+        void record(int64_t nanoseconds);
+        /** @brief Gets the number of latencies recorded. */
+        int64_t count() const { return total.load(std::memory_order_relaxed); }
+        /** @brief Gets the sum of the latencies recorded. */
+        int64_t sum() const { return sum_ns.load(std::memory_order_relaxed); }
+        /** @brief Gets the smallest latency recorded (0 if none). */
+        int64_t min() const;
+        /** @brief Gets the largest latency recorded (0 if none). */
+        int64_t max() const { return max_ns.load(std::memory_order_relaxed); }
+        /**
+         * @brief Estimates a percentile of the latencies recorded.
+         *
+         * @param quantile The percentile, between 0 and 1 (e.g., 0.99).
+         * @return int64_t The latency in nanoseconds (0 if none were recorded).
+         */
+        int64_t percentile(double quantile) const;
+        /** @brief Forgets every latency recorded. */
+        void reset();
+    private:
+        std::array<std::atomic<int64_t>, BUCKETS> counts;
+        std::atomic<int64_t> total;
+        std::atomic<int64_t> sum_ns;
+        std::atomic<int64_t> min_ns;
+        std::atomic<int64_t> max_ns;
+        /** @brief Gets the bucket a latency is counted in. */
+        static int bucket(int64_t nanoseconds);
+        /** @brief Gets the smallest latency counted in a bucket. */
+        static int64_t lowerBound(int bucket);
+    };
+
+    /** @brief What the client measures: whole operations, then their steps. */
+    enum class ClientMetric {
+        /** @brief NSBAppClient::send(). */
+        SEND = 0,
+        /** @brief NSBAppClient::receive(). */
+        RECEIVE = 1,
+        /** @brief NSBAppClient::receiveBatch(). */
+        RECEIVE_BATCH = 2,
+        /** @brief NSBSimClient::fetch() and collectFetch(). */
+        FETCH = 3,
+        /** @brief NSBSimClient::fetchBatch(). */
+        FETCH_BATCH = 4,
+        /** @brief NSBSimClient::post(). */
+        POST = 5,
+        /** @brief NSBSimClient::postBatch(). */
+        POST_BATCH = 6,
+        /** @brief Serializing outgoing messages. */
+        SERIALIZE = 7,
+        /** @brief Parsing incoming messages. */
+        PARSE = 8,
+        /** @brief Writing messages to the daemon's sockets. */
+        SOCKET_WRITE = 9,
+        /** @brief Round trips from sending a request to the daemon's response. */
+        DAEMON_RTT = 10,
+        /** @brief Storing payloads in the database (once per batch). */
+        DB_STORE = 11,
+        /** @brief Checking out (or peeking at) payloads in the database, or taking them when prefetched. */
+        DB_CHECKOUT = 12,
+        /** @brief Number of metrics; not a metric itself. */
+        COUNT = 13
+    };
+
+    /**
+     * @brief Per-client counters and latency histograms for each operation
+     * and each of its steps.
+     *
+     * Each metric counts how often it was measured, how many of those
+     * failed, timed out, or found nothing (such as a poll with no message),
+     * alongside a LatencyHistogram of how long each took, so that it shows
+     * whether time goes to the application, the bridge, or the database.
+     *
+     * @see MetricTimer
+     */
+    class ClientMetrics {
+    public:
+        /** @brief How a measured operation or step ended. */
+        enum class Outcome {
+            OK = 0,
+            ERROR = 1,
+            TIMEOUT = 2,
+            EMPTY = 3
+        };
+        /** @brief A summary of one metric. */
+        struct Snapshot {
+            std::string name;
+            int64_t count = 0;
+            int64_t errors = 0;
+            int64_t timeouts = 0;
+            int64_t empty = 0;
+            int64_t total_ns = 0;
+            int64_t min_ns = 0;
+            int64_t max_ns = 0;
+            int64_t p50_ns = 0;
+            int64_t p90_ns = 0;
+            int64_t p99_ns = 0;
+            int64_t p999_ns = 0;
+        };
+        /** @brief Gets the name of a metric. */
+        static std::string metricName(ClientMetric metric);
+        /** @brief Checks whether measurements are being recorded. */
+        bool enabled() const { return isEnabled.load(std::memory_order_relaxed); }
+        /** @brief Sets whether measurements are recorded. */
+        void setEnabled(bool enable) { isEnabled.store(enable, std::memory_order_relaxed); }
+        /**
+         * @brief Records a measurement.
+         *
+         * @param metric What was measured.
+         * @param elapsed How long it took.
+         * @param outcome How it ended.
+         */
+        void record(ClientMetric metric, std::chrono::steady_clock::duration elapsed, Outcome outcome);
+        /** @brief Summarizes one metric. */
+        Snapshot snapshot(ClientMetric metric) const;
+        /** @brief Summarizes every metric measured at least once. */
+        std::vector<Snapshot> snapshots() const;
+        /** @brief Forgets every measurement. */
+        void reset();
+    private:
+        struct Counters {
+            LatencyHistogram latency;
+            std::atomic<int64_t> errors{0};
+            std::atomic<int64_t> timeouts{0};
+            std::atomic<int64_t> empty{0};
+        };
+        std::array<Counters, static_cast<std::size_t>(ClientMetric::COUNT)> counters;
+        std::atomic<bool> isEnabled{true};
+    };
+
+    /**
+     * @brief Measures a scope and records it in a ClientMetrics when it ends.
+     *
+     * The outcome is OK unless set otherwise before the scope ends.
+     *
+     * @code{.cpp}
+     * MetricTimer timer(metrics, ClientMetric::RECEIVE);
+     * if (response.empty()) {
+     *     timer.setOutcome(ClientMetrics::Outcome::TIMEOUT);
+     *     return MessageEntry();
+     * }
+     * @endcode
+     */
+    class MetricTimer {
+    public:
+        MetricTimer(ClientMetrics& metrics, ClientMetric metric) : metrics(metrics), metric(metric),
+            outcome(ClientMetrics::Outcome::OK),
+            start(metrics.enabled() ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {}
+        ~MetricTimer() {
+            if (start.time_since_epoch().count() != 0) {
+                metrics.record(metric, std::chrono::steady_clock::now() - start, outcome);
+            }
+        }
+        MetricTimer(const MetricTimer&) = delete;
+        MetricTimer& operator=(const MetricTimer&) = delete;
+        /** @brief Sets how the measured scope ended. */
+        void setOutcome(ClientMetrics::Outcome result) { outcome = result; }
+    private:
+        ClientMetrics& metrics;
+        ClientMetric metric;
+        ClientMetrics::Outcome outcome;
+        std::chrono::steady_clock::time_point start;
+    };
+}
+
+#endif // NSB_METRICS_H
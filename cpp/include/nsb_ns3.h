@@ -0,0 +1,374 @@
+// nsb_ns3.h
+
+#ifndef NSB_NS3_H
+#define NSB_NS3_H
+
+/*
+ * Helpers for integrating NSB with ns-3.
+ *
+ * This header is not compiled into the NSB library, as the library does not
+ * depend on ns-3; it is installed alongside the other headers and compiled as
+ * part of ns-3 programs that include it.
+ */
+
+#include "nsb_client.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include <poll.h>
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+namespace nsb {
+
+    /**
+     * @brief Two-way mapping between NSB identifiers and ns-3 nodes.
+     *
+     * Each NSB identifier is mapped to the ns-3 node that represents it and,
+     * optionally, the IPv4 address packets for it should be sent to. Lookups in
+     * either direction (identifier to node or address, and node or address to
+     * identifier) are constant-time hash map lookups, so identifiers do not
+     * need to encode node indices or addresses.
+     */
+    class Ns3NodeMap {
+    public:
+        /**
+         * @brief Maps an NSB identifier to a node and its address.
+         *
+         * @param id The NSB identifier.
+         * @param node The node that represents it in the simulation.
+         * @param address The address packets for the identifier are sent to.
+         */
+        void add(const std::string& id, ns3::Ptr<ns3::Node> node,
+                 ns3::Ipv4Address address = ns3::Ipv4Address()) {
+            byId[id] = Entry{node, address};
+            idByNode[node->GetId()] = id;
+            if (!address.IsAny()) {
+                idByAddress[address] = id;
+            }
+        }
+        /**
+         * @brief Gets the node for an identifier.
+         *
+         * @return ns3::Ptr<ns3::Node> The node, or nullptr if not mapped.
+         */
+        ns3::Ptr<ns3::Node> getNode(const std::string& id) const {
+            auto it = byId.find(id);
+            return it != byId.end() ? it->second.node : nullptr;
+        }
+        /**
+         * @brief Gets the address for an identifier.
+         *
+         * @return ns3::Ipv4Address The address, or the any-address if not mapped.
+         */
+        ns3::Ipv4Address getAddress(const std::string& id) const {
+            auto it = byId.find(id);
+            return it != byId.end() ? it->second.address : ns3::Ipv4Address();
+        }
+        /**
+         * @brief Gets the identifier for a node.
+         *
+         * @return std::string The identifier, or "" if not mapped.
+         */
+        std::string getId(ns3::Ptr<ns3::Node> node) const {
+            auto it = idByNode.find(node->GetId());
+            return it != idByNode.end() ? it->second : "";
+        }
+        /**
+         * @brief Gets the identifier for an address.
+         *
+         * @return std::string The identifier, or "" if not mapped.
+         */
+        std::string getId(const ns3::Ipv4Address& address) const {
+            auto it = idByAddress.find(address);
+            return it != idByAddress.end() ? it->second : "";
+        }
+    private:
+        struct Entry {
+            ns3::Ptr<ns3::Node> node;
+            ns3::Ipv4Address address;
+        };
+        std::unordered_map<std::string, Entry> byId;
+        std::unordered_map<uint32_t, std::string> idByNode;
+        std::unordered_map<ns3::Ipv4Address, std::string, ns3::Ipv4AddressHash> idByAddress;
+    };
+
+    /**
+     * @brief Pool of persistent UDP sockets for injecting payloads.
+     *
+     * Instead of creating, connecting, and closing a socket for every payload,
+     * each node is given one bound UDP socket on first use, which is then
+     * reused to send to any destination.
+     */
+    class Ns3SocketPool {
+    public:
+        /**
+         * @brief Constructor for a new Ns3SocketPool.
+         *
+         * @param port The destination port payloads are sent to.
+         */
+        Ns3SocketPool(uint16_t port=5000) : port(port) {}
+        ~Ns3SocketPool() { close(); }
+        /**
+         * @brief Gets the injection socket for a node, creating it if needed.
+         *
+         * @param node The node to send from.
+         * @return ns3::Ptr<ns3::Socket> The node's injection socket.
+         */
+        ns3::Ptr<ns3::Socket> get(ns3::Ptr<ns3::Node> node) {
+            auto it = sockets.find(node->GetId());
+            if (it != sockets.end()) {
+                return it->second;
+            }
+            ns3::Ptr<ns3::Socket> socket = ns3::Socket::CreateSocket(node, ns3::UdpSocketFactory::GetTypeId());
+            socket->Bind();
+            sockets.emplace(node->GetId(), socket);
+            return socket;
+        }
+        /**
+         * @brief Sends a payload from a node to an address.
+         *
+         * @param node The node to send from.
+         * @param destination The address to send to.
+         * @param payload The payload to send.
+         * @return bool True if the packet was handed to the socket.
+         */
+        bool send(ns3::Ptr<ns3::Node> node, ns3::Ipv4Address destination, const std::string& payload) {
+            ns3::Ptr<ns3::Packet> packet = ns3::Create<ns3::Packet>(
+                reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+            return get(node)->SendTo(packet, 0, ns3::InetSocketAddress(destination, port)) >= 0;
+        }
+        /** @brief Closes all sockets in the pool. */
+        void close() {
+            for (auto& [id, socket] : sockets) {
+                socket->Close();
+            }
+            sockets.clear();
+        }
+        /** @brief Gets the destination port payloads are sent to. */
+        uint16_t getPort() const { return port; }
+    private:
+        uint16_t port;
+        std::unordered_map<uint32_t, ns3::Ptr<ns3::Socket>> sockets;
+    };
+
+    /**
+     * @brief Event-driven bridge between an NSB simulator client and ns-3.
+     *
+     * When ns-3 runs with the RealtimeSimulatorImpl, a listener thread waits
+     * -- for the client's RECV or DGRAM descriptor to become readable in PUSH
+     * mode, or on the wall clock as an AdaptivePoller suggests in PULL mode --
+     * and wakes the simulator with ScheduleRealtimeNowWithContext(), so no 
+     * polling events are scheduled in simulation time. With other simulator
+     * implementations, the bridge falls back to polling events in simulation
+     * time paced by an AdaptivePoller.
+     *
+     * Fetched payloads are injected from the source's node to the
+     * destination's address through an Ns3SocketPool, unless a delivery
+     * callback is set. Packets arriving at receivers installed with
+     * installReceiver() are posted back to NSB.
+     *
+     * The client is not thread-safe (its channels, database connection, and
+     * reconnection are shared), so the listener thread never calls into it:
+     * fetching, like posting, always happens on the simulator thread, and 
+     * the listener waits for each fetch to finish before waiting again.
+     *
+     * @code
+     * Ns3NodeMap nodeMap;
+     * nodeMap.add("node0", nodes.Get(0), Ipv4Address("10.1.1.1"));
+     * Ns3Bridge bridge(simClient, nodeMap);
+     * bridge.installReceiver(nodes.Get(0));
+     * bridge.start();
+     * Simulator::Run();
+     * bridge.stop();
+     * @endcode
+     */
+    class Ns3Bridge {
+    public:
+        /** @brief Callback used to deliver fetched payloads into the simulation. */
+        using DeliverCallback = std::function<void(const MessageEntry&)>;
+        /**
+         * @brief Constructor for a new Ns3Bridge.
+         *
+         * @param client The simulator client to fetch and post payloads with.
+         * @param nodeMap The mapping between NSB identifiers and nodes.
+         * @param port The port payloads are sent to and received on.
+         */
+        Ns3Bridge(std::shared_ptr<NSBSimClient> client, const Ns3NodeMap& nodeMap, uint16_t port=5000)
+            : client(std::move(client)), nodeMap(nodeMap), pool(port), poller(0.001, 1.0) {}
+        ~Ns3Bridge() { stop(); }
+        /**
+         * @brief Replaces the default delivery through the socket pool.
+         *
+         * @param callback Called in simulation context for each fetched payload.
+         */
+        void setDeliverCallback(DeliverCallback callback) { deliverCallback = std::move(callback); }
+        /**
+         * @brief Installs a UDP receiver on a node that posts arriving payloads.
+         *
+         * @param node The node to receive on.
+         */
+        void installReceiver(ns3::Ptr<ns3::Node> node) {
+            ns3::Ptr<ns3::Socket> socket = ns3::Socket::CreateSocket(node, ns3::UdpSocketFactory::GetTypeId());
+            socket->Bind(ns3::InetSocketAddress(ns3::Ipv4Address::GetAny(), pool.getPort()));
+            socket->SetRecvCallback(ns3::MakeCallback(&Ns3Bridge::receivePacket, this));
+            receivers.push_back(socket);
+        }
+        /**
+         * @brief Starts bringing fetched payloads into the simulation.
+         *
+         * This should be called before Simulator::Run(), after the simulator
+         * implementation has been selected.
+         */
+        void start() {
+            realtime = ns3::DynamicCast<ns3::RealtimeSimulatorImpl>(ns3::Simulator::GetImplementation());
+            recvFd = client->getFd(Comms::Channel::RECV);
+            dgramFd = client->getFd(Comms::Channel::DGRAM);
+            running = true;
+            if (realtime) {
+                listener = std::thread(&Ns3Bridge::listen, this);
+            } else {
+                ns3::Simulator::ScheduleNow(&Ns3Bridge::poll, this);
+            }
+        }
+        /** @brief Stops the listener thread and closes the bridge's sockets. */
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                running = false;
+            }
+            wake.notify_all();
+            if (listener.joinable()) {
+                listener.join();
+            }
+            for (ns3::Ptr<ns3::Socket>& socket : receivers) {
+                socket->Close();
+            }
+            receivers.clear();
+            pool.close();
+        }
+        /** @brief Gets the injection socket pool. */
+        Ns3SocketPool& getSocketPool() { return pool; }
+    private:
+        /** @brief Time in seconds the listener waits on the client before checking for stop(). */
+        static constexpr int LISTEN_TIMEOUT = 1;
+        /** @brief Listener thread body, used with the RealtimeSimulatorImpl. */
+        void listen() {
+            while (running) {
+                if (client->getConfig().SYSTEM_MODE == Config::SystemMode::PULL) {
+                    // Wait on the wall clock as the daemon suggests.
+                    std::unique_lock<std::mutex> lock(mtx);
+                    wake.wait_for(lock, std::chrono::duration<double>(pollDelay.load()), [this] { return !running; });
+                } else {
+                    // Wait for a forwarded message (a closed channel is left to fetch() to reconnect).
+                    pollfd fds[2] = {{recvFd, POLLIN, 0}, {dgramFd, POLLIN, 0}};
+                    int ready = ::poll(fds, 2, LISTEN_TIMEOUT * 1000);
+                    if (ready < 0 || (ready == 0 && recvFd >= 0)) {
+                        continue;
+                    }
+                }
+                // Have the simulator thread fetch, and wait until it has.
+                std::unique_lock<std::mutex> lock(mtx);
+                if (!running) {
+                    break;
+                }
+                drainPending = true;
+                realtime->ScheduleRealtimeNowWithContext(ns3::Simulator::NO_CONTEXT,
+                                                         ns3::MakeEvent(&Ns3Bridge::drain, this));
+                wake.wait(lock, [this] { return !drainPending || !running; });
+            }
+        }
+        /** @brief Fetches and delivers what is ready, on the simulator thread (with the RealtimeSimulatorImpl). */
+        void drain() {
+            if (running) {
+                // In PUSH mode, only read what has already arrived.
+                bool pull = client->getConfig().SYSTEM_MODE == Config::SystemMode::PULL;
+                MessageEntry entry = pull ? client->fetch() : client->fetch(nullptr, 0);
+                pollDelay = poller.update(entry, client->pollHints());
+                while (entry.exists()) {
+                    ns3::Ptr<ns3::Node> source = nodeMap.getNode(entry.source);
+                    uint32_t context = source ? source->GetId() : ns3::Simulator::NO_CONTEXT;
+                    ns3::Simulator::ScheduleWithContext(context, ns3::Seconds(0), &Ns3Bridge::deliver, this, entry);
+                    entry = pull ? client->fetch() : client->fetch(nullptr, 0);
+                    pollDelay = poller.update(entry, client->pollHints());
+                }
+                // Fetching may have reconnected the client.
+                recvFd = client->getFd(Comms::Channel::RECV);
+                dgramFd = client->getFd(Comms::Channel::DGRAM);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                drainPending = false;
+            }
+            wake.notify_all();
+        }
+        /** @brief Polling event body, used with other simulator implementations. */
+        void poll() {
+            if (!running) {
+                return;
+            }
+            // Drain everything available before scheduling the next poll.
+            MessageEntry entry = client->fetch();
+            double delay = poller.update(entry, client->pollHints());
+            while (entry.exists()) {
+                deliver(entry);
+                entry = client->fetch();
+                delay = poller.update(entry, client->pollHints());
+            }
+            ns3::Simulator::Schedule(ns3::Seconds(delay), &Ns3Bridge::poll, this);
+        }
+        /** @brief Injects a fetched payload into the simulation. */
+        void deliver(MessageEntry entry) {
+            if (deliverCallback) {
+                deliverCallback(entry);
+                return;
+            }
+            ns3::Ptr<ns3::Node> source = nodeMap.getNode(entry.source);
+            ns3::Ipv4Address destination = nodeMap.getAddress(entry.destination);
+            if (!source || destination.IsAny()) {
+                LOG(WARNING) << "NS3: No node mapped for " << entry.source << " -> "
+                             << entry.destination << ", dropping payload." << std::endl;
+                return;
+            }
+            pool.send(source, destination, entry.payload_obj);
+        }
+        /** @brief Posts payloads arriving at a receiver back to NSB. */
+        void receivePacket(ns3::Ptr<ns3::Socket> socket) {
+            ns3::Address from;
+            ns3::Ptr<ns3::Packet> packet;
+            while ((packet = socket->RecvFrom(from))) {
+                std::string payload(packet->GetSize(), '\0');
+                packet->CopyData(reinterpret_cast<uint8_t*>(payload.data()), payload.size());
+                std::string srcId = nodeMap.getId(ns3::InetSocketAddress::ConvertFrom(from).GetIpv4());
+                std::string destId = nodeMap.getId(socket->GetNode());
+                client->post(srcId, destId, payload);
+            }
+        }
+        std::shared_ptr<NSBSimClient> client;
+        const Ns3NodeMap& nodeMap;
+        Ns3SocketPool pool;
+        AdaptivePoller poller;
+        DeliverCallback deliverCallback;
+        std::vector<ns3::Ptr<ns3::Socket>> receivers;
+        ns3::Ptr<ns3::RealtimeSimulatorImpl> realtime;
+        std::atomic<bool> running{false};
+        /** @brief The delay before the listener next has the daemon polled, in seconds. */
+        std::atomic<double> pollDelay{0.001};
+        /** @brief The client's descriptors the listener waits on, as of the last fetch. */
+        std::atomic<int> recvFd{-1};
+        std::atomic<int> dgramFd{-1};
+        /** @brief Whether the listener is waiting for drain() to run. */
+        bool drainPending = false;
+        std::thread listener;
+        std::mutex mtx;
+        std::condition_variable wake;
+    };
+}
+
+#endif // NSB_NS3_H
@@ -0,0 +1,135 @@
+// nsb_profiler.h
+
+#ifndef NSB_PROFILER_H
+#define NSB_PROFILER_H
+
+#include "nsb.h"
+
+#include <unordered_map>
+
+namespace nsb {
+
+    /** @brief The longest a single profile may run (milliseconds). */
+    const int PROFILER_MAX_DURATION_MS = 10 * 60 * 1000;
+    /** @brief The highest sampling frequency accepted (samples per second per thread). */
+    const int PROFILER_MAX_FREQUENCY_HZ = 10000;
+    /** @brief The deepest call chain recorded per sample. */
+    const int PROFILER_MAX_STACK_DEPTH = 127;
+
+    /**
+     * @brief Configuration parameters for the SamplingProfiler.
+     *
+     * These parameters are loaded from the _profiler_ section of the
+     * configuration file and are only used by the daemon.
+     */
+    struct ProfilerConfig {
+        /** @brief Whether SIGUSR2 starts a profile with the default parameters. */
+        bool SIGNAL;
+        /** @brief Whether clients may start profiles with PROFILE messages. */
+        bool REMOTE;
+        /** @brief Default length of a profile (milliseconds). */
+        int DURATION_MS;
+        /** @brief Default sampling frequency (samples per second per thread). */
+        int FREQUENCY_HZ;
+        /** @brief Directory that profiles are written to. */
+        std::string DIRECTORY;
+
+        /** @brief Blank constructor with ten-second profiles at 99 Hz, started by signal only. */
+        ProfilerConfig() : SIGNAL(true), REMOTE(false), DURATION_MS(10000), FREQUENCY_HZ(99), DIRECTORY(".") {}
+    };
+
+    /**
+     * @brief An on-demand, time-boxed sampling profiler for the running process.
+     *
+     * When started, a CPU-clock sampling event is opened with perf_event_open()
+     * on every thread of the process, so that the kernel records the call chain
+     * (by walking frame pointers) of whichever thread is on-CPU at the given
+     * frequency into a ring buffer per thread. A collector thread drains the
+     * ring buffers and, once the duration has passed (or the profiler is
+     * stopped), symbolizes the call chains and writes them as folded stacks,
+     * one "thread;outer;...;inner count" line per distinct stack, ready for
+     * flamegraph.pl, speedscope, or inferno.
+     *
+     * Only user-space frames are recorded, so profiling needs no more than
+     * kernel.perf_event_paranoid <= 2 (the default on most distributions).
+     * Symbols are resolved with dladdr(), so the executable should be linked
+     * with exported symbols (-rdynamic) and everything built with
+     * -fno-omit-frame-pointer for complete stacks (even then, a sample taken
+     * in a leaf function that sets up no frame skips its caller). Threads
+     * created after the profile starts are not sampled.
+     *
+     * @code{.cpp}
+     * nsb::SamplingProfiler profiler;
+     * std::string path = profiler.start(5000, 199);
+     * @endcode
+     */
+    class SamplingProfiler {
+    public:
+        explicit SamplingProfiler(ProfilerConfig config = ProfilerConfig());
+        /** @brief Stops any profile in progress, writing what has been collected. */
+        ~SamplingProfiler();
+        /**
+         * @brief Starts profiling every thread of the process.
+         *
+         * @param duration_ms How long to profile for (0 for the configured
+         *                    default), at most PROFILER_MAX_DURATION_MS.
+         * @param frequency_hz How often to sample each thread (0 for the
+         *                     configured default), at most PROFILER_MAX_FREQUENCY_HZ.
+         * @param name The name of the file in the configured directory to
+         *             write the folded stacks to ("" for one named after the
+         *             process and time). Names containing "/" or ".." are
+         *             refused.
+         * @return std::string The path the profile will be written to, or ""
+         *         if a profile is already in progress, the name is refused,
+         *         or sampling could not be set up.
+         */
+        std::string start(int duration_ms = 0, int frequency_hz = 0, const std::string& name = "");
+        /** @brief Ends the profile in progress early and writes it. */
+        void stop();
+        /** @brief Checks whether a profile is in progress. */
+        bool isRunning() const { return running; }
+        /** @brief Gets the configuration the profiler was created with. */
+        const ProfilerConfig& getConfig() const { return config; }
+    private:
+        /** @brief A sampling event and the ring buffer it writes into. */
+        struct Stream {
+            int fd;
+            pid_t tid;
+            void* ring;
+            std::size_t ring_size;
+        };
+        /** @brief A call chain, innermost frame first, with its thread's name. */
+        struct Stack {
+            std::string thread;
+            std::vector<uint64_t> frames;
+            bool operator==(const Stack& other) const {
+                return thread == other.thread && frames == other.frames;
+            }
+        };
+        struct StackHash {
+            std::size_t operator()(const Stack& stack) const;
+        };
+        ProfilerConfig config;
+        std::atomic<bool> running;
+        std::atomic<bool> stopping;
+        std::thread collector;
+        std::vector<Stream> streams;
+        /** @brief Thread names, by thread ID. */
+        std::unordered_map<pid_t, std::string> thread_names;
+        /** @brief Sample counts of each distinct stack. */
+        std::unordered_map<Stack, int64_t, StackHash> samples;
+        int64_t lost_samples;
+        /** @brief Opens a sampling event on one thread; returns false on failure. */
+        bool open(pid_t tid, int frequency_hz);
+        /** @brief Closes every sampling event. */
+        void close();
+        /** @brief Collects samples until the deadline or stop(), then writes them. */
+        void collect(std::chrono::steady_clock::time_point deadline, std::string path);
+        /** @brief Moves every record out of a stream's ring buffer. */
+        void drain(Stream& stream);
+        /** @brief Symbolizes the collected stacks and writes them in folded form. */
+        bool write(const std::string& path);
+    };
+}
+
+#endif // NSB_PROFILER_H
@@ -0,0 +1,145 @@
+// nsb_proxy.h
+
+#ifndef NSB_PROXY_H
+#define NSB_PROXY_H
+
+#include "nsb.h"
+#include "nsb_relay.h"
+
+namespace nsb {
+    /** @brief The size of the buffer the proxy reads sockets into. */
+    const int PROXY_BUFFER_SIZE = 65536;
+    /** @brief The longest the proxy waits, in milliseconds, for the daemon to accept its link. */
+    const int PROXY_HELLO_TIMEOUT_MS = 5000;
+    /** @brief The longest the proxy waits, in milliseconds, before reconnecting to the daemon. */
+    const int PROXY_MAX_BACKOFF_MS = 5000;
+    /** @brief The most bytes the proxy holds for a local channel that is not reading them. */
+    const std::size_t PROXY_MAX_PENDING_BYTES = 16 * 1024 * 1024;
+
+    /**
+     * @brief Proxy configuration parameters.
+     *
+     * The daemon's address and port are loaded from the _system_ section of
+     * the configuration file and the rest from its _proxy_ section.
+     */
+    struct ProxyConfig {
+        std::string DAEMON_ADDRESS;
+        int DAEMON_PORT;
+        /** @brief The path of the Unix domain socket that local clients connect to. */
+        std::string SOCKET_PATH;
+        /** @brief Whether or not envelopes are compressed in both directions. */
+        bool COMPRESS;
+
+        /** @brief Blank constructor with default values. */
+        ProxyConfig() : DAEMON_ADDRESS("127.0.0.1"), DAEMON_PORT(65432), SOCKET_PATH("/tmp/nsb_proxy.sock"),
+                        COMPRESS(false) {}
+    };
+
+    /**
+     * @brief A sidecar that relays many local clients to the daemon over one
+     * link.
+     *
+     * Clients on the same host connect their channels to the proxy's Unix
+     * domain socket (a server address of LOCAL_ADDRESS_PREFIX followed by the
+     * path) instead of to the daemon. The proxy keeps a single TCP connection
+     * to the daemon and, on every pass of its loop, bundles whatever its
+     * clients have written into one envelope, optionally compressed. The
+     * daemon sends its responses back the same way, and the proxy writes each
+     * to the channel it is meant for. To the daemon, each relayed channel is
+     * a connection of its own, so clients need no other changes.
+     *
+     * The proxy runs on a single thread, so it never blocks on a local 
+     * channel: what the daemon sends a channel is queued and written as the 
+     * channel accepts it, and a channel that falls PROXY_MAX_PENDING_BYTES 
+     * behind is closed.
+     *
+     * @see packRelay()
+     */
+    class NSBProxy {
+    public:
+        /**
+         * @brief Construct a new NSBProxy object.
+         *
+         * @param filename The path to the YAML configuration file.
+         */
+        NSBProxy(std::string filename);
+        /** @brief Destroy the NSBProxy object, closing all connections. */
+        ~NSBProxy();
+        /**
+         * @brief Start the proxy.
+         *
+         * Listens for local clients and relays them to the daemon until
+         * stopped, reconnecting to the daemon whenever the link is lost.
+         */
+        void start();
+        /** @brief Stops the proxy. */
+        void stop();
+        /** @brief Checks if the proxy is running. */
+        bool is_running() const;
+
+    private:
+        /** @brief A local client's channel. */
+        struct LocalChannel {
+            /** @brief The channel's identifier on the link. */
+            uint32_t id;
+            /** @brief Until when the daemon asked for the channel not to be read. */
+            std::chrono::steady_clock::time_point paused_until;
+            /** @brief What the daemon sent the channel that it has not accepted yet. */
+            std::string pending;
+        };
+        void configure(std::string filename);
+        /** @brief Opens the Unix domain socket that local clients connect to. */
+        bool open_listener();
+        /**
+         * @brief Connects to the daemon and opens the link.
+         *
+         * @return true if the daemon accepted the link, false otherwise.
+         */
+        bool connect_daemon();
+        /** @brief Closes the link to the daemon, along with every local channel. */
+        void drop_link();
+        /** @brief Accepts pending local channels. */
+        void accept_channels();
+        /**
+         * @brief Reads a local channel, queueing what it wrote as a frame.
+         *
+         * A channel that has closed is closed here too, and the daemon told.
+         */
+        void read_channel(int fd);
+        /**
+         * @brief Queues data for a local channel and writes as much of its 
+         * queue as it accepts without blocking.
+         *
+         * A channel that fails, or falls too far behind, is closed and the 
+         * daemon told.
+         */
+        void write_channel(int fd, const std::string& data);
+        /** @brief Closes a local channel, telling the daemon if asked to. */
+        void close_channel(int fd, bool notify);
+        /**
+         * @brief Reads envelopes from the daemon and hands their frames to the
+         * local channels.
+         *
+         * @return true if the link is still intact, false otherwise.
+         */
+        bool read_link();
+        /**
+         * @brief Sends the frames queued on this pass as one envelope.
+         *
+         * @return true if the envelope was sent (or there was nothing to send).
+         */
+        bool flush();
+        ProxyConfig cfg;
+        std::atomic<bool> running;
+        int listen_fd;
+        int link_fd;
+        RelayReader reader;
+        /** @brief Frames to send to the daemon in the next envelope. */
+        nsb::nsbm::Relay outgoing;
+        std::map<int, LocalChannel> channels;
+        /** @brief Local channels keyed by their identifier on the link. */
+        std::map<uint32_t, int> channel_fds;
+    };
+}
+
+#endif // NSB_PROXY_H
@@ -0,0 +1,236 @@
+// nsb_queue.h
+
+#ifndef NSB_QUEUE_H
+#define NSB_QUEUE_H
+
+#include "nsb.h"
+
+#include <memory>
+#include <set>
+
+namespace nsb {
+
+    /** @brief Buffer of message entries waiting to be fetched or received. */
+    using MessageQueue = std::list<MessageEntry, TaggedAllocator<MessageEntry, MemoryTag::QUEUE>>;
+
+    /**
+     * @brief Queue backend configuration parameters.
+     *
+     * These parameters are loaded from the _queue_ section of the
+     * configuration file and are only used by the daemon.
+     */
+    struct QueueConfig {
+        /**
+         * @brief Where the daemon keeps messages waiting to be fetched or
+         * received.
+         *
+         * *MEMORY* keeps them in the daemon's memory. *REDIS_STREAMS* keeps
+         * them in Redis Streams, so that they survive daemon restarts and may
+         * exceed the daemon's memory.
+         */
+        enum class Backend {
+            MEMORY = 0,
+            REDIS_STREAMS = 1
+        };
+        Backend BACKEND;
+        std::string REDIS_ADDRESS;
+        int REDIS_PORT;
+        /** @brief Prefix of the Redis keys, so that several systems can share an instance. */
+        std::string NAMESPACE;
+        /** @brief This daemon's consumer name within the consumer groups. */
+        std::string CONSUMER;
+
+        /** @brief Blank constructor for the in-memory backend. */
+        QueueConfig() : BACKEND(Backend::MEMORY), REDIS_ADDRESS("127.0.0.1"), REDIS_PORT(6379),
+                        NAMESPACE("nsb"), CONSUMER("daemon") {}
+    };
+
+    /**
+     * @brief Interface of the daemon's transmission and reception buffers.
+     *
+     * Each buffer is keyed on one field of its entries: the transmission
+     * buffer on the source, which simulator clients fetch by, and the
+     * reception buffer on the destination, which application clients
+     * receive by. The key "" matches every entry.
+     */
+    class QueueBackend {
+    public:
+        /** @brief Summary of the entries queued under a key. */
+        struct Depth {
+            int count = 0;
+            int64_t bytes = 0;
+            /** @brief When the oldest of them was queued (zero if there are none). */
+            std::chrono::steady_clock::time_point oldest;
+        };
+        /**
+         * @brief Base class constructor for a new QueueBackend.
+         *
+         * @param field The entry field the buffer is keyed on.
+         */
+        explicit QueueBackend(std::string MessageEntry::* field) : field(field) {}
+        virtual ~QueueBackend() = default;
+        /**
+         * @brief Adds an entry to the back of the buffer.
+         *
+         * @param entry The entry to add.
+         * @param front Whether to add the entry to the front instead, for
+         *              entries being returned to the buffer.
+         */
+        virtual void push(MessageEntry entry, bool front=false) = 0;
+        /**
+         * @brief Takes the oldest entries queued under a key out of the buffer.
+         *
+         * @param key The value to match, or "" for any entry.
+         * @param max The most entries to take, or a negative number for all.
+         * @return std::vector<MessageEntry> The entries, oldest first.
+         */
+        virtual std::vector<MessageEntry> take(const std::string& key, int max) = 0;
+        /**
+         * @brief Summarizes the entries queued under a key.
+         *
+         * @param key The value to match, or "" for any entry.
+         * @return Depth How many entries and payload bytes are queued, and
+         *         when the oldest was queued.
+         */
+        virtual Depth depth(const std::string& key) = 0;
+        /**
+         * @brief Lists the payload objects of the oldest entries under a key,
+         * leaving them in the buffer.
+         *
+         * Only entries that this buffer could hand out are listed, not those
+         * that another daemon sharing the queue has already read.
+         *
+         * @param key The value to match, or "" for any entry.
+         * @param max The most payload objects to list.
+         * @return std::vector<std::string> The payload objects (payloads, or
+         *         keys if the database is in use), oldest first.
+         */
+        virtual std::vector<std::string> peekPayloads(const std::string& key, int max) = 0;
+        /**
+         * @brief Creates the configured backend for a buffer.
+         *
+         * Falls back to the in-memory backend if the configured one is
+         * unavailable.
+         *
+         * @param config The queue configuration.
+         * @param name The buffer's name ("tx" or "rx"), used to separate the
+         *             buffers in shared storage.
+         * @param field The entry field the buffer is keyed on.
+         * @return std::unique_ptr<QueueBackend> The backend.
+         */
+        static std::unique_ptr<QueueBackend> create(const QueueConfig& config, const std::string& name,
+                                                    std::string MessageEntry::* field);
+    protected:
+        std::string MessageEntry::* field;
+        /** @brief Whether an entry is queued under a key. */
+        bool matches(const MessageEntry& entry, const std::string& key) const {
+            return key.empty() || entry.*field == key;
+        }
+    };
+
+    /**
+     * @brief Buffer kept in the daemon's memory.
+     *
+     * Entries are kept in a single list in the order they were queued. The
+     * payload object held by each entry is accounted under the PAYLOAD
+     * memory tag while it is in the buffer.
+     */
+    class MemoryQueue : public QueueBackend {
+    public:
+        explicit MemoryQueue(std::string MessageEntry::* field) : QueueBackend(field) {}
+        ~MemoryQueue();
+        void push(MessageEntry entry, bool front=false) override;
+        std::vector<MessageEntry> take(const std::string& key, int max) override;
+        Depth depth(const std::string& key) override;
+        std::vector<std::string> peekPayloads(const std::string& key, int max) override;
+    private:
+        MessageQueue entries;
+    };
+
+    /**
+     * @brief Buffer kept in Redis Streams.
+     *
+     * Each key has its own stream, _namespace:name:q:key_, and every entry is
+     * added to its stream with XADD. Entries are taken with XREADGROUP through
+     * a consumer group shared by all daemons using the same namespace, so
+     * several daemons (e.g., one per group of simulator workers) may serve
+     * the same queues without delivering any entry twice. Entries are
+     * acknowledged and deleted once taken. Entries that a daemon had read but
+     * not acknowledged when it stopped are taken again when it restarts.
+     *
+     * A set (_namespace:name:keys_) lists the keys with streams, and a hash
+     * (_namespace:name:bytes_) counts the payload bytes queued under each key.
+     * Commands for several streams are pipelined.
+     */
+    class RedisStreamQueue : public QueueBackend {
+    public:
+        /**
+         * @brief Constructor for a new RedisStreamQueue.
+         *
+         * Connects to Redis and recovers entries this consumer had read but
+         * not acknowledged.
+         *
+         * @param config The queue configuration.
+         * @param name The buffer's name ("tx" or "rx").
+         * @param field The entry field the buffer is keyed on.
+         */
+        RedisStreamQueue(const QueueConfig& config, const std::string& name, std::string MessageEntry::* field);
+        ~RedisStreamQueue();
+        /** @brief Checks the connection to the Redis server. */
+        bool isConnected() const;
+        void push(MessageEntry entry, bool front=false) override;
+        std::vector<MessageEntry> take(const std::string& key, int max) override;
+        Depth depth(const std::string& key) override;
+        std::vector<std::string> peekPayloads(const std::string& key, int max) override;
+    private:
+        using Reply = std::unique_ptr<redisReply, void (*)(void*)>;
+        /** @brief An entry held by the daemon rather than waiting in its stream. */
+        struct Held {
+            /** @brief The stream the entry was read from ("" if returned to the buffer). */
+            std::string stream;
+            /** @brief The entry's stream ID, to acknowledge once it is taken. */
+            std::string id;
+            MessageEntry entry;
+        };
+        redisContext* context;
+        /** @brief Prefix of this buffer's Redis keys. */
+        std::string prefix;
+        std::string consumer;
+        /** @brief Keys known to have streams. */
+        std::set<std::string> keys;
+        /** @brief Streams whose consumer group is known to exist. */
+        std::set<std::string> grouped;
+        /**
+         * @brief Entries returned to the front of the buffer, or read but not
+         * yet taken.
+         * 
+         * Entries read but not taken stay pending in their streams until they
+         * are taken, so they are recovered if the daemon stops.
+         */
+        std::list<Held> held;
+        std::string streamOf(const std::string& key) const { return prefix + "q:" + key; }
+        /** @brief Queues a command in the pipeline. */
+        void append(const std::vector<std::string>& args);
+        /** @brief Reads the next reply from the pipeline. */
+        Reply reply();
+        /** @brief Runs a single command. */
+        Reply command(const std::vector<std::string>& args);
+        /** @brief Creates the consumer group of a stream if needed. */
+        void ensureGroup(const std::string& stream);
+        /** @brief Gets the keys to look at for a key ("" for all of them). */
+        std::vector<std::string> keysFor(const std::string& key);
+        /**
+         * @brief Reads entries of the given streams with XREADGROUP.
+         * 
+         * @param streams The streams to read.
+         * @param id ">" for new entries, or "0" for this consumer's pending entries.
+         * @param count The most entries to read from each stream, or a negative number for all.
+         * @return std::vector<Held> The entries read, oldest first.
+         */
+        std::vector<Held> readGroup(const std::vector<std::string>& streams, const std::string& id, int count);
+        /** @brief Acknowledges, deletes, and uncounts entries that were taken. */
+        void acknowledge(const std::vector<Held>& taken);
+    };
+}
+
+#endif // NSB_QUEUE_H
@@ -0,0 +1,148 @@
+// nsb_ratelimit.h
+
+#ifndef NSB_RATELIMIT_H
+#define NSB_RATELIMIT_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace nsb {
+
+    /**
+     * @brief Rate limiting configuration parameters.
+     *
+     * These parameters are loaded from the _rate_limit_ section of the
+     * configuration file and are only used by the daemon. A rate of 0 denotes
+     * that the corresponding dimension is unlimited.
+     */
+    struct RateLimitConfig {
+        /**
+         * @brief Action taken when a message exceeds its limits.
+         *
+         * *DELAY* accepts the message but stops reading from the client's SEND
+         * channel until its buckets have refilled, pushing back on the client
+         * through its socket. *REJECT* discards the message and responds with
+         * a FAILURE code. *DROP* silently discards the message.
+         */
+        enum class OverflowAction {
+            DELAY = 0,
+            REJECT = 1,
+            DROP = 2
+        };
+        /** @brief Shared limits for all clients with a common identifier prefix. */
+        struct NamespaceLimit {
+            std::string prefix;
+            double messages_per_sec;
+            double bytes_per_sec;
+        };
+        bool ENABLED;
+        OverflowAction OVERFLOW_ACTION;
+        /** @brief Bucket capacity, in seconds' worth of tokens. */
+        double BURST_SECONDS;
+        double CLIENT_MESSAGES_PER_SEC;
+        double CLIENT_BYTES_PER_SEC;
+        std::vector<NamespaceLimit> NAMESPACES;
+
+        /** @brief Blank constructor with rate limiting disabled. */
+        RateLimitConfig() : ENABLED(false), OVERFLOW_ACTION(OverflowAction::DELAY), BURST_SECONDS(1.0),
+                            CLIENT_MESSAGES_PER_SEC(0), CLIENT_BYTES_PER_SEC(0) {}
+    };
+
+    /**
+     * @brief Token bucket over a single dimension (messages or bytes).
+     *
+     * Tokens accrue at a fixed rate up to a capacity. The balance may be
+     * driven negative with consume(), which is used to delay a client in
+     * proportion to how far it overshot its limit.
+     */
+    class TokenBucket {
+    public:
+        using Clock = std::chrono::steady_clock;
+        /**
+         * @brief Constructor for a new TokenBucket, starting full.
+         *
+         * @param rate Tokens accrued per second; 0 denotes unlimited.
+         * @param capacity The maximum number of tokens that can be held.
+         */
+        TokenBucket(double rate, double capacity);
+        /** @brief Whether or not the bucket limits anything. */
+        bool unlimited() const { return rate <= 0; }
+        /**
+         * @brief Checks whether the given number of tokens is available.
+         *
+         * Requests larger than the capacity are allowed when the bucket is
+         * full so that oversized messages cannot be starved forever.
+         */
+        bool available(double n, Clock::time_point now);
+        /** @brief Removes tokens, allowing the balance to become negative. */
+        void consume(double n, Clock::time_point now);
+        /** @brief Time until the balance is no longer negative. */
+        Clock::duration deficitWait(Clock::time_point now);
+    private:
+        void refill(Clock::time_point now);
+        double rate;
+        double capacity;
+        double tokens;
+        Clock::time_point last;
+    };
+
+    /**
+     * @brief Per-client and per-namespace rate limiter for SEND traffic.
+     *
+     * Each client is given its own pair of message and byte buckets, and every
+     * namespace (identifier prefix) configured shares a pair among all of its
+     * clients. A message is admitted only if all of the buckets that apply to
+     * it have enough tokens.
+     */
+    class RateLimiter {
+    public:
+        using Clock = TokenBucket::Clock;
+        /** @brief Outcome of an admission check. */
+        enum class Verdict {
+            ADMIT = 0,
+            DELAY = 1,
+            REJECT = 2,
+            DROP = 3
+        };
+        /** @brief Counters kept for each client and namespace. */
+        struct Counters {
+            int64_t admitted = 0;
+            int64_t delayed = 0;
+            int64_t rejected = 0;
+            int64_t dropped = 0;
+        };
+        /** @brief Blank constructor for a disabled rate limiter. */
+        RateLimiter() {}
+        /** @brief Constructor for a new RateLimiter with the given limits. */
+        RateLimiter(const RateLimitConfig& config) : cfg(config) {}
+        /** @brief Whether or not rate limiting is enabled. */
+        bool enabled() const { return cfg.ENABLED; }
+        /**
+         * @brief Checks a message from a client against its limits.
+         *
+         * @param client_id The identifier of the sending client.
+         * @param bytes The size of the payload being sent.
+         * @param delay Set to how long the client's reads should be paused
+         *              when the verdict is DELAY.
+         * @return Verdict Whether the message was admitted, or the overflow
+         *                 action to be taken.
+         */
+        Verdict admit(const std::string& client_id, std::size_t bytes, Clock::duration* delay);
+        /** @brief Gets the counters for each client and namespace. */
+        const std::map<std::string, Counters>& counters() const { return stats; }
+    private:
+        struct Buckets {
+            TokenBucket messages;
+            TokenBucket bytes;
+        };
+        Buckets& bucketsFor(const std::string& key, double messages_per_sec, double bytes_per_sec);
+        RateLimitConfig cfg;
+        std::map<std::string, Buckets> buckets;
+        std::map<std::string, Counters> stats;
+    };
+}
+
+#endif // NSB_RATELIMIT_H
@@ -0,0 +1,147 @@
+// nsb_rcu.h
+
+#ifndef NSB_RCU_H
+#define NSB_RCU_H
+
+#include "nsb.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+namespace nsb {
+
+    /** @brief The most reader threads a QsbrDomain tracks. */
+    const int RCU_MAX_READERS = 16;
+
+    /**
+     * @brief Quiescent-state-based reclamation (QSBR) for read-copy-update.
+     *
+     * Readers never lock or write shared memory while reading: each reader
+     * thread only announces, at points where it holds no references to
+     * shared data, that it is quiescent (or offline, e.g. while blocked in
+     * select()). A single writer thread replaces shared data by publishing
+     * a new version, and retires the old one with a reclamation callback
+     * that runs once every reader has been quiescent since, at which point
+     * none of them can still be using it.
+     *
+     * @code{.cpp}
+     * nsb::QsbrDomain domain;
+     * int reader = domain.registerReader();  // On the reader thread.
+     * domain.offline(reader);
+     * select(...);                           // Holds no references.
+     * domain.online(reader);
+     * @endcode
+     *
+     * @see RcuPointer
+     */
+    class QsbrDomain {
+    public:
+        QsbrDomain();
+        /** @brief Runs every reclamation still waiting; no reader may be registered. */
+        ~QsbrDomain();
+        QsbrDomain(const QsbrDomain&) = delete;
+        QsbrDomain& operator=(const QsbrDomain&) = delete;
+        /**
+         * @brief Registers the calling thread as a reader, online.
+         *
+         * @return int The reader's slot, or -1 if RCU_MAX_READERS are registered.
+         */
+        int registerReader();
+        /** @brief Unregisters a reader, which must hold no references. */
+        void unregisterReader(int reader);
+        /** @brief Announces that a reader holds no references (and continues reading). */
+        void quiescent(int reader) {
+            slots[reader].seen.store(epoch.load(std::memory_order_acquire), std::memory_order_release);
+        }
+        /** @brief Announces that a reader holds no references until it is online again. */
+        void offline(int reader) { slots[reader].seen.store(OFFLINE, std::memory_order_release); }
+        /** @brief Announces that a reader may take references again. */
+        void online(int reader) {
+            quiescent(reader);
+            // Order the announcement before any read, against the writer's scan.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        /**
+         * @brief Retires data replaced by the writer.
+         *
+         * Must only be called from the writer thread, after the replacement
+         * has been published.
+         *
+         * @param reclaim Frees the data once no reader can be using it.
+         */
+        void retire(std::function<void()> reclaim);
+        /**
+         * @brief Runs the reclamation of everything retired before every
+         * reader was last quiescent. Must only be called from the writer thread.
+         *
+         * @return std::size_t The number of retirements still waiting.
+         */
+        std::size_t reclaim();
+    private:
+        /** @brief Marks a reader that holds no references. */
+        static const uint64_t OFFLINE = ~0ULL;
+        /** @brief Marks an unused slot. */
+        static const uint64_t UNUSED = 0;
+        /** @brief A reader's last announcement, on its own cache line. */
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> seen{UNUSED};
+        };
+        std::array<Slot, RCU_MAX_READERS> slots;
+        /** @brief Advanced by every retirement; starts at 1 so that 0 marks unused slots. */
+        std::atomic<uint64_t> epoch;
+        std::deque<std::pair<uint64_t, std::function<void()>>> retired;
+        /** @brief Checks whether every reader has been quiescent since an epoch began. */
+        bool passed(uint64_t target) const;
+    };
+
+    /**
+     * @brief A pointer to immutable shared data, replaced by read-copy-update.
+     *
+     * Readers get the current version with a single acquire load, and may
+     * use it until they are next quiescent. The writer copies the current
+     * version, changes the copy, and publishes it; the previous version is
+     * freed once no reader can still be using it.
+     *
+     * @tparam T The type of the shared data.
+     */
+    template <typename T>
+    class RcuPointer {
+    public:
+        RcuPointer(QsbrDomain& domain, std::unique_ptr<T> initial) :
+            domain(domain), current(initial.release()) {}
+        /** @brief Frees the current version; no reader may be using it. */
+        ~RcuPointer() { delete current.load(std::memory_order_relaxed); }
+        RcuPointer(const RcuPointer&) = delete;
+        RcuPointer& operator=(const RcuPointer&) = delete;
+        /** @brief Gets the current version, valid until the reader is next quiescent. */
+        const T& read() const { return *current.load(std::memory_order_acquire); }
+        /**
+         * @brief Replaces the current version. Must only be called from the
+         * writer thread.
+         *
+         * @param next The new version.
+         */
+        void publish(std::unique_ptr<T> next) {
+            T* previous = current.exchange(next.release(), std::memory_order_acq_rel);
+            domain.retire([previous]() { delete previous; });
+        }
+        /**
+         * @brief Publishes a changed copy of the current version. Must only be
+         * called from the writer thread.
+         *
+         * @param change Applies the change to the copy.
+         */
+        template <typename F>
+        void update(F&& change) {
+            auto next = std::make_unique<T>(read());
+            change(*next);
+            publish(std::move(next));
+        }
+    private:
+        QsbrDomain& domain;
+        std::atomic<T*> current;
+    };
+}
+
+#endif // NSB_RCU_H
@@ -0,0 +1,107 @@
+// nsb_relay.h
+
+#ifndef NSB_RELAY_H
+#define NSB_RELAY_H
+
+#include "nsb.h"
+
+namespace nsb {
+
+    /** @brief Flag in an envelope's header marking a compressed bundle. */
+    const uint32_t RELAY_COMPRESSED = 0x80000000u;
+    /** @brief The largest bundle, in bytes, accepted in an envelope. */
+    const uint32_t RELAY_MAX_ENVELOPE_SIZE = 64 * 1024 * 1024;
+    /** @brief The smallest serialized bundle, in bytes, worth compressing. */
+    const std::size_t RELAY_COMPRESS_MIN_SIZE = 512;
+    /** @brief How long to wait, in milliseconds, for a relay link to accept more bytes. */
+    const int RELAY_SEND_TIMEOUT_MS = 5000;
+
+    /**
+     * @brief Frames a bundle of messages as an envelope for a relay link.
+     *
+     * Unlike client channels, where a message is whatever one read returns,
+     * relay links carry many messages back to back, so each bundle is framed:
+     * a 4-byte big-endian header holding the size of the serialized bundle
+     * (and RELAY_COMPRESSED if it is zlib-compressed), followed by the bundle.
+     *
+     * @param relay The bundle.
+     * @param compress Whether to compress the bundle if it is large enough to
+     *                 be worth it.
+     * @param out The buffer to append the envelope to.
+     */
+    void packRelay(const nsb::nsbm::Relay& relay, bool compress, std::string* out);
+
+    /**
+     * @brief Reassembles envelopes from the bytes read off a relay link.
+     *
+     * @see packRelay()
+     */
+    class RelayReader {
+    public:
+        /** @brief Adds bytes read from the link. */
+        void append(const char* data, std::size_t size);
+        /**
+         * @brief Takes the next complete bundle.
+         *
+         * @param relay Set to the bundle.
+         * @return int 1 if a bundle was taken, 0 if more bytes are needed, or
+         *         -1 if the link carries something other than envelopes.
+         */
+        int next(nsb::nsbm::Relay* relay);
+    private:
+        std::string buffer;
+        /** @brief Where the next envelope starts in the buffer. */
+        std::size_t offset = 0;
+    };
+
+    /**
+     * @brief Frames a single serialized message for a channel that may carry
+     * several back to back.
+     *
+     * The frame has the same 4-byte big-endian size header as an envelope,
+     * but is never compressed.
+     *
+     * @param message The serialized message.
+     * @param out The buffer to append the frame to.
+     * @see FrameReader
+     */
+    void packFrame(const std::string& message, std::string* out);
+
+    /**
+     * @brief Reassembles frames from the bytes read off a channel.
+     *
+     * @see packFrame()
+     */
+    class FrameReader {
+    public:
+        /** @brief Adds bytes read from the channel. */
+        void append(const char* data, std::size_t size);
+        /**
+         * @brief Takes the next complete frame.
+         *
+         * @param message Set to the framed message.
+         * @return int 1 if a frame was taken, 0 if more bytes are needed, or
+         *         -1 if the channel carries something other than frames.
+         */
+        int next(std::string* message);
+        /** @brief Forgets any bytes not yet taken, e.g. after reconnecting. */
+        void clear();
+    private:
+        std::string buffer;
+        /** @brief Where the next frame starts in the buffer. */
+        std::size_t offset = 0;
+    };
+
+    /**
+     * @brief Sends all of a buffer on a non-blocking socket.
+     *
+     * @param fd The socket.
+     * @param data The bytes to send.
+     * @param size How many bytes to send.
+     * @param timeout_ms How long to wait for the socket to accept more bytes.
+     * @return int 0 if everything was sent, else -1.
+     */
+    int sendAll(int fd, const char* data, std::size_t size, int timeout_ms);
+}
+
+#endif // NSB_RELAY_H
@@ -0,0 +1,118 @@
+// nsb_resp.h
+
+#ifndef NSB_RESP_H
+#define NSB_RESP_H
+
+#include "nsb.h"
+
+#include <unordered_map>
+
+#include <sys/un.h>
+
+namespace nsb {
+
+    /** @brief The largest bulk string accepted by the RespServer (bytes). */
+    const long long RESP_MAX_BULK_SIZE = 512LL * 1024 * 1024;
+    /** @brief The most arguments accepted in one command by the RespServer. */
+    const long long RESP_MAX_ARGS = 1024 * 1024;
+
+    /**
+     * @brief A small embedded Redis-compatible server.
+     *
+     * Serves the subset of Redis used for payload storage (SET, GET, GETDEL,
+     * DEL, EXPIRE, MGET, and a few connection commands) over RESP2 or RESP3,
+     * so that RedisConnector and the Redis clients of other languages can use
+     * it in place of a redis-server. Keys live in a hash table held by the
+     * server, and expire lazily when accessed and periodically in the
+     * background.
+     *
+     * The server runs on its own thread and listens on a TCP port (0 picks an
+     * ephemeral one) or, if the address is a path, on a Unix domain socket.
+     * Every command available in a connection's buffer is handled before
+     * replying, so pipelined commands cost a single write. This lets tests and
+     * benchmarks run in DB mode without an external server, and serves as a
+     * low-latency store for small deployments on a single host.
+     *
+     * @code{.cpp}
+     * nsb::RespServer server;
+     * int port = server.start("127.0.0.1", 0);
+     * nsb::RedisConnector db("test", address, port);
+     * @endcode
+     */
+    class RespServer {
+    public:
+        RespServer();
+        /** @brief Stops the server if it is running. */
+        ~RespServer();
+        /**
+         * @brief Starts listening and serving on a new thread.
+         *
+         * @param address The address to listen on, or the path of a Unix
+         *                domain socket if it starts with '/'.
+         * @param port The TCP port to listen on (0 for an ephemeral port);
+         *             ignored for Unix domain sockets.
+         * @return int The port listened on (0 for Unix domain sockets), or -1
+         *         if the server could not be started.
+         */
+        int start(const std::string& address = "127.0.0.1", int port = 0);
+        /** @brief Stops serving and closes every connection. */
+        void stop();
+        /** @brief Checks whether the server is running. */
+        bool isRunning() const { return running; }
+        /** @brief Gets the TCP port listened on (0 for Unix domain sockets). */
+        int getPort() const { return port; }
+        /** @brief Gets the number of keys stored. */
+        std::size_t size() const { return key_count; }
+    private:
+        /** @brief A stored value and when it expires. */
+        struct Value {
+            std::string data;
+            /** @brief When the key expires (zero if it does not). */
+            std::chrono::steady_clock::time_point expiry;
+        };
+        /** @brief A client connection and its buffers. */
+        struct Connection {
+            std::string in;
+            std::string out;
+            /** @brief The RESP version negotiated with HELLO. */
+            int protocol = 2;
+            bool closing = false;
+        };
+        std::atomic<bool> running;
+        std::thread server_thread;
+        int listen_fd;
+        int port;
+        std::string unix_path;
+        std::atomic<std::size_t> key_count;
+        std::unordered_map<std::string, Value> store;
+        std::map<int, Connection> connections;
+        /** @brief Number of stored keys with an expiry. */
+        std::size_t expiring;
+        /** @brief The server loop, run on its own thread. */
+        void serve();
+        /** @brief Reads from a connection and handles the commands received. */
+        void readConnection(int fd, Connection& conn);
+        /** @brief Writes as much of a connection's pending replies as possible. */
+        void writeConnection(int fd, Connection& conn);
+        /**
+         * @brief Parses one command from a buffer.
+         *
+         * @param in The buffer.
+         * @param pos The position to parse from, advanced past the command.
+         * @param args The parsed arguments.
+         * @return int 1 if a command was parsed, 0 if more data is needed,
+         *         or -1 on a protocol error.
+         */
+        static int parseCommand(const std::string& in, std::size_t& pos, std::vector<std::string>& args);
+        /** @brief Executes a command and appends its reply. */
+        void execute(std::vector<std::string>& args, Connection& conn);
+        /** @brief Finds a key, deleting it first if it has expired. */
+        std::unordered_map<std::string, Value>::iterator lookup(const std::string& key);
+        /** @brief Deletes a stored key. */
+        void erase(std::unordered_map<std::string, Value>::iterator it);
+        /** @brief Deletes every expired key. */
+        void expireKeys();
+    };
+}
+
+#endif // NSB_RESP_H
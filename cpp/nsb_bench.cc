@@ -0,0 +1,200 @@
+// nsb_bench.cc
+
+#include "nsb.h"
+#include "nsb_heavyhitters.h"
+#include "nsb_queue.h"
+#include "nsb_resp.h"
+
+#include <random>
+
+/**
+ * @brief Benchmarks of payload checksums, the daemon's queue backends, and the
+ * payload database.
+ *
+ * Measures the throughput of CRC32C checksums against that of copying the 
+ * same payloads, and of heavy-hitter tracking over many keys. Then measures the throughput of queueing messages, taking them one at a time and
+ * in batches, and summarizing a queue (as done for every polling hint), for
+ * each backend. Then measures storing and checking out payloads with the 
+ * RedisConnector, one at a time and pipelined, against the embedded 
+ * RespServer and a Redis server. Whatever needs a Redis server is skipped if 
+ * none is reachable.
+ *
+ * Usage: nsb_bench [messages] [payload_bytes] [redis_address] [redis_port]
+ */
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    const int BENCH_DESTINATIONS = 16;
+    const int BENCH_BATCH_SIZE = 64;
+
+    void report(const std::string& backend, const std::string& operation, int count, Clock::time_point start) {
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << std::left << std::setw(16) << backend << std::setw(16) << operation
+                  << std::right << std::setw(10) << count << " ops " << std::setw(12) << std::fixed
+                  << std::setprecision(0) << (seconds > 0 ? count / seconds : 0) << " ops/s "
+                  << std::setw(10) << std::setprecision(2) << (count > 0 ? seconds * 1e6 / count : 0)
+                  << " us/op" << std::endl;
+    }
+
+    void benchmarkChecksum(int payload_bytes) {
+        // Checksum and copy about 1 GiB in payloads of the given size.
+        std::string payload(std::max(payload_bytes, 1), 'x');
+        std::string copy(payload.size(), '\0');
+        int count = static_cast<int>(std::max<std::size_t>(1, (std::size_t(1) << 30) / payload.size()));
+        uint32_t crc = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < count; i++) {
+            crc ^= nsb::crc32c(payload.data(), payload.size());
+        }
+        double crc_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        report(std::string("crc32c/") + nsb::crc32cImplementation(), "checksum", count, start);
+        start = Clock::now();
+        for (int i = 0; i < count; i++) {
+            payload[i % payload.size()] = static_cast<char>(crc);
+            std::memcpy(copy.data(), payload.data(), payload.size());
+        }
+        double copy_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        report("memcpy", "copy", count, start);
+        double bytes = static_cast<double>(count) * payload.size();
+        std::cout << "checksum " << std::setprecision(2) << bytes / crc_seconds / 1e9 << " GB/s, copy "
+                  << bytes / copy_seconds / 1e9 << " GB/s" << std::endl;
+    }
+
+    void benchmarkHeavyHitters(int messages) {
+        // Record messages from many sources, a few of which send most of them.
+        std::vector<std::string> keys;
+        for (int i = 0; i < 100000; i++) {
+            keys.push_back("node" + std::to_string(i));
+        }
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<int> pick(0, static_cast<int>(keys.size()) - 1);
+        nsb::HeavyHitters hitters;
+        auto start = Clock::now();
+        for (int i = 0; i < messages; i++) {
+            const std::string& key = (i % 2 == 0) ? keys[i % 4] : keys[pick(generator)];
+            hitters.record(key, 256);
+        }
+        report("heavy_hitters", "record", messages, start);
+        for (const nsb::HeavyHitters::Entry& entry : hitters.top(false)) {
+            std::cout << "  " << entry.key << ": ~" << entry.messages << " messages" << std::endl;
+        }
+    }
+
+    void fill(nsb::QueueBackend& queue, int messages, const std::string& payload) {
+        for (int i = 0; i < messages; i++) {
+            queue.push(nsb::MessageEntry("node" + std::to_string(i % BENCH_DESTINATIONS), "sim",
+                                         payload, static_cast<int>(payload.size())));
+        }
+    }
+
+    void benchmark(const std::string& name, nsb::QueueBackend& queue, int messages, const std::string& payload) {
+        // Queue and take messages one at a time, for any source.
+        auto start = Clock::now();
+        fill(queue, messages, payload);
+        report(name, "push", messages, start);
+        start = Clock::now();
+        int taken = 0;
+        while (!queue.take("", 1).empty()) {
+            taken++;
+        }
+        report(name, "take", taken, start);
+        // Take messages from each source in batches.
+        fill(queue, messages, payload);
+        start = Clock::now();
+        taken = 0;
+        for (int i = 0; i < BENCH_DESTINATIONS; i++) {
+            std::string key = "node" + std::to_string(i);
+            std::size_t batch;
+            do {
+                batch = queue.take(key, BENCH_BATCH_SIZE).size();
+                taken += batch;
+            } while (batch > 0);
+        }
+        report(name, "take (batch)", taken, start);
+        // Summarize a queue of messages.
+        fill(queue, std::min(messages, 1000), payload);
+        start = Clock::now();
+        int summaries = std::max(1, messages / 10);
+        for (int i = 0; i < summaries; i++) {
+            queue.depth("node" + std::to_string(i % BENCH_DESTINATIONS));
+        }
+        report(name, "depth", summaries, start);
+        queue.take("", -1);
+    }
+
+    void benchmarkDB(const std::string& name, std::string address, int port, int messages, const std::string& payload) {
+        nsb::RedisConnector db("bench", address, port);
+        if (!db.isConnected()) {
+            std::cout << "Skipping " << name << ": no server at " << address << ":" << port << std::endl;
+            return;
+        }
+        // Store and check out payloads one at a time.
+        std::vector<std::string> keys;
+        auto start = Clock::now();
+        for (int i = 0; i < messages; i++) {
+            keys.push_back(db.store(payload));
+        }
+        report(name, "store", messages, start);
+        start = Clock::now();
+        for (const std::string& key : keys) {
+            db.checkOut(key);
+        }
+        report(name, "checkOut", messages, start);
+        // Likewise, pipelined in batches.
+        std::vector<std::string> batch(BENCH_BATCH_SIZE, payload);
+        int batches = std::max(1, messages / BENCH_BATCH_SIZE);
+        keys.clear();
+        start = Clock::now();
+        for (int i = 0; i < batches; i++) {
+            std::vector<std::string> stored = db.storeMany(batch);
+            keys.insert(keys.end(), stored.begin(), stored.end());
+        }
+        report(name, "store (batch)", static_cast<int>(keys.size()), start);
+        start = Clock::now();
+        for (std::size_t i = 0; i < keys.size(); i += BENCH_BATCH_SIZE) {
+            db.checkOutMany(std::vector<std::string>(keys.begin() + i,
+                            keys.begin() + std::min(keys.size(), i + BENCH_BATCH_SIZE)));
+        }
+        report(name, "checkOut (batch)", static_cast<int>(keys.size()), start);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int messages = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int payload_bytes = argc > 2 ? std::atoi(argv[2]) : 256;
+    nsb::QueueConfig config;
+    config.BACKEND = nsb::QueueConfig::Backend::REDIS_STREAMS;
+    config.NAMESPACE = "nsb_bench";
+    config.CONSUMER = "bench";
+    if (argc > 3) {
+        config.REDIS_ADDRESS = argv[3];
+    }
+    if (argc > 4) {
+        config.REDIS_PORT = std::atoi(argv[4]);
+    }
+    std::string payload(payload_bytes, 'x');
+    benchmarkChecksum(payload_bytes);
+    benchmarkHeavyHitters(messages * 10);
+    std::cout << messages << " messages of " << payload_bytes << " B across "
+              << BENCH_DESTINATIONS << " sources" << std::endl;
+
+    nsb::MemoryQueue memory(&nsb::MessageEntry::source);
+    benchmark("memory", memory, messages, payload);
+
+    nsb::RedisStreamQueue streams(config, "bench", &nsb::MessageEntry::source);
+    if (streams.isConnected()) {
+        benchmark("redis_streams", streams, messages, payload);
+    } else {
+        std::cout << "Skipping Redis Streams: no server at " << config.REDIS_ADDRESS << ":"
+                  << config.REDIS_PORT << std::endl;
+    }
+
+    nsb::RespServer server;
+    int port = server.start("127.0.0.1", 0);
+    benchmarkDB("db_embedded", "127.0.0.1", port, messages, payload);
+    server.stop();
+    benchmarkDB("db_redis", config.REDIS_ADDRESS, config.REDIS_PORT, messages, payload);
+    return 0;
+}
@@ -0,0 +1,251 @@
+// nsb_pybind.cc
+
+#include <optional>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "nsb_client.h"
+
+namespace py = pybind11;
+
+namespace {
+
+    /**
+     * @brief Copies the contents of any buffer-protocol object into a string.
+     *
+     * Accepts bytes, bytearray, memoryview, and array-like objects without
+     * first converting them to bytes. This must be called with the GIL held.
+     */
+    std::string bufferToString(const py::buffer& payload) {
+        py::buffer_info info = payload.request();
+        return std::string(static_cast<const char*>(info.ptr), info.size * info.itemsize);
+    }
+
+    /** @brief Converts an empty MessageEntry to None, like the Python client. */
+    std::optional<nsb::MessageEntry> entryOrNone(nsb::MessageEntry&& entry) {
+        if (!entry.exists()) {
+            return std::nullopt;
+        }
+        return std::optional<nsb::MessageEntry>(std::move(entry));
+    }
+
+    /** @brief Resolves a None timeout the way the C++ overloads do. */
+    int resolveTimeout(const nsb::NSBClient& client, std::optional<int> timeout) {
+        if (timeout) {
+            return *timeout;
+        }
+        return client.getConfig().SYSTEM_MODE == nsb::Config::SystemMode::PUSH ? 0 : DAEMON_RESPONSE_TIMEOUT;
+    }
+
+}
+
+/**
+ * @brief Python bindings to the C++ client library.
+ *
+ * The module mirrors the API of the pure-Python client (nsb_client.py) so it
+ * can be used in its place with `import nsb_cpp as nsb`. The GIL is released 
+ * for every call that may touch the network, so other Python threads keep 
+ * running while a client waits on the daemon. Payloads are accepted from any
+ * buffer-protocol object, and received payloads are exposed through the 
+ * buffer protocol of MessageEntry (see MessageEntry.payload) without copying.
+ * Unlike in nsb_client.py, MessageEntry.payload is therefore a memoryview, 
+ * not bytes: use bytes(entry.payload) where bytes methods such as decode() 
+ * are needed.
+ */
+PYBIND11_MODULE(nsb_cpp, m) {
+    m.doc() = "NSB client API backed by the C++ client library.";
+
+    py::enum_<nsb::Comms::Channel>(m, "Channel")
+        .value("CTRL", nsb::Comms::Channel::CTRL)
+        .value("SEND", nsb::Comms::Channel::SEND)
+        .value("RECV", nsb::Comms::Channel::RECV)
+        .value("DGRAM", nsb::Comms::Channel::DGRAM);
+
+    py::class_<nsb::Config> config(m, "Config");
+    py::enum_<nsb::Config::SystemMode>(config, "SystemMode")
+        .value("PULL", nsb::Config::SystemMode::PULL)
+        .value("PUSH", nsb::Config::SystemMode::PUSH);
+    py::enum_<nsb::Config::SimulatorMode>(config, "SimulatorMode")
+        .value("SYSTEM_WIDE", nsb::Config::SimulatorMode::SYSTEM_WIDE)
+        .value("PER_NODE", nsb::Config::SimulatorMode::PER_NODE);
+    config
+        .def_readonly("system_mode", &nsb::Config::SYSTEM_MODE)
+        .def_readonly("simulator_mode", &nsb::Config::SIMULATOR_MODE)
+        .def_readonly("use_db", &nsb::Config::USE_DB)
+        .def_readonly("db_address", &nsb::Config::DB_ADDRESS)
+        .def_readonly("db_port", &nsb::Config::DB_PORT)
+        .def_readonly("db_num", &nsb::Config::DB_NUM)
+        .def_property_readonly("db_shards", [](const nsb::Config& cfg) {
+            std::vector<std::pair<std::string, int>> shards;
+            for (const nsb::DBShard& shard : cfg.dbShards()) {
+                shards.emplace_back(shard.address, shard.port);
+            }
+            return shards;
+        })
+        .def_readonly("use_dgram", &nsb::Config::USE_DGRAM)
+        .def_readonly("use_checksum", &nsb::Config::USE_CHECKSUM);
+
+    // The payload is exported through the buffer protocol, so memoryview(entry)
+    // or entry.payload reads it in place; bytes(entry.payload) makes a copy.
+    py::class_<nsb::MessageEntry>(m, "MessageEntry", py::buffer_protocol())
+        .def_readonly("source", &nsb::MessageEntry::source)
+        .def_readonly("destination", &nsb::MessageEntry::destination)
+        // The names used by nsb_client.py's MessageEntry.
+        .def_readonly("src_id", &nsb::MessageEntry::source)
+        .def_readonly("dest_id", &nsb::MessageEntry::destination)
+        .def_readonly("payload_size", &nsb::MessageEntry::payload_size)
+        .def_readonly("checksum", &nsb::MessageEntry::checksum)
+        .def_readonly("payload_key", &nsb::MessageEntry::payload_key)
+        .def_property_readonly("payload", [](py::object self) {
+            return py::memoryview(self);
+        })
+        .def_buffer([](nsb::MessageEntry& entry) -> py::buffer_info {
+            return py::buffer_info(entry.payload_obj.data(), 1,
+                                   py::format_descriptor<uint8_t>::format(), 1,
+                                   {static_cast<py::ssize_t>(entry.payload_obj.size())}, {1}, true);
+        })
+        .def("exists", &nsb::MessageEntry::exists)
+        .def("__len__", [](const nsb::MessageEntry& entry) { return entry.payload_obj.size(); })
+        .def("__repr__", [](const nsb::MessageEntry& entry) {
+            return "<MessageEntry " + entry.source + " -> " + entry.destination + " (" +
+                   std::to_string(entry.payload_obj.size()) + " B)>";
+        });
+
+    py::class_<nsb::PostEntry> postEntry(m, "PostEntry");
+    py::enum_<nsb::PostEntry::Verdict>(postEntry, "Verdict")
+        .value("DELIVERED", nsb::PostEntry::Verdict::DELIVERED)
+        .value("DROPPED", nsb::PostEntry::Verdict::DROPPED)
+        .value("CORRUPTED", nsb::PostEntry::Verdict::CORRUPTED);
+    postEntry
+        .def(py::init([](const std::string& srcId, const std::string& destId, const py::buffer& payload,
+                         nsb::PostEntry::Verdict verdict) {
+            return nsb::PostEntry(srcId, destId, bufferToString(payload), verdict);
+        }), py::arg("src_id"), py::arg("dest_id"), py::arg("payload"),
+            py::arg("verdict") = nsb::PostEntry::Verdict::DELIVERED)
+        .def(py::init<nsb::MessageEntry, nsb::PostEntry::Verdict>(),
+             py::arg("entry"), py::arg("verdict") = nsb::PostEntry::Verdict::DELIVERED)
+        .def_readwrite("verdict", &nsb::PostEntry::verdict)
+        .def_readwrite("checksum", &nsb::PostEntry::checksum);
+
+    py::class_<nsb::NSBClient>(m, "NSBClient")
+        .def("get_id", &nsb::NSBClient::getId)
+        .def_property_readonly("config", &nsb::NSBClient::getConfig, py::return_value_policy::reference_internal)
+        .def_property_readonly("session_token", &nsb::NSBClient::getSessionToken)
+        .def("ping", &nsb::NSBClient::ping, py::call_guard<py::gil_scoped_release>())
+        .def("exit", &nsb::NSBClient::exit, py::call_guard<py::gil_scoped_release>())
+        .def("reconnect", &nsb::NSBClient::reconnect, py::call_guard<py::gil_scoped_release>())
+        .def("poll_hints", [](const nsb::NSBClient& self) {
+            const nsb::nsbm::PollHints& hints = self.pollHints();
+            py::dict result;
+            result["queue_depth"] = hints.queue_depth();
+            result["oldest_age_us"] = hints.oldest_age_us();
+            result["next_poll_us"] = hints.next_poll_us();
+            result["queue_bytes"] = hints.queue_bytes();
+            return result;
+        })
+        .def("await_doorbell", [](nsb::NSBClient& self, std::optional<int> timeout) {
+            py::gil_scoped_release release;
+            return self.awaitDoorbell(timeout ? *timeout : -1);
+        }, py::arg("timeout") = py::none(),
+           "Waits for a 'messages waiting' notification; returns how many are waiting (0 on timeout).")
+        .def("set_doorbell_enabled", &nsb::NSBClient::setDoorbellEnabled, py::arg("enable"),
+             "Have batch requests arm the doorbell that await_doorbell() waits for (off by default).")
+        .def("checksum_failures", &nsb::NSBClient::checksumFailures)
+        .def("stats", [](const nsb::NSBClient& self) {
+            py::list result;
+            for (const nsb::ClientMetrics::Snapshot& snap : self.stats()) {
+                py::dict metric;
+                metric["name"] = snap.name;
+                metric["count"] = snap.count;
+                metric["errors"] = snap.errors;
+                metric["timeouts"] = snap.timeouts;
+                metric["empty"] = snap.empty;
+                metric["total_ns"] = snap.total_ns;
+                metric["min_ns"] = snap.min_ns;
+                metric["max_ns"] = snap.max_ns;
+                metric["p50_ns"] = snap.p50_ns;
+                metric["p90_ns"] = snap.p90_ns;
+                metric["p99_ns"] = snap.p99_ns;
+                metric["p999_ns"] = snap.p999_ns;
+                result.append(metric);
+            }
+            return result;
+        }, "Counts and latency percentiles of each operation and step measured.")
+        .def("reset_stats", &nsb::NSBClient::resetStats)
+        .def("set_metrics_enabled", &nsb::NSBClient::setMetricsEnabled, py::arg("enable"))
+        .def("push_metrics", &nsb::NSBClient::pushMetrics, py::call_guard<py::gil_scoped_release>())
+        .def("set_prefetch_payloads", &nsb::NSBClient::setPrefetchPayloads, py::arg("enable"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("set_use_datagrams", &nsb::NSBClient::setUseDatagrams, py::arg("enable"),
+             "Send small messages as datagrams, which may be lost (off by default).")
+        .def("get_fd", &nsb::NSBClient::getFd, py::arg("channel"),
+             "Socket descriptor of a channel, e.g. for asyncio's loop.add_reader().");
+
+    py::class_<nsb::NSBAppClient, nsb::NSBClient>(m, "NSBAppClient")
+        .def(py::init([](const std::string& identifier, std::string serverAddress, int serverPort) {
+            py::gil_scoped_release release;
+            return new nsb::NSBAppClient(identifier, serverAddress, serverPort);
+        }), py::arg("identifier"), py::arg("server_address"), py::arg("server_port"))
+        .def("send", [](nsb::NSBAppClient& self, const std::string& destId, const py::buffer& payload) {
+            std::string data = bufferToString(payload);
+            py::gil_scoped_release release;
+            return self.send(destId, std::move(data));
+        }, py::arg("dest_id"), py::arg("payload"))
+        .def("receive", [](nsb::NSBAppClient& self, std::optional<std::string> destId, std::optional<int> timeout) {
+            int t = resolveTimeout(self, timeout);
+            nsb::MessageEntry entry;
+            {
+                py::gil_scoped_release release;
+                entry = self.receive(destId ? &*destId : nullptr, t);
+            }
+            return entryOrNone(std::move(entry));
+        }, py::arg("dest_id") = py::none(), py::arg("timeout") = py::none())
+        .def("receive_batch", [](nsb::NSBAppClient& self, std::optional<std::string> destId, int maxMessages, int timeout) {
+            py::gil_scoped_release release;
+            return self.receiveBatch(destId ? &*destId : nullptr, maxMessages, timeout);
+        }, py::arg("dest_id") = py::none(), py::arg("max_messages") = 0, py::arg("timeout") = DAEMON_RESPONSE_TIMEOUT)
+        .def("rejected_sends", &nsb::NSBAppClient::rejectedSends,
+             "Number of sent messages the daemon has rejected (rate limited).")
+        .def("take_rejected", &nsb::NSBAppClient::takeRejected,
+             "Sent messages the daemon has rejected since the last call, oldest first.");
+
+    py::class_<nsb::NSBSimClient, nsb::NSBClient>(m, "NSBSimClient")
+        .def(py::init([](const std::string& identifier, std::string serverAddress, int serverPort) {
+            py::gil_scoped_release release;
+            return new nsb::NSBSimClient(identifier, serverAddress, serverPort);
+        }), py::arg("identifier"), py::arg("server_address"), py::arg("server_port"))
+        .def("fetch", [](nsb::NSBSimClient& self, std::optional<std::string> srcId, std::optional<int> timeout) {
+            int t = resolveTimeout(self, timeout);
+            nsb::MessageEntry entry;
+            {
+                py::gil_scoped_release release;
+                entry = self.fetch(srcId ? &*srcId : nullptr, t);
+            }
+            return entryOrNone(std::move(entry));
+        }, py::arg("src_id") = py::none(), py::arg("timeout") = py::none())
+        .def("request_fetch", [](nsb::NSBSimClient& self, std::optional<std::string> srcId) {
+            py::gil_scoped_release release;
+            return self.requestFetch(srcId ? &*srcId : nullptr);
+        }, py::arg("src_id") = py::none())
+        .def("collect_fetch", [](nsb::NSBSimClient& self, int timeout) {
+            nsb::MessageEntry entry;
+            {
+                py::gil_scoped_release release;
+                entry = self.collectFetch(timeout);
+            }
+            return entryOrNone(std::move(entry));
+        }, py::arg("timeout") = 0)
+        .def("fetch_batch", [](nsb::NSBSimClient& self, std::optional<std::string> srcId, int maxMessages, int timeout) {
+            py::gil_scoped_release release;
+            return self.fetchBatch(srcId ? &*srcId : nullptr, maxMessages, timeout);
+        }, py::arg("src_id") = py::none(), py::arg("max_messages") = 0, py::arg("timeout") = DAEMON_RESPONSE_TIMEOUT)
+        .def("post", [](nsb::NSBSimClient& self, const std::string& srcId, const std::string& destId, const py::buffer& payload) {
+            std::string data = bufferToString(payload);
+            py::gil_scoped_release release;
+            return self.post(srcId, destId, data);
+        }, py::arg("src_id"), py::arg("dest_id"), py::arg("payload"))
+        .def("post_batch", &nsb::NSBSimClient::postBatch, py::arg("entries"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("set_retain_payloads", &nsb::NSBSimClient::setRetainPayloads, py::arg("retain"));
+}
@@ -5,9 +5,9 @@
 namespace nsb {
 
     SocketInterface::SocketInterface(std::string serverAddress, int serverPort)
-        : serverAddress(serverAddress), serverPort(serverPort) {
+        : serverAddress(serverAddress), serverPort(serverPort), connected(false) {
             if (connectToServer(SERVER_CONNECTION_TIMEOUT) != 0) {
-                exit(EXIT_FAILURE);
+                LOG(ERROR) << "Could not connect to daemon@" << serverAddress << ":" << serverPort << "." << std::endl;
             }
         }
 
@@ -20,14 +20,17 @@ namespace nsb {
         // Set the target time.
         std::chrono::time_point startTime = std::chrono::system_clock::now();
         std::chrono::time_point targetTime = startTime + std::chrono::seconds(timeout);
+        // Back off exponentially between attempts, so short outages are retried quickly.
+        std::chrono::milliseconds backoff(RECONNECT_INITIAL_BACKOFF_MS);
         // For each channel, try to configure and connect sockets.
         for (Channel channel : Channels) {
             LOG(INFO) << "Configuring & connecting " << getChannelName(channel) << "..." << std::endl;
             while (std::chrono::system_clock::now() < targetTime) {
                 // Try configuring and connecting to the daemon server.
-                int conn = socket(AF_INET, SOCK_STREAM, 0);
+                int conn = socket(isLocal() ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
                 if (conn < 0) {
                     LOG(ERROR) << "\tSocket creation failed." << std::endl;
+                    closeConnection();
                     return -1;
                 }
                 // Configure socket with options for low latency.
@@ -35,27 +38,51 @@ namespace nsb {
                 if (setsockopt(conn, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
                     LOG(ERROR) << "\tCould not set socket option SOL_SOCKET to SO_REUSEADDR." << std::endl;
                     close(conn);
+                    closeConnection();
                     return -1;
                 }
-                if (setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)) < 0) {
+                if (!isLocal() && setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)) < 0) {
                     LOG(ERROR) << "\tCould not set socket option IPPROTO_TCP to TCP_NODELAY." << std::endl;
                     close(conn);
+                    closeConnection();
                     return -1;
                 }
                 if (setsockopt(conn, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt)) < 0) {
                     LOG(ERROR) << "\tCould not set socket option SOL_SOCKET to SO_KEEPALIVE." << std::endl;
                     close(conn);
+                    closeConnection();
                     return -1;
                 }
                 // Attempt to connect.
-                sockaddr_in serverAddrDetails{};
-                serverAddrDetails.sin_family = AF_INET;
-                serverAddrDetails.sin_addr.s_addr = inet_addr(serverAddress.c_str());
-                serverAddrDetails.sin_port = htons(serverPort);
-                if (connect(conn, (struct sockaddr*)&serverAddrDetails, sizeof(serverAddrDetails)) == -1) {
-                    LOG(ERROR) << "\tRetrying connection..." << std::endl;
+                sockaddr_storage serverAddrDetails{};
+                socklen_t serverAddrLen;
+                if (isLocal()) {
+                    // Bind to an abstract address so that the proxy can tell the channels apart.
+                    sockaddr_un localAddr{};
+                    localAddr.sun_family = AF_UNIX;
+                    if (bind(conn, (struct sockaddr*)&localAddr, sizeof(sa_family_t)) == -1) {
+                        LOG(ERROR) << "\tCould not bind local socket." << std::endl;
+                        close(conn);
+                        closeConnection();
+                        return -1;
+                    }
+                    sockaddr_un* proxyAddr = (sockaddr_un*) &serverAddrDetails;
+                    proxyAddr->sun_family = AF_UNIX;
+                    std::string path = serverAddress.substr(std::strlen(LOCAL_ADDRESS_PREFIX));
+                    path.copy(proxyAddr->sun_path, sizeof(proxyAddr->sun_path) - 1);
+                    serverAddrLen = sizeof(sockaddr_un);
+                } else {
+                    sockaddr_in* daemonAddr = (sockaddr_in*) &serverAddrDetails;
+                    daemonAddr->sin_family = AF_INET;
+                    daemonAddr->sin_addr.s_addr = inet_addr(serverAddress.c_str());
+                    daemonAddr->sin_port = htons(serverPort);
+                    serverAddrLen = sizeof(sockaddr_in);
+                }
+                if (connect(conn, (struct sockaddr*)&serverAddrDetails, serverAddrLen) == -1) {
+                    LOG(ERROR) << "\tRetrying connection in " << backoff.count() << " ms..." << std::endl;
                     close(conn);
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                    std::this_thread::sleep_for(backoff);
+                    backoff = std::min(backoff * 2, std::chrono::milliseconds(RECONNECT_MAX_BACKOFF_MS));
                 } else {
                     LOG(INFO) << "\tConnected!" << std::endl;
                     conns.insert({channel, conn});
@@ -65,6 +92,7 @@ namespace nsb {
             // If loop broken due to timeout, that's a problem.
             if (std::chrono::system_clock::now() > targetTime) {
                 LOG(ERROR) << "Connection to server timed out after " << timeout << " seconds." << std::endl;
+                closeConnection();
                 return -1;
             }
         }
@@ -74,35 +102,127 @@ namespace nsb {
             int flags = fcntl(conns.at(channel), F_GETFL, 0);
             if (flags == -1) {
                 LOG(ERROR) << "\tFailed to get flags for socket." << std::endl;
+                closeConnection();
                 return -1;
             }
             if (fcntl(conns.at(channel), F_SETFL, flags | O_NONBLOCK) == -1) {
                 LOG(ERROR) << "\tFailed to set non-blocking mode for socket." << std::endl;
+                closeConnection();
                 return -1;
             }
         }
         LOG(INFO) << "All channels connected!" << std::endl;
+        connected = true;
         return 0;
     }
 
     void SocketInterface::closeConnection() {
         for (Channel channel : Channels) {
-            shutdown(conns.at(channel), SHUT_WR);
-            close(conns.at(channel));
+            auto it = conns.find(channel);
+            if (it != conns.end()) {
+                shutdown(it->second, SHUT_WR);
+                close(it->second);
+                conns.erase(it);
+            }
+        }
+        closeDatagram();
+        connected = false;
+    }
+
+    int SocketInterface::reconnect(int timeout) {
+        closeConnection();
+        return connectToServer(timeout);
+    }
+
+    int SocketInterface::openDatagram() {
+        // Datagrams are not carried through a local proxy.
+        if (isLocal()) {
+            return -1;
+        }
+        int conn = socket(AF_INET, SOCK_DGRAM, 0);
+        if (conn < 0) {
+            LOG(ERROR) << "Datagram socket creation failed." << std::endl;
+            return -1;
+        }
+        // Bind to an ephemeral port so it can be advertised to the daemon.
+        sockaddr_in localAddr{};
+        localAddr.sin_family = AF_INET;
+        localAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+        localAddr.sin_port = 0;
+        socklen_t addrLen = sizeof(localAddr);
+        if (bind(conn, (struct sockaddr*)&localAddr, sizeof(localAddr)) == -1 ||
+            getsockname(conn, (struct sockaddr*)&localAddr, &addrLen) == -1) {
+            LOG(ERROR) << "Could not bind datagram socket." << std::endl;
+            close(conn);
+            return -1;
+        }
+        int flags = fcntl(conn, F_GETFL, 0);
+        if (flags == -1 || fcntl(conn, F_SETFL, flags | O_NONBLOCK) == -1) {
+            LOG(ERROR) << "Failed to set non-blocking mode for datagram socket." << std::endl;
+            close(conn);
+            return -1;
+        }
+        conns[Channel::DGRAM] = conn;
+        return ntohs(localAddr.sin_port);
+    }
+
+    int SocketInterface::localChannelId(const sockaddr_un& address, socklen_t length) {
+        std::size_t name_length = length - offsetof(sockaddr_un, sun_path);
+        if (length <= offsetof(sockaddr_un, sun_path) || address.sun_path[0] != '\0' || name_length < 2) {
+            return -1;
+        }
+        std::string name(address.sun_path + 1, name_length - 1);
+        char* end = nullptr;
+        long id = std::strtol(name.c_str(), &end, 16);
+        return (end != nullptr && *end == '\0' && id >= 0 && id <= INT32_MAX) ? static_cast<int>(id) : -1;
+    }
+
+    int SocketInterface::connectDatagram(int port) {
+        if (conns.find(Channel::DGRAM) == conns.end()) {
+            LOG(ERROR) << "Datagram channel has not been opened." << std::endl;
+            return -1;
+        }
+        sockaddr_in serverAddrDetails{};
+        serverAddrDetails.sin_family = AF_INET;
+        serverAddrDetails.sin_addr.s_addr = inet_addr(serverAddress.c_str());
+        serverAddrDetails.sin_port = htons(port);
+        if (connect(conns.at(Channel::DGRAM), (struct sockaddr*)&serverAddrDetails, sizeof(serverAddrDetails)) == -1) {
+            LOG(ERROR) << "Could not connect datagram channel: " << strerror(errno) << std::endl;
+            closeDatagram();
+            return -1;
+        }
+        LOG(INFO) << "Datagram channel connected to daemon@" << serverAddress << ":" << port << "." << std::endl;
+        return 0;
+    }
+
+    void SocketInterface::closeDatagram() {
+        auto it = conns.find(Channel::DGRAM);
+        if (it != conns.end()) {
+            close(it->second);
+            conns.erase(it);
         }
     }
 
     int SocketInterface::sendMessage(Comms::Channel channel, const std::string& message) {
+        if (conns.find(channel) == conns.end()) {
+            LOG(ERROR) << "Cannot send on " << getChannelName(channel) << ": not connected." << std::endl;
+            return -1;
+        }
         int totalBytesSent = 0;
         int totalSize = message.size();
         while (totalBytesSent < totalSize) {
-            int bytesSent = send(conns.at(channel), message.data() + totalBytesSent, totalSize - totalBytesSent, 0);
+            int bytesSent = send(conns.at(channel), message.data() + totalBytesSent, totalSize - totalBytesSent,
+                                 MSG_NOSIGNAL);
             if (bytesSent < 0) {
                 if (errno == EAGAIN || errno == EWOULDBLOCK) {
                     // May not be read to send yet.
                     continue;
                 } else {
                     LOG(ERROR) << "Failed to send message on " << getChannelName(channel) << ": " << strerror(errno) << std::endl;
+                    // A failed stream channel means the connection to the daemon is gone.
+                    if (channel != Channel::DGRAM) {
+                        connected = false;
+                    }
                     return -1;
                 }
             }
@@ -112,34 +232,55 @@ namespace nsb {
     }
 
     std::string SocketInterface::receiveMessage(Comms::Channel channel, int* timeout) {
+        if (conns.find(channel) == conns.end()) {
+            LOG(ERROR) << "Cannot receive on " << getChannelName(channel) << ": not connected." << std::endl;
+            return std::string();
+        }
         int* fdPtr = &conns.at(channel);
-        // Set up FD for select.
+        // Datagrams may arrive in place of stream messages on the RECV channel.
+        int dgramFd = (channel == Channel::RECV && conns.count(Channel::DGRAM)) ? conns.at(Channel::DGRAM) : -1;
+        // Set up FDs for select.
         fd_set readFDs;
-        FD_ZERO(&readFDs);
-        FD_SET(*fdPtr, &readFDs);
         // Set up data stores.
         std::string message;
         char buffer[RECEIVE_BUFFER_SIZE];
         bool messageExists = false;
         // Wait for messages.
+        timeval timeoutVal{};
         timeval* t;
         if (timeout == nullptr) {
             t = nullptr;
         } else {
-            timeval timeoutVal{};
             timeoutVal.tv_sec = *timeout;
             timeoutVal.tv_usec = 0;
             t = &timeoutVal;
         }
         while (true) {
-            int activity = select(*fdPtr + 1, &readFDs, nullptr, nullptr, t);
+            FD_ZERO(&readFDs);
+            FD_SET(*fdPtr, &readFDs);
+            if (dgramFd != -1) {
+                FD_SET(dgramFd, &readFDs);
+            }
+            int activity = select(std::max(*fdPtr, dgramFd) + 1, &readFDs, nullptr, nullptr, t);
             if (activity < 0) {
                 LOG(ERROR) << "Select error: " << strerror(errno) << std::endl;
                 return std::string();
             } else if (activity == 0) {
-                LOG(WARNING) << "Timeout waiting for message on " << getChannelName(channel) << "." << std::endl;
+                DLOG(INFO) << "Timeout waiting for message on " << getChannelName(channel) << "." << std::endl;
                 return std::string();
             } else {
+                // A datagram always holds exactly one message.
+                if (dgramFd != -1 && FD_ISSET(dgramFd, &readFDs)) {
+                    std::string datagram(MAX_DATAGRAM_SIZE, '\0');
+                    int bytesRead = recv(dgramFd, datagram.data(), datagram.size(), 0);
+                    if (bytesRead > 0) {
+                        datagram.resize(bytesRead);
+                        return datagram;
+                    }
+                    if (!FD_ISSET(*fdPtr, &readFDs)) {
+                        continue;
+                    }
+                }
                 // Read buffer until there's nothing left.
                 int bytesRead = recv(*fdPtr, buffer, RECEIVE_BUFFER_SIZE-1, 0);
                 while (bytesRead > 0) {
@@ -147,6 +288,12 @@ namespace nsb {
                     message.append(buffer, bytesRead);
                     bytesRead = recv(*fdPtr, buffer, RECEIVE_BUFFER_SIZE-1, 0);
                 }
+                // A read of 0 bytes (or a hard error) means the daemon closed the connection.
+                if (bytesRead == 0 || (bytesRead < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    LOG(WARNING) << "Connection closed on " << getChannelName(channel) << "." << std::endl;
+                    connected = false;
+                    return message;
+                }
                 if (messageExists) {
                     return message;
                 }
@@ -166,76 +313,206 @@ namespace nsb {
     DBConnector::~DBConnector() {}
 
     RedisConnector::RedisConnector(const std::string& clientIdentifier, std::string& db_address, int db_port) : 
-        DBConnector(clientIdentifier), address(std::move(db_address)), port(db_port) {
+        RedisConnector(clientIdentifier, std::vector<DBShard>{{std::move(db_address), db_port}}) {}
+
+    RedisConnector::RedisConnector(const std::string& clientIdentifier, const std::vector<DBShard>& db_shards) :
+        DBConnector(clientIdentifier) {
+        for (const DBShard& shard : db_shards) {
+            shards.push_back({shard.address, shard.port, nullptr});
+        }
+        // Place virtual nodes of each shard on the hash ring.
+        for (std::size_t i = 0; i < shards.size(); i++) {
+            for (int v = 0; v < DB_SHARD_VNODES; v++) {
+                std::string point = shards[i].address + ":" + std::to_string(shards[i].port) + "#" + std::to_string(v);
+                ring.emplace_back(hashKey(point), i);
+            }
+        }
+        std::sort(ring.begin(), ring.end());
         // Connect to Redis.
         if (connect()) {
-            LOG(INFO) << "RedisConnector initialized!" << std::endl;
+            LOG(INFO) << "RedisConnector initialized with " << shards.size() << " shard(s)!" << std::endl;
         }
     }
 
     RedisConnector::~RedisConnector() {
-        // Close the connection if it is open.
-        if (isConnected()) {
-            disconnect();
-        }
+        // Close the connections if they are open.
+        disconnect();
         LOG(INFO) << "RedisConnector shut down." << std::endl;
     }
     bool RedisConnector::isConnected() const {
-        // Check if the connection is open.
-        return context != nullptr && context->err == REDIS_OK;
+        // Check if every connection is open.
+        for (const Shard& shard : shards) {
+            if (shard.context == nullptr || shard.context->err != REDIS_OK) {
+                return false;
+            }
+        }
+        return !shards.empty();
     }
     bool RedisConnector::connect() {
-        // Connect to the database and check for errors.
-        context = redisConnect(address.c_str(), port);
-        if (context->err) {
-            LOG(ERROR) << context->errstr << std::endl;
-            return false;
+        // Connect to each database and check for errors.
+        bool connected = true;
+        for (Shard& shard : shards) {
+            // Addresses that are paths are Unix domain sockets.
+            if (!shard.address.empty() && shard.address[0] == '/') {
+                shard.context = redisConnectUnix(shard.address.c_str());
+            } else {
+                shard.context = redisConnect(shard.address.c_str(), shard.port);
+            }
+            if (shard.context == nullptr || shard.context->err) {
+                LOG(ERROR) << shard.address << ":" << shard.port << ": "
+                           << (shard.context ? shard.context->errstr : "allocation failed") << std::endl;
+                connected = false;
+            }
         }
-        return true;
+        return connected;
     }
     void RedisConnector::disconnect() {
         LOG(INFO) << "RedisConnector is gracefully disconnecting." << std::endl;
-        redisFree(context);
+        for (Shard& shard : shards) {
+            if (shard.context != nullptr) {
+                redisFree(shard.context);
+                shard.context = nullptr;
+            }
+        }
+    }
+
+    uint64_t RedisConnector::hashKey(const std::string& value) {
+        // 64-bit FNV-1a, which is stable across processes and platforms.
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : value) {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    std::string RedisConnector::newKey() {
+        std::string id = generatePayloadId();
+        if (shards.size() < 2) {
+            return id;
+        }
+        // Find the first virtual node at or after the ID's hash, wrapping around.
+        auto it = std::lower_bound(ring.begin(), ring.end(), std::make_pair(hashKey(id), std::size_t(0)));
+        std::size_t shard = (it == ring.end()) ? ring.front().second : it->second;
+        return "{" + std::to_string(shard) + "}" + id;
+    }
+
+    std::size_t RedisConnector::shardOf(const std::string& key) const {
+        if (shards.size() < 2 || key.empty() || key[0] != '{') {
+            return 0;
+        }
+        std::size_t shard = 0;
+        for (std::size_t i = 1; i < key.size() && key[i] != '}'; i++) {
+            if (key[i] < '0' || key[i] > '9') {
+                return 0;
+            }
+            shard = shard * 10 + (key[i] - '0');
+        }
+        return shard < shards.size() ? shard : 0;
     }
 
     std::string RedisConnector::store(const std::string& value) {
+        return storeMany({value}).front();
+    }
+
+    std::vector<std::string> RedisConnector::storeMany(const std::vector<std::string>& values) {
+        std::vector<std::string> keys(values.size());
         // Check connection before carrying out operation.
         if (!isConnected()) {
             LOG(ERROR) << "Redis connection is not online. Cannot store payload." << std::endl;
-            return "";
-        }
-        // Store payload.
-        DLOG(INFO) << "Storing payload: " << value << std::endl;
-        std::string key = generatePayloadId();
-        redisReply* reply = (redisReply*)redisCommand(context, "SET %s %s", key.c_str(), value.c_str());
-        if (context->err) {
-            LOG(ERROR) << "(SET Error) " << context->errstr << std::endl;
-            return "";
-        }
-        DLOG(INFO) << "Payload stored. Reply: " << reply->str << std::endl;
-        return key;
+            return keys;
+        }
+        for (std::string& key : keys) {
+            key = newKey();
+        }
+        DLOG(INFO) << "Storing " << values.size() << " payload(s)." << std::endl;
+        setMany(&keys, values, false);
+        return keys;
+    }
+
+    int RedisConnector::restoreMany(const std::vector<std::string>& keys, const std::vector<std::string>& values) {
+        if (keys.empty()) {
+            return 0;
+        }
+        // Check connection before carrying out operation.
+        if (!isConnected()) {
+            LOG(ERROR) << "Redis connection is not online. Cannot restore payloads." << std::endl;
+            return 0;
+        }
+        DLOG(INFO) << "Restoring " << keys.size() << " payload(s)." << std::endl;
+        std::vector<std::string> restored = keys;
+        setMany(&restored, values, true);
+        return static_cast<int>(std::count_if(restored.begin(), restored.end(),
+                                               [](const std::string& key) { return !key.empty(); }));
+    }
+
+    void RedisConnector::setMany(std::vector<std::string>* keys, const std::vector<std::string>& values, bool onlyNew) {
+        // Queue a SET on each payload's shard before reading any reply.
+        std::vector<std::vector<std::size_t>> pending(shards.size());
+        for (std::size_t i = 0; i < keys->size(); i++) {
+            const std::string& key = (*keys)[i];
+            std::size_t shard = shardOf(key);
+            const char* argv[] = {"SET", key.c_str(), values[i].data(), "NX"};
+            const std::size_t argvlen[] = {3, key.size(), values[i].size(), 2};
+            redisAppendCommandArgv(shards[shard].context, onlyNew ? 4 : 3, argv, argvlen);
+            pending[shard].push_back(i);
+        }
+        for (std::size_t shard = 0; shard < shards.size(); shard++) {
+            for (std::size_t i : pending[shard]) {
+                redisReply* reply = nullptr;
+                if (redisGetReply(shards[shard].context, (void**)&reply) != REDIS_OK || reply == nullptr) {
+                    LOG(ERROR) << "(SET Error) " << shards[shard].context->errstr << std::endl;
+                    (*keys)[i].clear();
+                    continue;
+                }
+                if (reply->type == REDIS_REPLY_ERROR) {
+                    LOG(ERROR) << "(SET Error) " << std::string(reply->str, reply->len) << std::endl;
+                    (*keys)[i].clear();
+                } else if (reply->type == REDIS_REPLY_NIL) {
+                    // The key already existed (SET NX).
+                    (*keys)[i].clear();
+                }
+                freeReplyObject(reply);
+            }
+        }
     }
 
     std::string RedisConnector::checkOut(const std::string& key) {
+        return checkOutMany({key}).front();
+    }
+
+    std::vector<std::string> RedisConnector::checkOutMany(const std::vector<std::string>& keys) {
+        std::vector<std::string> payloads(keys.size());
         // Check connection before carrying out operation.
         if (!isConnected()) {
-            LOG(ERROR) << "Redis connection is not online. Cannot store payload." << std::endl;
-            return "";
+            LOG(ERROR) << "Redis connection is not online. Cannot check out payloads." << std::endl;
+            return payloads;
         }
-        // Retrieve and delete the payload.
-        DLOG(INFO) << "Retrieving payload with key:" << key << std::endl;
-        redisReply* reply = (redisReply*)redisCommand(context, "GETDEL %s", key.c_str());
-        // Check if found else return empty.
-        if (context->err) {
-            LOG(ERROR) << "(GETDEL Error) " << context->errstr << std::endl;
-            return std::string();
+        // Queue a GETDEL on each key's shard before reading any reply.
+        std::vector<std::vector<std::size_t>> pending(shards.size());
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            std::size_t shard = shardOf(keys[i]);
+            const char* argv[] = {"GETDEL", keys[i].c_str()};
+            const std::size_t argvlen[] = {6, keys[i].size()};
+            redisAppendCommandArgv(shards[shard].context, 2, argv, argvlen);
+            pending[shard].push_back(i);
         }
-        if (reply->type != REDIS_REPLY_NIL) {
-            return std::string(reply->str, reply->len);
-        } else {
-            LOG(ERROR) << "(GETDEL Error) Returned nil.";
-            return std::string();
+        DLOG(INFO) << "Retrieving " << keys.size() << " payload(s)." << std::endl;
+        for (std::size_t shard = 0; shard < shards.size(); shard++) {
+            for (std::size_t i : pending[shard]) {
+                redisReply* reply = nullptr;
+                if (redisGetReply(shards[shard].context, (void**)&reply) != REDIS_OK || reply == nullptr) {
+                    LOG(ERROR) << "(GETDEL Error) " << shards[shard].context->errstr << std::endl;
+                    continue;
+                }
+                if (reply->type == REDIS_REPLY_STRING) {
+                    payloads[i].assign(reply->str, reply->len);
+                } else {
+                    LOG(ERROR) << "(GETDEL Error) Returned nil for " << keys[i] << "." << std::endl;
+                }
+                freeReplyObject(reply);
+            }
         }
+        return payloads;
     }
 
     std::string RedisConnector::peek(const std::string& key) {
@@ -246,12 +523,57 @@ namespace nsb {
         }
         // Get payload.
         DLOG(INFO) << "Retrieving payload with key:" << key << std::endl;
-        redisReply* reply = (redisReply*)redisCommand(context, "GET %s", key.c_str());
-        if (reply->type != REDIS_REPLY_NIL) {
-            return std::string(reply->str, reply->len);
+        const char* argv[] = {"GET", key.c_str()};
+        const std::size_t argvlen[] = {3, key.size()};
+        redisReply* reply = (redisReply*)redisCommandArgv(shards[shardOf(key)].context, 2, argv, argvlen);
+        std::string payload;
+        if (reply != nullptr && reply->type == REDIS_REPLY_STRING) {
+            payload.assign(reply->str, reply->len);
         } else {
-            LOG(ERROR) << "(GET Error) Returned nil.";
-            return std::string();
+            LOG(ERROR) << "(GET Error) Returned nil." << std::endl;
+        }
+        if (reply != nullptr) {
+            freeReplyObject(reply);
+        }
+        return payload;
+    }
+
+    int RedisConnector::reclaim(const std::vector<std::string>& keys) {
+        if (keys.empty()) {
+            return 0;
+        }
+        // Check connection before carrying out operation.
+        if (!isConnected()) {
+            LOG(ERROR) << "Redis connection is not online. Cannot reclaim payloads." << std::endl;
+            return 0;
+        }
+        // Delete all keys with one command per shard.
+        std::vector<std::vector<const char*>> argv(shards.size(), {"DEL"});
+        std::vector<std::vector<std::size_t>> argvlen(shards.size(), {3});
+        for (const std::string& key : keys) {
+            std::size_t shard = shardOf(key);
+            argv[shard].push_back(key.c_str());
+            argvlen[shard].push_back(key.size());
+        }
+        for (std::size_t shard = 0; shard < shards.size(); shard++) {
+            if (argv[shard].size() > 1) {
+                redisAppendCommandArgv(shards[shard].context, argv[shard].size(), argv[shard].data(), argvlen[shard].data());
+            }
+        }
+        DLOG(INFO) << "Reclaiming " << keys.size() << " payload(s)." << std::endl;
+        int deleted = 0;
+        for (std::size_t shard = 0; shard < shards.size(); shard++) {
+            if (argv[shard].size() <= 1) {
+                continue;
+            }
+            redisReply* reply = nullptr;
+            if (redisGetReply(shards[shard].context, (void**)&reply) != REDIS_OK || reply == nullptr) {
+                LOG(ERROR) << "(DEL Error) " << shards[shard].context->errstr << std::endl;
+                continue;
+            }
+            deleted += reply->type == REDIS_REPLY_INTEGER ? static_cast<int>(reply->integer) : 0;
+            freeReplyObject(reply);
         }
+        return deleted;
     }
 }
\ No newline at end of file
@@ -0,0 +1,225 @@
+// nsb_checksum.cc
+
+#include "nsb_checksum.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#endif
+
+namespace nsb {
+
+    namespace {
+        /** @brief The reflected CRC32C polynomial. */
+        const uint32_t CRC32C_POLY = 0x82F63B78;
+        /** @brief Bytes per stream when interleaving three streams over large buffers. */
+        const std::size_t CRC32C_LONG_BLOCK = 8192;
+        /** @brief Bytes per stream when interleaving three streams over medium buffers. */
+        const std::size_t CRC32C_SHORT_BLOCK = 256;
+
+        /** @brief Tables for the slicing-by-8 software implementation. */
+        struct SliceTables {
+            std::array<std::array<uint32_t, 256>, 8> table;
+            SliceTables() {
+                for (uint32_t i = 0; i < 256; i++) {
+                    uint32_t crc = i;
+                    for (int bit = 0; bit < 8; bit++) {
+                        crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+                    }
+                    table[0][i] = crc;
+                }
+                for (uint32_t i = 0; i < 256; i++) {
+                    for (int k = 1; k < 8; k++) {
+                        table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+                    }
+                }
+            }
+        };
+        const SliceTables& sliceTables() {
+            static const SliceTables tables;
+            return tables;
+        }
+
+        /** @brief Updates a CRC register (without inversion) in software. */
+        uint32_t crcSoftware(uint32_t crc, const unsigned char* p, std::size_t n) {
+            const auto& t = sliceTables().table;
+            while (n >= 8) {
+                uint32_t lo, hi;
+                std::memcpy(&lo, p, 4);
+                std::memcpy(&hi, p + 4, 4);
+                lo ^= crc;
+                crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                      t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+                p += 8;
+                n -= 8;
+            }
+            while (n--) {
+                crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+            }
+            return crc;
+        }
+
+        /**
+         * @brief Advances a CRC register over a fixed number of zero bytes.
+         *
+         * The register after a block B is crc(r, B) = crc(0, B) ^ shift(r),
+         * where shift() is linear in r, so three streams over consecutive
+         * blocks can be computed independently and combined with it.
+         */
+        struct ZeroShift {
+            std::array<std::array<uint32_t, 256>, 4> table;
+            explicit ZeroShift(std::size_t length) {
+                std::array<uint32_t, 32> basis;
+                std::array<unsigned char, CRC32C_LONG_BLOCK> zeros{};
+                for (int bit = 0; bit < 32; bit++) {
+                    basis[bit] = crcSoftware(uint32_t(1) << bit, zeros.data(), length);
+                }
+                for (int k = 0; k < 4; k++) {
+                    for (uint32_t v = 0; v < 256; v++) {
+                        uint32_t shifted = 0;
+                        for (int bit = 0; bit < 8; bit++) {
+                            if (v & (1u << bit)) {
+                                shifted ^= basis[8 * k + bit];
+                            }
+                        }
+                        table[k][v] = shifted;
+                    }
+                }
+            }
+            uint32_t operator()(uint32_t crc) const {
+                return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^
+                       table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+            }
+        };
+        const ZeroShift& longShift() {
+            static const ZeroShift shift(CRC32C_LONG_BLOCK);
+            return shift;
+        }
+        const ZeroShift& shortShift() {
+            static const ZeroShift shift(CRC32C_SHORT_BLOCK);
+            return shift;
+        }
+
+#if defined(__x86_64__)
+        bool hardwareAvailable() {
+            // Needed as this runs during static initialization.
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.2");
+        }
+        const char* const HARDWARE_NAME = "sse4.2";
+
+        __attribute__((target("sse4.2")))
+        uint64_t crcStep64(uint64_t crc, const unsigned char* p) {
+            uint64_t value;
+            std::memcpy(&value, p, 8);
+            return _mm_crc32_u64(crc, value);
+        }
+        __attribute__((target("sse4.2")))
+        uint32_t crcStep8(uint32_t crc, unsigned char value) {
+            return _mm_crc32_u8(crc, value);
+        }
+#define NSB_CRC32C_TARGET __attribute__((target("sse4.2")))
+#elif defined(__aarch64__)
+        bool hardwareAvailable() {
+#if defined(__APPLE__)
+            return true;
+#elif defined(__linux__)
+            return getauxval(AT_HWCAP) & HWCAP_CRC32;
+#else
+            return false;
+#endif
+        }
+        const char* const HARDWARE_NAME = "armv8";
+
+        __attribute__((target("+crc")))
+        uint64_t crcStep64(uint64_t crc, const unsigned char* p) {
+            uint64_t value;
+            std::memcpy(&value, p, 8);
+            return __crc32cd(static_cast<uint32_t>(crc), value);
+        }
+        __attribute__((target("+crc")))
+        uint32_t crcStep8(uint32_t crc, unsigned char value) {
+            return __crc32cb(crc, value);
+        }
+#define NSB_CRC32C_TARGET __attribute__((target("+crc")))
+#endif
+
+#if defined(NSB_CRC32C_TARGET)
+        /** @brief Runs three streams over three consecutive blocks of a given length. */
+        NSB_CRC32C_TARGET inline __attribute__((always_inline))
+        uint32_t crcTriple(uint32_t crc, const unsigned char* p, std::size_t length, const ZeroShift& shift) {
+            uint64_t a = crc, b = 0, c = 0;
+            for (std::size_t i = 0; i < length; i += 8) {
+                a = crcStep64(a, p + i);
+                b = crcStep64(b, p + length + i);
+                c = crcStep64(c, p + 2 * length + i);
+            }
+            return shift(shift(static_cast<uint32_t>(a)) ^ static_cast<uint32_t>(b)) ^ static_cast<uint32_t>(c);
+        }
+
+        /** @brief Updates a CRC register (without inversion) with the CRC instructions. */
+        NSB_CRC32C_TARGET
+        uint32_t crcHardware(uint32_t crc, const unsigned char* p, std::size_t n) {
+            // Align to 8 bytes.
+            while (n > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+                crc = crcStep8(crc, *p++);
+                n--;
+            }
+            const ZeroShift& long_shift = longShift();
+            while (n >= 3 * CRC32C_LONG_BLOCK) {
+                crc = crcTriple(crc, p, CRC32C_LONG_BLOCK, long_shift);
+                p += 3 * CRC32C_LONG_BLOCK;
+                n -= 3 * CRC32C_LONG_BLOCK;
+            }
+            const ZeroShift& short_shift = shortShift();
+            while (n >= 3 * CRC32C_SHORT_BLOCK) {
+                crc = crcTriple(crc, p, CRC32C_SHORT_BLOCK, short_shift);
+                p += 3 * CRC32C_SHORT_BLOCK;
+                n -= 3 * CRC32C_SHORT_BLOCK;
+            }
+            uint64_t wide = crc;
+            while (n >= 8) {
+                wide = crcStep64(wide, p);
+                p += 8;
+                n -= 8;
+            }
+            crc = static_cast<uint32_t>(wide);
+            while (n--) {
+                crc = crcStep8(crc, *p++);
+            }
+            return crc;
+        }
+#undef NSB_CRC32C_TARGET
+#else
+        bool hardwareAvailable() {
+            return false;
+        }
+        const char* const HARDWARE_NAME = "software";
+
+        uint32_t crcHardware(uint32_t crc, const unsigned char* p, std::size_t n) {
+            return crcSoftware(crc, p, n);
+        }
+#endif
+
+        const bool USE_HARDWARE = hardwareAvailable();
+    }
+
+    uint32_t crc32c(const void* data, std::size_t size, uint32_t crc) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        crc = ~crc;
+        crc = USE_HARDWARE ? crcHardware(crc, p, size) : crcSoftware(crc, p, size);
+        return ~crc;
+    }
+
+    const char* crc32cImplementation() {
+        return USE_HARDWARE ? HARDWARE_NAME : "software";
+    }
+}
@@ -4,6 +4,134 @@
 
 namespace nsb {
 
+    PayloadPrefetcher::PayloadPrefetcher(const std::string& clientIdentifier, const std::vector<DBShard>& dbShards)
+        : db(clientIdentifier, dbShards), worker(&PayloadPrefetcher::run, this) {}
+
+    PayloadPrefetcher::~PayloadPrefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    void PayloadPrefetcher::prefetch(const std::vector<std::string>& keys) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            evict(keys.size());
+            Clock::time_point now = Clock::now();
+            for (const std::string& key : keys) {
+                if (payloads.size() >= PREFETCH_MAX_PAYLOADS) {
+                    break;
+                }
+                // Keys still being given back are left to be checked out when delivered.
+                if (returning.count(key) == 0 && payloads.emplace(key, Prefetched{std::nullopt, now}).second) {
+                    queue.push_back(key);
+                    order.emplace_back(key, now);
+                }
+            }
+        }
+        cv.notify_all();
+    }
+
+    bool PayloadPrefetcher::take(const std::string& key, std::string* payload) {
+        std::unique_lock<std::mutex> lock(mutex);
+        // An evicted payload must be back in the database before the caller checks it out.
+        cv.wait(lock, [&] { return returning.count(key) == 0 || stopping; });
+        auto it = payloads.find(key);
+        if (it == payloads.end()) {
+            missCount++;
+            return false;
+        }
+        // Look the key up again after waking, as prefetch() may rehash the map.
+        cv.wait(lock, [&] {
+            it = payloads.find(key);
+            return it == payloads.end() || it->second.payload.has_value() || stopping;
+        });
+        if (it == payloads.end() || !it->second.payload.has_value()) {
+            return false;
+        }
+        *payload = std::move(*it->second.payload);
+        payloads.erase(it);
+        hitCount++;
+        return true;
+    }
+
+    void PayloadPrefetcher::evict(std::size_t room) {
+        Clock::time_point now = Clock::now();
+        while (!order.empty()) {
+            const auto& [key, since] = order.front();
+            auto it = payloads.find(key);
+            // Skip keys that were taken (and possibly prefetched again since).
+            if (it == payloads.end() || it->second.since != since) {
+                order.pop_front();
+                continue;
+            }
+            bool expired = now - since >= std::chrono::milliseconds(PREFETCH_EXPIRY_MS);
+            if ((!expired && payloads.size() + room <= PREFETCH_MAX_PAYLOADS) || !it->second.payload.has_value()) {
+                break;
+            }
+            if (!it->second.payload->empty()) {
+                returning.insert(key);
+                evicted.emplace_back(key, std::move(*it->second.payload));
+            }
+            payloads.erase(it);
+            order.pop_front();
+        }
+    }
+
+    void PayloadPrefetcher::run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait_for(lock, std::chrono::milliseconds(PREFETCH_EXPIRY_MS),
+                        [&] { return !queue.empty() || !evicted.empty() || stopping; });
+            // Payloads checked out on a pass that raced with stopping are given back on one more.
+            bool last = stopping;
+            if (last) {
+                // Give back everything that was never taken.
+                for (auto& [key, held] : payloads) {
+                    if (held.payload.has_value() && !held.payload->empty()) {
+                        evicted.emplace_back(key, std::move(*held.payload));
+                    }
+                }
+                payloads.clear();
+                queue.clear();
+            } else {
+                evict(0);
+            }
+            // Give back evicted payloads, then check out everything queued so far in one pipeline.
+            std::vector<std::string> keys(queue.begin(), queue.end());
+            queue.clear();
+            std::vector<std::string> evicted_keys, evicted_payloads;
+            for (auto& [key, payload] : evicted) {
+                evicted_keys.push_back(key);
+                evicted_payloads.push_back(std::move(payload));
+            }
+            evicted.clear();
+            lock.unlock();
+            if (!evicted_keys.empty()) {
+                DLOG(INFO) << "Giving back " << evicted_keys.size() << " prefetched payload(s)." << std::endl;
+                db.restoreMany(evicted_keys, evicted_payloads);
+            }
+            std::vector<std::string> fetched = keys.empty() ? std::vector<std::string>() : db.checkOutMany(keys);
+            lock.lock();
+            for (const std::string& key : evicted_keys) {
+                returning.erase(key);
+            }
+            for (std::size_t i = 0; i < keys.size(); i++) {
+                auto it = payloads.find(keys[i]);
+                if (it != payloads.end()) {
+                    it->second.payload = std::move(fetched[i]);
+                }
+            }
+            cv.notify_all();
+            if (last) {
+                return;
+            }
+        }
+    }
+
     NSBClient::NSBClient(const std::string& identifier, std::string serverAddress, int serverPort) : 
         clientId(std::move(identifier)), comms(SocketInterface(serverAddress, serverPort)),
         originIndicator(nullptr), db(nullptr) {}
@@ -24,12 +152,260 @@ namespace nsb {
         }
     }
 
-    void NSBClient::initialize() {
+    int NSBClient::sendDataMessage(const std::string& message) {
+        // Try once more on a resumed session if the connection drops.
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (!ensureConnected()) {
+                return -1;
+            }
+            nsb::Comms::Channel channel = nsb::Comms::Channel::SEND;
+            if (useDatagrams && cfg.USE_DGRAM && static_cast<int>(message.size()) <= cfg.DGRAM_MAX_SIZE) {
+                channel = nsb::Comms::Channel::DGRAM;
+            }
+            if (writeMessage(channel, message) == 0) {
+                return 0;
+            }
+        }
+        return -1;
+    }
+
+    int NSBClient::writeMessage(Comms::Channel channel, const std::string& message) {
+        MetricTimer timer(metrics, ClientMetric::SOCKET_WRITE);
+        if (comms.sendMessage(channel, message) != 0) {
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
+            return -1;
+        }
+        return 0;
+    }
+
+    std::string NSBClient::serialize(const nsb::nsbm& message) {
+        MetricTimer timer(metrics, ClientMetric::SERIALIZE);
+        return message.SerializeAsString();
+    }
+
+    bool NSBClient::parse(const std::string& data, nsb::nsbm* message) {
+        MetricTimer timer(metrics, ClientMetric::PARSE);
+        if (!message->ParseFromString(data)) {
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
+            return false;
+        }
+        return true;
+    }
+
+    bool NSBClient::ensureConnected() {
+        return comms.isConnected() || reconnect();
+    }
+
+    bool NSBClient::reconnect() {
+        LOG(WARNING) << "Reconnecting " << clientId << " to NSB daemon..." << std::endl;
+        if (comms.reconnect(SERVER_CONNECTION_TIMEOUT) != 0) {
+            LOG(ERROR) << "Could not reconnect to NSB daemon." << std::endl;
+            return false;
+        }
+        return initialize();
+    }
+
+    std::string NSBClient::exchange(Comms::Channel channel, const std::string& request, int* timeout) {
+        // Time round trips, but not waits for pushed messages.
+        std::optional<MetricTimer> roundTrip;
+        if (!request.empty()) {
+            roundTrip.emplace(metrics, ClientMetric::DAEMON_RTT);
+        }
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (!ensureConnected()) {
+                break;
+            }
+            if (!request.empty() && writeMessage(channel, request) != 0) {
+                continue;
+            }
+            std::string response = comms.receiveMessage(channel, timeout);
+            // Only retry if the response was lost to a dropped connection.
+            if (!response.empty() || comms.isConnected()) {
+                if (response.empty() && roundTrip) {
+                    roundTrip->setOutcome(ClientMetrics::Outcome::TIMEOUT);
+                }
+                return response;
+            }
+        }
+        if (roundTrip) {
+            roundTrip->setOutcome(ClientMetrics::Outcome::ERROR);
+        }
+        return std::string();
+    }
+
+    bool NSBClient::exchangeBatch(const std::string& request, int timeout, nsb::nsbm* response) {
+        std::string data = exchange(nsb::Comms::Channel::RECV, request, &timeout);
+        while (!data.empty()) {
+            parse(data, response);
+            if (response->manifest().op() != nsb::nsbm::Manifest::NOTIFY) {
+                lastHints = response->hints();
+                // A doorbell that came before an emptying response is stale.
+                if (lastHints.queue_depth() == 0) {
+                    doorbellRung = false;
+                }
+                return true;
+            }
+            doorbellRung = true;
+            prefetchNotified(*response);
+            data = comms.receiveMessage(nsb::Comms::Channel::RECV, &timeout);
+        }
+        return false;
+    }
+
+    std::vector<MessageEntry> NSBClient::unpackBatch(const nsb::nsbm& response, bool retain) {
+        std::vector<MessageEntry> entries;
+        if (response.manifest().code() != nsb::nsbm::Manifest::MESSAGE) {
+            return entries;
+        }
+        const auto& batch = response.batch().entries();
+        // Check out all payloads at once rather than one round trip each.
+        std::vector<std::string> payloads;
+        if (cfg.USE_DB && !retain) {
+            std::vector<std::string> keys;
+            keys.reserve(batch.size());
+            for (const nsb::nsbm::Batch::Entry& entry : batch) {
+                keys.push_back(entry.msg_key());
+            }
+            if (prefetcher) {
+                prefetcher->prefetch(keys);
+                payloads.resize(keys.size());
+                for (std::size_t i = 0; i < keys.size(); i++) {
+                    payloads[i] = checkOutPayload(keys[i]);
+                }
+            } else {
+                MetricTimer timer(metrics, ClientMetric::DB_CHECKOUT);
+                payloads = db->checkOutMany(keys);
+            }
+        }
+        entries.reserve(batch.size());
+        for (int i = 0; i < batch.size(); i++) {
+            const nsb::nsbm::Batch::Entry& entry = batch[i];
+            // Repack it in MessageEntry format with the full payload.
+            std::string payload;
+            if (!cfg.USE_DB) {
+                payload = entry.payload();
+            } else if (retain) {
+                MetricTimer timer(metrics, ClientMetric::DB_CHECKOUT);
+                payload = db->peek(entry.msg_key());
+            } else {
+                payload = std::move(payloads[i]);
+            }
+            entries.emplace_back(entry.metadata().src_id(), entry.metadata().dest_id(),
+                                 std::move(payload), entry.metadata().payload_size());
+            if (!verifyChecksum(entry.metadata(), &entries.back())) {
+                entries.pop_back();
+                continue;
+            }
+            if (cfg.USE_DB && retain) {
+                entries.back().payload_key = entry.msg_key();
+            }
+        }
+        return entries;
+    }
+
+    void NSBClient::setChecksum(const std::string& payload, nsb::nsbm::Metadata* metadata,
+                                std::optional<uint32_t> checksum) {
+        if (cfg.USE_CHECKSUM) {
+            metadata->set_payload_crc32c(checksum ? *checksum : crc32c(payload.data(), payload.size()));
+        }
+    }
+
+    bool NSBClient::verifyChecksum(const nsb::nsbm::Metadata& metadata, MessageEntry* entry) {
+        if (!metadata.has_payload_crc32c()) {
+            return true;
+        }
+        entry->checksum = metadata.payload_crc32c();
+        if (crc32c(entry->payload_obj.data(), entry->payload_obj.size()) == *entry->checksum) {
+            return true;
+        }
+        checksumFailureCount++;
+        LOG(ERROR) << "Discarding payload from " << entry->source << " to " << entry->destination
+                   << ": checksum mismatch (" << entry->payload_obj.size() << " B)." << std::endl;
+        return false;
+    }
+
+    std::string NSBClient::checkOutPayload(const std::string& key) {
+        MetricTimer timer(metrics, ClientMetric::DB_CHECKOUT);
+        std::string payload;
+        if (prefetcher && prefetcher->take(key, &payload)) {
+            return payload;
+        }
+        return db->checkOut(key);
+    }
+
+    void NSBClient::prefetchNotified(const nsb::nsbm& notification) {
+        if (!prefetcher || !notification.has_batch()) {
+            return;
+        }
+        std::vector<std::string> keys;
+        keys.reserve(notification.batch().entries_size());
+        for (const nsb::nsbm::Batch::Entry& entry : notification.batch().entries()) {
+            keys.push_back(entry.msg_key());
+        }
+        prefetcher->prefetch(keys);
+    }
+
+    void NSBClient::setPrefetchPayloads(bool enable) {
+        if (!enable) {
+            prefetcher.reset();
+        } else if (!cfg.USE_DB) {
+            LOG(WARNING) << "Payloads are only prefetched when the database is in use." << std::endl;
+        } else if (retainPayloads) {
+            LOG(WARNING) << "Payloads are not prefetched while they are retained." << std::endl;
+        } else if (!prefetcher) {
+            prefetcher = std::make_unique<PayloadPrefetcher>(clientId, cfg.dbShards());
+        }
+    }
+
+    int NSBClient::awaitDoorbell(int timeout) {
+        if (cfg.SYSTEM_MODE != Config::SystemMode::PULL) {
+            LOG(ERROR) << "NOTIFY: Doorbells are only rung in PULL mode." << std::endl;
+            return -1;
+        }
+        if (!doorbellEnabled) {
+            LOG(ERROR) << "NOTIFY: Doorbells are not enabled (see setDoorbellEnabled())." << std::endl;
+            return -1;
+        }
+        if (doorbellRung) {
+            doorbellRung = false;
+            return lastHints.queue_depth();
+        }
+        if (!ensureConnected()) {
+            return -1;
+        }
+        std::string data = comms.receiveMessage(nsb::Comms::Channel::RECV, timeout < 0 ? nullptr : &timeout);
+        if (data.empty()) {
+            return comms.isConnected() ? 0 : -1;
+        }
+        nsb::nsbm notification;
+        notification.ParseFromString(data);
+        if (notification.manifest().op() != nsb::nsbm::Manifest::NOTIFY) {
+            LOG(WARNING) << "NOTIFY: Unexpected operation over RECV channel: "
+                         << nsb::nsbm::Manifest::Operation_Name(notification.manifest().op()) << std::endl;
+            return 0;
+        }
+        lastHints = notification.hints();
+        prefetchNotified(notification);
+        DLOG(INFO) << "NOTIFY: " << lastHints.queue_depth() << " message(s) waiting ("
+                   << lastHints.queue_bytes() << " B)." << std::endl;
+        return lastHints.queue_depth();
+    }
+
+    bool NSBClient::initialize() {
         // Check to see if client is from a derived class (it should be).
         if (originIndicator == nullptr) {
             LOG(ERROR) << "INIT: initialize() called without setting originIndicator." << std::endl;
-            return;
+            return false;
         }
+        if (!comms.isConnected()) {
+            LOG(ERROR) << "INIT: Not connected to NSB daemon." << std::endl;
+            return false;
+        }
+        // Leave the client disconnected on failure so that it tries again later.
+        auto fail = [this]() {
+            comms.closeConnection();
+            return false;
+        };
         LOG(INFO) << "INIT: Initializing " << clientId << " with NSB daemon..." << std::endl;
         // Create and populate an INIT message.
         nsb::nsbm nsbMsg = nsb::nsbm();
@@ -39,6 +415,10 @@ namespace nsb {
         mutableManifest->set_code(nsb::nsbm::Manifest::SUCCESS);
         nsb::nsbm::IntroDetails* mutableIntro = nsbMsg.mutable_intro();
         mutableIntro->set_identifier(clientId);
+        // Present the session token to resume the session after a reconnect.
+        if (!sessionToken.empty()) {
+            mutableIntro->set_session_token(sessionToken);
+        }
         // Function to get and set address and channel port information.
         auto getSetChannelAddrPort = [&](Comms::Channel channel, bool setAddress) {
             struct sockaddr_storage addr;
@@ -49,6 +429,20 @@ namespace nsb {
                     << comms.getChannelName(channel) << " channel." << std::endl;
                 return -1;
             }
+            // Channels to a local proxy advertise the identifiers of their abstract addresses instead.
+            if (addr.ss_family == AF_UNIX) {
+                int id = SocketInterface::localChannelId(*(struct sockaddr_un*) &addr, addrLen);
+                switch(channel) {
+                    case Comms::Channel::CTRL: mutableIntro->set_ch_ctrl(id); break;
+                    case Comms::Channel::SEND: mutableIntro->set_ch_send(id); break;
+                    case Comms::Channel::RECV: mutableIntro->set_ch_recv(id); break;
+                    default: LOG(ERROR) << "INIT: Unexpected channel. Exiting initialization." << std::endl; return -1;
+                }
+                if (setAddress) {
+                    mutableIntro->set_address("unix");
+                }
+                return 0;
+            }
             if (addr.ss_family == AF_INET) {
                 s = (struct sockaddr_in*) &addr;
                 switch(channel) {
@@ -62,7 +456,7 @@ namespace nsb {
                 }
                 return 0;
             } else {
-                LOG(ERROR) << "INIT: Only IPv4 (AF_INET) is currently supported." << std::endl;
+                LOG(ERROR) << "INIT: Only IPv4 (AF_INET) and local proxies are currently supported." << std::endl;
                 return -1;
             }
         };
@@ -70,6 +464,11 @@ namespace nsb {
         getSetChannelAddrPort(Comms::Channel::CTRL, true);
         getSetChannelAddrPort(Comms::Channel::SEND, false);
         getSetChannelAddrPort(Comms::Channel::RECV, false);
+        // Open the datagram channel in case the daemon supports it.
+        int dgramPort = comms.openDatagram();
+        if (dgramPort > 0) {
+            mutableIntro->set_ch_dgram(dgramPort);
+        }
         // Send the message.
         DLOG(INFO) << "INIT: Sending message:" << std::endl << nsbMsg.DebugString();
         comms.sendMessage(nsb::Comms::Channel::CTRL, nsbMsg.SerializeAsString());
@@ -79,7 +478,7 @@ namespace nsb {
         // Check for empty string.
         if (response.empty()) {
             LOG(ERROR) << "INIT: No response received from daemon." << std::endl;
-            return;
+            return fail();
         }
         // Parse in message.
         nsb::nsbm nsbResponse = nsb::nsbm();
@@ -88,32 +487,54 @@ namespace nsb {
         if (nsbResponse.manifest().op() == nsb::nsbm::Manifest::INIT) {
             if (nsbResponse.manifest().code() != nsb::nsbm::Manifest::SUCCESS) {
                 LOG(ERROR) << "INIT: Initialization failed." << std::endl;
-                std::exit(EXIT_FAILURE);
+                return fail();
             }
             // Get the configuration.
             if (nsbResponse.has_config()) {
                 cfg = Config(nsbResponse);
+                // Keep the session token to resume the session after a reconnect.
+                if (!sessionToken.empty()) {
+                    if (nsbResponse.config().resumed()) {
+                        LOG(INFO) << "INIT: Session resumed." << std::endl;
+                    } else {
+                        LOG(WARNING) << "INIT: Session expired, started a new session." << std::endl;
+                    }
+                }
+                sessionToken = nsbResponse.config().session_token();
                 LOG(INFO) << "INIT: Configuration received: Mode " << (int) cfg.SYSTEM_MODE
                           << " | Sim " << (int) cfg.SIMULATOR_MODE
-                          << " | Use DB? " << cfg.USE_DB << std::endl;
-                // Set up database if necessary.
-                if (cfg.USE_DB) {
-                    db = new RedisConnector(clientId, cfg.DB_ADDRESS, cfg.DB_PORT);
+                          << " | Use DB? " << cfg.USE_DB
+                          << " | Use DGRAM? " << cfg.USE_DGRAM << std::endl;
+                // Connect the datagram channel if negotiated, else release it.
+                if (cfg.USE_DGRAM && (dgramPort <= 0 || comms.connectDatagram(cfg.DGRAM_PORT) != 0)) {
+                    LOG(WARNING) << "INIT: Datagram channel unavailable, using stream channels only." << std::endl;
+                    cfg.USE_DGRAM = false;
+                }
+                if (!cfg.USE_DGRAM) {
+                    comms.closeDatagram();
+                }
+                // Set up database if necessary (once, as resuming keeps the connector).
+                if (cfg.USE_DB && db == nullptr) {
+                    db = new RedisConnector(clientId, cfg.dbShards());
                     if (db->isConnected()) {
                         LOG(INFO) << "INIT: Connected to RedisConnecter@" << cfg.DB_ADDRESS << ":" << cfg.DB_PORT;
                     } else {
                         LOG(ERROR) << "INIT: Failed to connect to Redis server. Ensure that it is online." << std::endl;
-                        std::exit(EXIT_FAILURE);
+                        delete db;
+                        db = nullptr;
+                        cfg = Config();
+                        return fail();
                     }
                 }
-                return;
+                return true;
             } else {
                 LOG(ERROR) << "INIT: No configuration found." << std::endl;
-                return;
+                return fail();
             }
         } else {
             LOG(ERROR) << "INIT: Unexpected operation received: " << 
                 nsb::nsbm::Manifest::Operation_Name(nsbResponse.manifest().op()) << std::endl;
+            return fail();
         }
     }
 
@@ -132,10 +553,8 @@ namespace nsb {
         mutableManifest->set_code(nsb::nsbm::Manifest::SUCCESS);
         // Send the message.
         DLOG(INFO) << "PING: Sending message:" << std::endl << nsbMsg.DebugString();
-        comms.sendMessage(nsb::Comms::Channel::CTRL, nsbMsg.SerializeAsString());
-        // Wait for response.
         int timeout = DAEMON_RESPONSE_TIMEOUT;
-        std::string response = comms.receiveMessage(nsb::Comms::Channel::CTRL, &timeout);
+        std::string response = exchange(nsb::Comms::Channel::CTRL, nsbMsg.SerializeAsString(), &timeout);
         // Check for empty string.
         if (response.empty()) {
             LOG(ERROR) << "PING: No response received from daemon." << std::endl;
@@ -164,6 +583,114 @@ namespace nsb {
         return false;
     }
 
+    nsb::nsbm::StatsReport NSBClient::daemonStats() {
+        // Check to see if client is from a derived class (it should be).
+        if (originIndicator == nullptr) {
+            LOG(ERROR) << "STATS: daemonStats() called without setting originIndicator." << std::endl;
+            return nsb::nsbm::StatsReport();
+        }
+        // Create and populate a STATS message.
+        nsb::nsbm nsbMsg = nsb::nsbm();
+        nsb::nsbm::Manifest* mutableManifest = nsbMsg.mutable_manifest();
+        mutableManifest->set_op(nsb::nsbm::Manifest::STATS);
+        mutableManifest->set_og(*originIndicator);
+        mutableManifest->set_code(nsb::nsbm::Manifest::CLIENT_REQUEST);
+        // Send the message.
+        DLOG(INFO) << "STATS: Sending request:" << std::endl << nsbMsg.DebugString();
+        int timeout = DAEMON_RESPONSE_TIMEOUT;
+        std::string response = exchange(nsb::Comms::Channel::CTRL, nsbMsg.SerializeAsString(), &timeout);
+        if (response.empty()) {
+            LOG(ERROR) << "STATS: No response received from daemon." << std::endl;
+            return nsb::nsbm::StatsReport();
+        }
+        // Parse in message.
+        nsb::nsbm nsbResponse = nsb::nsbm();
+        nsbResponse.ParseFromString(response);
+        if (nsbResponse.manifest().op() != nsb::nsbm::Manifest::STATS || !nsbResponse.has_stats()) {
+            LOG(ERROR) << "STATS: Unexpected operation received: " << 
+                nsb::nsbm::Manifest::Operation_Name(nsbResponse.manifest().op()) << std::endl;
+            return nsb::nsbm::StatsReport();
+        }
+        return nsbResponse.stats();
+    }
+
+    std::string NSBClient::profileDaemon(int durationMs, int frequencyHz, const std::string& path) {
+        // Check to see if client is from a derived class (it should be).
+        if (originIndicator == nullptr) {
+            LOG(ERROR) << "PROFILE: profileDaemon() called without setting originIndicator." << std::endl;
+            return "";
+        }
+        // Create and populate a PROFILE message.
+        nsb::nsbm nsbMsg = nsb::nsbm();
+        nsb::nsbm::Manifest* mutableManifest = nsbMsg.mutable_manifest();
+        mutableManifest->set_op(nsb::nsbm::Manifest::PROFILE);
+        mutableManifest->set_og(*originIndicator);
+        mutableManifest->set_code(nsb::nsbm::Manifest::CLIENT_REQUEST);
+        nsb::nsbm::ProfileRequest* profile = nsbMsg.mutable_profile();
+        profile->set_duration_ms(durationMs);
+        profile->set_frequency_hz(frequencyHz);
+        profile->set_path(path);
+        // Send the message.
+        DLOG(INFO) << "PROFILE: Sending request:" << std::endl << nsbMsg.DebugString();
+        int timeout = DAEMON_RESPONSE_TIMEOUT;
+        std::string response = exchange(nsb::Comms::Channel::CTRL, nsbMsg.SerializeAsString(), &timeout);
+        if (response.empty()) {
+            LOG(ERROR) << "PROFILE: No response received from daemon." << std::endl;
+            return "";
+        }
+        // Parse in message.
+        nsb::nsbm nsbResponse = nsb::nsbm();
+        nsbResponse.ParseFromString(response);
+        if (nsbResponse.manifest().op() != nsb::nsbm::Manifest::PROFILE) {
+            LOG(ERROR) << "PROFILE: Unexpected operation received: " << 
+                nsb::nsbm::Manifest::Operation_Name(nsbResponse.manifest().op()) << std::endl;
+            return "";
+        }
+        if (nsbResponse.manifest().code() != nsb::nsbm::Manifest::SUCCESS) {
+            LOG(WARNING) << "PROFILE: The daemon could not start profiling." << std::endl;
+            return "";
+        }
+        return nsbResponse.profile().path();
+    }
+
+    bool NSBClient::pushMetrics() {
+        // Check to see if client is from a derived class (it should be).
+        if (originIndicator == nullptr) {
+            LOG(ERROR) << "STATS: pushMetrics() called without setting originIndicator." << std::endl;
+            return false;
+        }
+        if (!ensureConnected()) {
+            LOG(ERROR) << "STATS: Not connected to NSB daemon." << std::endl;
+            return false;
+        }
+        // Create and populate a STATS message carrying the metrics.
+        nsb::nsbm nsbMsg = nsb::nsbm();
+        nsb::nsbm::Manifest* mutableManifest = nsbMsg.mutable_manifest();
+        mutableManifest->set_op(nsb::nsbm::Manifest::STATS);
+        mutableManifest->set_og(*originIndicator);
+        mutableManifest->set_code(nsb::nsbm::Manifest::MESSAGE);
+        nsb::nsbm::StatsReport::ClientMetrics* pushed = nsbMsg.mutable_stats()->add_clients();
+        pushed->set_client_id(clientId);
+        for (const ClientMetrics::Snapshot& snap : metrics.snapshots()) {
+            nsb::nsbm::StatsReport::ClientMetrics::Metric* metric = pushed->add_metrics();
+            metric->set_name(snap.name);
+            metric->set_count(snap.count);
+            metric->set_errors(snap.errors);
+            metric->set_timeouts(snap.timeouts);
+            metric->set_empty(snap.empty);
+            metric->set_total_ns(snap.total_ns);
+            metric->set_min_ns(snap.min_ns);
+            metric->set_max_ns(snap.max_ns);
+            metric->set_p50_ns(snap.p50_ns);
+            metric->set_p90_ns(snap.p90_ns);
+            metric->set_p99_ns(snap.p99_ns);
+            metric->set_p999_ns(snap.p999_ns);
+        }
+        // Send the message; the daemon does not respond.
+        DLOG(INFO) << "STATS: Pushing metrics:" << std::endl << nsbMsg.DebugString();
+        return comms.sendMessage(nsb::Comms::Channel::CTRL, nsbMsg.SerializeAsString()) == 0;
+    }
+
     void NSBClient::exit() {
         // Create and populate a PING message.
         nsb::nsbm nsbMsg = nsb::nsbm();
@@ -189,6 +716,14 @@ namespace nsb {
     }
 
     std::string NSBAppClient::send(const std::string destId, std::string payload) {
+        MetricTimer timer(metrics, ClientMetric::SEND);
+        if (!ensureConnected()) {
+            LOG(ERROR) << "SEND: Not connected to NSB daemon." << std::endl;
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
+            return "";
+        }
+        // Keep the SEND channel clear of rejections of previous messages.
+        collectRejections();
         // Create and populate a SEND message.
         nsb::nsbm nsbMsg = nsb::nsbm();
         nsb::nsbm::Manifest* mutableManifest = nsbMsg.mutable_manifest();
@@ -199,10 +734,12 @@ namespace nsb {
         mutableMetadata->set_src_id(clientId);
         mutableMetadata->set_dest_id(destId);
         mutableMetadata->set_payload_size(static_cast<int>(payload.size()));
+        setChecksum(payload, mutableMetadata);
         // Set return to "" by default.
         std::string key = "";
         if (cfg.USE_DB) {
             // Store the payload in the database and get the key.
+            MetricTimer storeTimer(metrics, ClientMetric::DB_STORE);
             key = db->store(payload);
             nsbMsg.set_msg_key(key);
         } else {
@@ -210,50 +747,126 @@ namespace nsb {
         }
         // Send the message.
         DLOG(INFO) << "SEND: Sending message:" << std::endl << nsbMsg.DebugString();
-        comms.sendMessage(nsb::Comms::Channel::SEND, nsbMsg.SerializeAsString());
+        if (sendDataMessage(serialize(nsbMsg)) != 0) {
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
+        }
         // Return key in case it's useful.
         return key;
     }
 
+    void NSBAppClient::collectRejections() {
+        int fd = comms.getFd(Comms::Channel::SEND);
+        if (fd == -1) {
+            return;
+        }
+        if (fd != rejectionFd) {
+            rejectionFrames.clear();
+            rejectionFd = fd;
+        }
+        char buffer[RECEIVE_BUFFER_SIZE];
+        ssize_t bytesRead;
+        while ((bytesRead = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            rejectionFrames.append(buffer, bytesRead);
+        }
+        // Each rejection is framed on its own; a partial one is kept for the next read.
+        std::string frame;
+        int status;
+        while ((status = rejectionFrames.next(&frame)) == 1) {
+            nsb::nsbm response;
+            if (!response.ParseFromString(frame) || response.manifest().op() != nsb::nsbm::Manifest::SEND ||
+                response.manifest().code() != nsb::nsbm::Manifest::FAILURE) {
+                LOG(WARNING) << "SEND: Unexpected response on the SEND channel." << std::endl;
+                continue;
+            }
+            LOG(WARNING) << "SEND: Daemon rejected a message to " << response.metadata().dest_id()
+                         << " (rate limited)." << std::endl;
+            MessageEntry message(response.metadata().src_id(), response.metadata().dest_id(), "",
+                                 response.metadata().payload_size());
+            message.payload_key = response.msg_key();
+            if (response.metadata().has_payload_crc32c()) {
+                message.checksum = response.metadata().payload_crc32c();
+            }
+            rejected.push_back(std::move(message));
+            if (rejected.size() > MAX_REJECTED_ENTRIES) {
+                rejected.pop_front();
+            }
+            rejectedSendCount++;
+        }
+        if (status < 0) {
+            LOG(WARNING) << "SEND: Unframed data on the SEND channel; discarding it." << std::endl;
+            rejectionFrames.clear();
+        }
+    }
+
+    int64_t NSBAppClient::rejectedSends() {
+        collectRejections();
+        return rejectedSendCount;
+    }
+
+    std::vector<MessageEntry> NSBAppClient::takeRejected() {
+        collectRejections();
+        std::vector<MessageEntry> taken(std::make_move_iterator(rejected.begin()),
+                                        std::make_move_iterator(rejected.end()));
+        rejected.clear();
+        return taken;
+    }
+
+    std::string NSBAppClient::receiveRequest(std::string* destId, int maxBatch) {
+        // Create and populate a RECEIVE message.
+        nsb::nsbm nsbMsg;
+        nsb::nsbm::Manifest* mutableManifest = nsbMsg.mutable_manifest();
+        mutableManifest->set_op(nsb::nsbm::Manifest::RECEIVE);
+        mutableManifest->set_og(*originIndicator);
+        mutableManifest->set_code(nsb::nsbm::Manifest::SUCCESS);
+        // If destId is not specified, set it to its own ID.
+        nsbMsg.mutable_metadata()->set_dest_id(destId != nullptr ? *destId : clientId);
+        if (maxBatch != 0) {
+            nsbMsg.set_max_batch(maxBatch);
+            nsbMsg.set_arm_doorbell(doorbellEnabled);
+        }
+        DLOG(INFO) << "RECV: Sending request:" << std::endl << nsbMsg.DebugString();
+        return serialize(nsbMsg);
+    }
+
     MessageEntry NSBAppClient::receive(std::string* destId, int timeout) {
-        nsb::nsbm* nsbMsg = new nsb::nsbm();
+        MetricTimer timer(metrics, ClientMetric::RECEIVE);
+        nsb::nsbm nsbMsg;
+        std::string request = "";
         if (cfg.SYSTEM_MODE == Config::SystemMode::PULL) {
-            // Create and populate a RECEIVE message.
-            nsb::nsbm::Manifest* mutableManifest = nsbMsg->mutable_manifest();
-            mutableManifest->set_op(nsb::nsbm::Manifest::RECEIVE);
-            mutableManifest->set_og(*originIndicator);
-            mutableManifest->set_code(nsb::nsbm::Manifest::SUCCESS);
-            // If destId is not specified, set it to its own ID.
-            if (destId == nullptr) {
-                destId = new std::string(clientId);
-            }
-            nsbMsg->mutable_metadata()->set_dest_id(*destId);
-            // Send the message.
-            DLOG(INFO) << "RECV: Sending request:" << std::endl << nsbMsg->DebugString();
-            comms.sendMessage(nsb::Comms::Channel::RECV, nsbMsg->SerializeAsString());
-        }
-        // Wait for response or incoming message.
-        std::string response = comms.receiveMessage(nsb::Comms::Channel::RECV, &timeout);
+            request = receiveRequest(destId);
+        }
+        // Send any request, then wait for response or incoming message.
+        std::string response = exchange(nsb::Comms::Channel::RECV, request, &timeout);
         if (response.empty()) {
-            LOG(ERROR) << "RECV: No response received from daemon." << std::endl;
+            // In PUSH mode, nothing arriving within the timeout is expected.
+            if (cfg.SYSTEM_MODE == Config::SystemMode::PULL) {
+                LOG(ERROR) << "RECV: No response received from daemon." << std::endl;
+            }
+            timer.setOutcome(ClientMetrics::Outcome::TIMEOUT);
             return MessageEntry();
         }
         // Parse in message.
-        nsbMsg->ParseFromString(response);
-        nsb::nsbm::Manifest manifest = nsbMsg->manifest();
+        parse(response, &nsbMsg);
+        lastHints = nsbMsg.hints();
+        nsb::nsbm::Manifest manifest = nsbMsg.manifest();
         if (manifest.op() != nsb::nsbm::Manifest::RECEIVE && manifest.op() != nsb::nsbm::Manifest::FORWARD) {
             LOG(ERROR) << "RECV: Unexpected operation over RECV channel." << std::endl;
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
             return MessageEntry();
         } else if (manifest.code() == nsb::nsbm::Manifest::MESSAGE) {
             // Repack it in MessageEntry format with the full payload.
-            std::string payload = cfg.USE_DB ? db->checkOut(nsbMsg->msg_key())
-                                             : nsbMsg->payload();
+            std::string payload = cfg.USE_DB ? checkOutPayload(nsbMsg.msg_key())
+                                             : nsbMsg.payload();
             MessageEntry receivedPayload = MessageEntry(
-                nsbMsg->metadata().src_id(),
-                nsbMsg->metadata().dest_id(),
+                nsbMsg.metadata().src_id(),
+                nsbMsg.metadata().dest_id(),
                 payload,
-                nsbMsg->metadata().payload_size()
+                nsbMsg.metadata().payload_size()
             );
+            if (!verifyChecksum(nsbMsg.metadata(), &receivedPayload)) {
+                timer.setOutcome(ClientMetrics::Outcome::ERROR);
+                return MessageEntry();
+            }
             return receivedPayload;
         } else if (manifest.code() == nsb::nsbm::Manifest::NO_MESSAGE) {
             if (destId != nullptr) {
@@ -261,13 +874,58 @@ namespace nsb {
             } else {
                 DLOG(INFO) << "RECV: No messages found for any destination." << std::endl;
             }
+            timer.setOutcome(ClientMetrics::Outcome::EMPTY);
             return MessageEntry();
         } else {
             LOG(ERROR) << "RECV: Unexpected status code returned from receive." << std::endl;
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
             return MessageEntry();
         }
     }
 
+    std::vector<MessageEntry> NSBAppClient::receiveBatch(std::string* destId, int maxMessages, int timeout) {
+        MetricTimer timer(metrics, ClientMetric::RECEIVE_BATCH);
+        if (cfg.SYSTEM_MODE != Config::SystemMode::PULL) {
+            LOG(ERROR) << "RECV: Batches can only be received in PULL mode." << std::endl;
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
+            return std::vector<MessageEntry>();
+        }
+        nsb::nsbm response;
+        if (!exchangeBatch(receiveRequest(destId, maxMessages > 0 ? maxMessages : -1), timeout, &response)) {
+            LOG(ERROR) << "RECV: No response received from daemon." << std::endl;
+            timer.setOutcome(ClientMetrics::Outcome::TIMEOUT);
+            return std::vector<MessageEntry>();
+        }
+        if (response.manifest().op() != nsb::nsbm::Manifest::RECEIVE) {
+            LOG(ERROR) << "RECV: Unexpected operation over RECV channel." << std::endl;
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
+            return std::vector<MessageEntry>();
+        }
+        std::vector<MessageEntry> entries = unpackBatch(response, false);
+        if (entries.empty()) {
+            timer.setOutcome(ClientMetrics::Outcome::EMPTY);
+        }
+        return entries;
+    }
+
+    AdaptivePoller::AdaptivePoller(double minDelay, double maxDelay)
+        : minDelay(minDelay), maxDelay(maxDelay), delay(minDelay) {}
+
+    double AdaptivePoller::update(const MessageEntry& result, const nsb::nsbm::PollHints& hints) {
+        if (result.exists() || hints.queue_depth() > 0) {
+            // Keep draining while messages are available.
+            delay = minDelay;
+        } else if (hints.next_poll_us() > 0) {
+            // Follow the daemon's suggestion when the queue is empty.
+            delay = hints.next_poll_us() / 1e6;
+        } else {
+            // Without a hint (e.g., PUSH mode), back off exponentially.
+            delay = delay * 2;
+        }
+        delay = std::clamp(delay, minDelay, maxDelay);
+        return delay;
+    }
+
     NSBSimClient::NSBSimClient(const std::string& identifier, std::string& serverAddress, int serverPort) : 
         NSBClient(identifier, serverAddress, serverPort) {
         originIndicator = new nsb::nsbm::Manifest::Originator(nsb::nsbm::Manifest::SIM_CLIENT);
@@ -276,55 +934,142 @@ namespace nsb {
 
     NSBSimClient::~NSBSimClient() {}
 
+    void NSBSimClient::setRetainPayloads(bool retain) {
+        if (retain && prefetcher) {
+            LOG(WARNING) << "Payloads cannot be retained while they are prefetched." << std::endl;
+            return;
+        }
+        retainPayloads = retain;
+    }
+
     MessageEntry NSBSimClient::fetch(std::string* srcId, int timeout) {
-        nsb::nsbm* nsbMsg = new nsb::nsbm();
+        MetricTimer timer(metrics, ClientMetric::FETCH);
+        std::string request = "";
         if (cfg.SYSTEM_MODE == Config::SystemMode::PULL) {
-            // Create and populate a FETCH message.
-            nsb::nsbm::Manifest* mutableManifest = nsbMsg->mutable_manifest();
-            mutableManifest->set_op(nsb::nsbm::Manifest::FETCH);
-            mutableManifest->set_og(*originIndicator);
-            mutableManifest->set_code(nsb::nsbm::Manifest::SUCCESS);
-            if (cfg.SIMULATOR_MODE == Config::SimulatorMode::SYSTEM_WIDE) {
-                if (srcId != nullptr) {
-                    // If target source ID has been set, specify that. 
-                    nsbMsg->mutable_metadata()->set_src_id(*srcId);
-                } // Otherwise, we can leave it unspecified.
-            } else if (cfg.SIMULATOR_MODE == Config::SimulatorMode::PER_NODE) {
-                if (srcId != nullptr) {
-                    LOG(WARNING)
-                        << "Simulation mode is set to PER_NODE, so specified target source will be overwritten."
-                        << std::endl;
-                }
-                nsbMsg->mutable_metadata()->set_src_id(clientId);
+            request = fetchRequest(srcId);
+        }
+        // Send any request, then wait for response or incoming message.
+        std::string response = exchange(nsb::Comms::Channel::RECV, request, &timeout);
+        if (response.empty()) {
+            // In PUSH mode, nothing arriving within the timeout is expected.
+            if (cfg.SYSTEM_MODE == Config::SystemMode::PULL) {
+                LOG(ERROR) << "FETCH: No response received from daemon." << std::endl;
             }
-            // Send the message.
-            DLOG(INFO) << "FETCH: Sending request:" << std::endl << nsbMsg->DebugString();
-            comms.sendMessage(nsb::Comms::Channel::RECV, nsbMsg->SerializeAsString());
+            timer.setOutcome(ClientMetrics::Outcome::TIMEOUT);
+            return MessageEntry();
+        }
+        return parseFetchResponse(response, srcId, &timer);
+    }
+
+    int NSBSimClient::requestFetch(std::string* srcId) {
+        if (cfg.SYSTEM_MODE != Config::SystemMode::PULL) {
+            return 0;
         }
-        // Wait for response or incoming message.
+        if (!ensureConnected()) {
+            return -1;
+        }
+        return writeMessage(nsb::Comms::Channel::RECV, fetchRequest(srcId));
+    }
+
+    MessageEntry NSBSimClient::collectFetch(int timeout) {
+        MetricTimer timer(metrics, ClientMetric::FETCH);
         std::string response = comms.receiveMessage(nsb::Comms::Channel::RECV, &timeout);
         if (response.empty()) {
-            LOG(ERROR) << "FETCH: No response received from daemon." << std::endl;
+            timer.setOutcome(ClientMetrics::Outcome::TIMEOUT);
             return MessageEntry();
         }
+        return parseFetchResponse(response, nullptr, &timer);
+    }
+
+    std::vector<MessageEntry> NSBSimClient::fetchBatch(std::string* srcId, int maxMessages, int timeout) {
+        MetricTimer timer(metrics, ClientMetric::FETCH_BATCH);
+        if (cfg.SYSTEM_MODE != Config::SystemMode::PULL) {
+            LOG(ERROR) << "FETCH: Batches can only be fetched in PULL mode." << std::endl;
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
+            return std::vector<MessageEntry>();
+        }
+        nsb::nsbm response;
+        if (!exchangeBatch(fetchRequest(srcId, maxMessages > 0 ? maxMessages : -1), timeout, &response)) {
+            LOG(ERROR) << "FETCH: No response received from daemon." << std::endl;
+            timer.setOutcome(ClientMetrics::Outcome::TIMEOUT);
+            return std::vector<MessageEntry>();
+        }
+        if (response.manifest().op() != nsb::nsbm::Manifest::FETCH) {
+            LOG(ERROR) << "FETCH: Unexpected operation over RECV channel." << std::endl;
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
+            return std::vector<MessageEntry>();
+        }
+        std::vector<MessageEntry> entries = unpackBatch(response, retainPayloads);
+        if (entries.empty()) {
+            timer.setOutcome(ClientMetrics::Outcome::EMPTY);
+        }
+        return entries;
+    }
+
+    std::string NSBSimClient::fetchRequest(std::string* srcId, int maxBatch) {
+        // Create and populate a FETCH message.
+        nsb::nsbm nsbMsg;
+        nsb::nsbm::Manifest* mutableManifest = nsbMsg.mutable_manifest();
+        mutableManifest->set_op(nsb::nsbm::Manifest::FETCH);
+        mutableManifest->set_og(*originIndicator);
+        mutableManifest->set_code(nsb::nsbm::Manifest::SUCCESS);
+        if (cfg.SIMULATOR_MODE == Config::SimulatorMode::SYSTEM_WIDE) {
+            if (srcId != nullptr) {
+                // If target source ID has been set, specify that. 
+                nsbMsg.mutable_metadata()->set_src_id(*srcId);
+            } // Otherwise, we can leave it unspecified.
+        } else if (cfg.SIMULATOR_MODE == Config::SimulatorMode::PER_NODE) {
+            if (srcId != nullptr) {
+                LOG(WARNING)
+                    << "Simulation mode is set to PER_NODE, so specified target source will be overwritten."
+                    << std::endl;
+            }
+            nsbMsg.mutable_metadata()->set_src_id(clientId);
+        }
+        if (maxBatch != 0) {
+            nsbMsg.set_max_batch(maxBatch);
+            nsbMsg.set_arm_doorbell(doorbellEnabled);
+        }
+        DLOG(INFO) << "FETCH: Sending request:" << std::endl << nsbMsg.DebugString();
+        return serialize(nsbMsg);
+    }
+
+    MessageEntry NSBSimClient::parseFetchResponse(const std::string& response, std::string* srcId,
+                                                  MetricTimer* timer) {
         // Parse in message.
-        nsbMsg->ParseFromString(response);
-        DLOG(INFO) << "FETCH: Response:" << std::endl << nsbMsg->DebugString();
-        nsb::nsbm::Manifest manifest = nsbMsg->manifest();
+        nsb::nsbm nsbMsg;
+        parse(response, &nsbMsg);
+        lastHints = nsbMsg.hints();
+        DLOG(INFO) << "FETCH: Response:" << std::endl << nsbMsg.DebugString();
+        const nsb::nsbm::Manifest& manifest = nsbMsg.manifest();
         if (manifest.op() != nsb::nsbm::Manifest::FETCH && manifest.op() != nsb::nsbm::Manifest::FORWARD) {
             LOG(ERROR) << "FETCH: Unexpected operation over RECV channel." << std::endl;
-            delete nsbMsg;
+            timer->setOutcome(ClientMetrics::Outcome::ERROR);
             return MessageEntry();
         } else if (manifest.code() == nsb::nsbm::Manifest::MESSAGE) {
             // Repack it in MessageEntry format with the full payload.
-            std::string payload = cfg.USE_DB ? db->checkOut(nsbMsg->msg_key())
-                                             : nsbMsg->payload();
-            MessageEntry fetchedMessage = MessageEntry(
-                nsbMsg->metadata().src_id(),
-                nsbMsg->metadata().dest_id(),
+            std::string payload;
+            if (!cfg.USE_DB) {
+                payload = nsbMsg.payload();
+            } else if (retainPayloads) {
+                MetricTimer peekTimer(metrics, ClientMetric::DB_CHECKOUT);
+                payload = db->peek(nsbMsg.msg_key());
+            } else {
+                payload = checkOutPayload(nsbMsg.msg_key());
+            }
+            MessageEntry fetchedMessage(
+                nsbMsg.metadata().src_id(),
+                nsbMsg.metadata().dest_id(),
                 payload,
-                nsbMsg->metadata().payload_size()
+                nsbMsg.metadata().payload_size()
             );
+            if (!verifyChecksum(nsbMsg.metadata(), &fetchedMessage)) {
+                timer->setOutcome(ClientMetrics::Outcome::ERROR);
+                return MessageEntry();
+            }
+            if (cfg.USE_DB && retainPayloads) {
+                fetchedMessage.payload_key = nsbMsg.msg_key();
+            }
             return fetchedMessage;
         } else if (manifest.code() == nsb::nsbm::Manifest::NO_MESSAGE) {
             if (srcId != nullptr) {
@@ -332,14 +1077,16 @@ namespace nsb {
             } else {
                 DLOG(INFO) << "FETCH: No messages found for any source." << std::endl;
             }
+            timer->setOutcome(ClientMetrics::Outcome::EMPTY);
             return MessageEntry();
         } else {
             LOG(ERROR) << "FETCH: Unexpected status code returned from receive." << std::endl;
+            timer->setOutcome(ClientMetrics::Outcome::ERROR);
             return MessageEntry();
         }
     }
 
-    std::string NSBSimClient::post(std::string srcId, std::string destId, std::string &payload) {
+    std::string NSBSimClient::post(std::string srcId, std::string destId, const std::string &payload) {
         // // Create and populate a POST message.
         // nsb::nsbm nsbMsg = nsb::nsbm();
         // nsb::nsbm::Manifest* mutableManifest = nsbMsg.mutable_manifest();
@@ -363,6 +1110,7 @@ namespace nsb {
         // DLOG(INFO) << "POST: Posting message:" << std::endl << nsbMsg.DebugString();
         // comms.sendMessage(nsb::Comms::Channel::SEND, nsbMsg.SerializeAsString());
 
+        MetricTimer timer(metrics, ClientMetric::POST);
         // Create and populate a SEND message.
         nsb::nsbm nsbMsg = nsb::nsbm();
         nsb::nsbm::Manifest* mutableManifest = nsbMsg.mutable_manifest();
@@ -373,10 +1121,12 @@ namespace nsb {
         mutableMetadata->set_src_id(srcId);
         mutableMetadata->set_dest_id(destId);
         mutableMetadata->set_payload_size(static_cast<int>(payload.size()));
+        setChecksum(payload, mutableMetadata);
         // Set return to "" by default.
         std::string key = "";
         if (cfg.USE_DB) {
             // Store the payload in the database and get the key.
+            MetricTimer storeTimer(metrics, ClientMetric::DB_STORE);
             key = db->store(payload);
             nsbMsg.set_msg_key(key);
         } else {
@@ -384,8 +1134,61 @@ namespace nsb {
         }
         // Post the message.
         DLOG(INFO) << "POST: Posting message:" << std::endl << nsbMsg.DebugString();
-        comms.sendMessage(nsb::Comms::Channel::SEND, nsbMsg.SerializeAsString());
+        if (sendDataMessage(serialize(nsbMsg)) != 0) {
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
+        }
         // Return key in case it's useful.
         return key;
     }
+
+    int NSBSimClient::postBatch(const std::vector<PostEntry>& entries) {
+        MetricTimer timer(metrics, ClientMetric::POST_BATCH);
+        // Create and populate a POST message carrying a batch.
+        nsb::nsbm nsbMsg;
+        nsb::nsbm::Manifest* mutableManifest = nsbMsg.mutable_manifest();
+        mutableManifest->set_op(nsb::nsbm::Manifest::POST);
+        mutableManifest->set_og(*originIndicator);
+        mutableManifest->set_code(nsb::nsbm::Manifest::MESSAGE);
+        nsb::nsbm::Batch* batch = nsbMsg.mutable_batch();
+        // Store the payloads that need storing together.
+        std::vector<std::string> storedKeys;
+        if (cfg.USE_DB) {
+            std::vector<std::string> toStore;
+            for (const PostEntry& entry : entries) {
+                if (entry.key.empty() && entry.verdict == PostEntry::Verdict::DELIVERED) {
+                    toStore.push_back(entry.payload);
+                }
+            }
+            MetricTimer storeTimer(metrics, ClientMetric::DB_STORE);
+            storedKeys = db->storeMany(toStore);
+        }
+        std::size_t stored = 0;
+        for (const PostEntry& entry : entries) {
+            nsb::nsbm::Batch::Entry* out = batch->add_entries();
+            nsb::nsbm::Metadata* mutableMetadata = out->mutable_metadata();
+            mutableMetadata->set_src_id(entry.source);
+            mutableMetadata->set_dest_id(entry.destination);
+            mutableMetadata->set_payload_size(static_cast<int>(entry.payload.size()));
+            if (entry.verdict == PostEntry::Verdict::DELIVERED) {
+                setChecksum(entry.payload, mutableMetadata, entry.checksum);
+            }
+            out->set_verdict(static_cast<nsb::nsbm::Batch::Entry::Verdict>(entry.verdict));
+            if (!entry.key.empty()) {
+                // Pass on or reclaim the stored payload.
+                out->set_msg_key(entry.key);
+            } else if (entry.verdict == PostEntry::Verdict::DELIVERED) {
+                if (cfg.USE_DB) {
+                    out->set_msg_key(storedKeys[stored++]);
+                } else {
+                    out->set_payload(entry.payload);
+                }
+            }
+        }
+        DLOG(INFO) << "POST: Posting batch of " << entries.size() << " message(s)." << std::endl;
+        if (sendDataMessage(serialize(nsbMsg)) != 0) {
+            timer.setOutcome(ClientMetrics::Outcome::ERROR);
+            return -1;
+        }
+        return 0;
+    }
 }
\ No newline at end of file
@@ -4,7 +4,21 @@
 
 namespace nsb {
 
-    NSBDaemon::NSBDaemon(int s_port, std::string filename) : running(false), server_port(s_port) {
+    namespace {
+        /** @brief Set by SIGUSR2 to start a profile from the server loop. */
+        volatile sig_atomic_t profile_requested = 0;
+
+        void request_profile(int) {
+            profile_requested = 1;
+        }
+    }
+
+    NSBDaemon::NSBDaemon(int s_port, std::string filename) : running(false), server_port(s_port),
+        sim_client_lookup(rcu, std::make_unique<Registry<ClientDetails>>()),
+        app_client_lookup(rcu, std::make_unique<Registry<ClientDetails>>()),
+        tx_buffer(std::make_unique<MemoryQueue>(&MessageEntry::source)),
+        rx_buffer(std::make_unique<MemoryQueue>(&MessageEntry::destination)),
+        profiler(std::make_unique<SamplingProfiler>()) {
         GOOGLE_PROTOBUF_VERIFY_VERSION;
         configure(filename);
     }
@@ -43,6 +57,122 @@ namespace nsb {
         if (cfg.USE_DB) {
             cfg.DB_ADDRESS = config["database"]["db_address"].as<std::string>();
             cfg.DB_PORT = config["database"]["db_port"].as<int>();
+            // Parse any further Redis instances to spread payloads across.
+            if (config["database"]["shards"] && config["database"]["shards"].size() > 0) {
+                cfg.DB_SHARDS.push_back({cfg.DB_ADDRESS, cfg.DB_PORT});
+                for (const YAML::Node& shard : config["database"]["shards"]) {
+                    cfg.DB_SHARDS.push_back({shard["address"].as<std::string>(), shard["port"].as<int>()});
+                }
+                LOG(INFO) << "Spreading payloads across " << cfg.DB_SHARDS.size() << " Redis shards." << std::endl;
+            }
+            // Host the (first) payload store in-process if asked to.
+            if (config["database"]["embedded"].as<bool>(false)) {
+                embedded_db = std::make_unique<RespServer>();
+                if (embedded_db->start(cfg.DB_ADDRESS, cfg.DB_PORT) < 0) {
+                    LOG(ERROR) << "Failed to start the embedded payload store." << std::endl;
+                }
+            }
+            // Connect to reclaim payloads of messages that are never delivered.
+            db = std::make_unique<RedisConnector>("daemon", cfg.dbShards());
+        }
+        // Parse the optional datagram section.
+        if (config["datagram"]) {
+            cfg.USE_DGRAM = config["datagram"]["enabled"].as<bool>(false);
+            if (cfg.USE_DGRAM) {
+                cfg.DGRAM_PORT = config["datagram"]["port"].as<int>();
+                cfg.DGRAM_MAX_SIZE = std::min(config["datagram"]["max_size"].as<int>(1400), MAX_DATAGRAM_SIZE);
+            }
+        }
+        // Parse the optional integrity section.
+        if (config["integrity"]) {
+            cfg.USE_CHECKSUM = config["integrity"]["checksum"].as<bool>(false);
+            if (cfg.USE_CHECKSUM) {
+                LOG(INFO) << "Payload checksums enabled (CRC32C: " << crc32cImplementation() << ")." << std::endl;
+            }
+        }
+        // Parse the optional session section.
+        if (config["session"]) {
+            session_timeout = std::chrono::seconds(config["session"]["resume_timeout"].as<int>(30));
+        }
+        // Parse the optional rate limiting section.
+        if (config["rate_limit"]) {
+            YAML::Node rl = config["rate_limit"];
+            RateLimitConfig rl_cfg;
+            rl_cfg.ENABLED = rl["enabled"].as<bool>(false);
+            rl_cfg.OVERFLOW_ACTION = static_cast<RateLimitConfig::OverflowAction>(rl["overflow_action"].as<int>(0));
+            rl_cfg.BURST_SECONDS = rl["burst_seconds"].as<double>(1.0);
+            if (rl["client"]) {
+                rl_cfg.CLIENT_MESSAGES_PER_SEC = rl["client"]["messages_per_sec"].as<double>(0);
+                rl_cfg.CLIENT_BYTES_PER_SEC = rl["client"]["bytes_per_sec"].as<double>(0);
+            }
+            if (rl["namespaces"]) {
+                for (const YAML::Node& ns : rl["namespaces"]) {
+                    rl_cfg.NAMESPACES.push_back({
+                        ns["prefix"].as<std::string>(),
+                        ns["messages_per_sec"].as<double>(0),
+                        ns["bytes_per_sec"].as<double>(0)
+                    });
+                }
+            }
+            rate_limiter = RateLimiter(rl_cfg);
+            if (rl_cfg.ENABLED) {
+                LOG(INFO) << "Rate limiting enabled: " << rl_cfg.CLIENT_MESSAGES_PER_SEC << " msg/s | "
+                          << rl_cfg.CLIENT_BYTES_PER_SEC << " B/s per client | "
+                          << rl_cfg.NAMESPACES.size() << " namespace(s)" << std::endl;
+            }
+        }
+        // Parse the optional governor section.
+        if (config["governor"]) {
+            YAML::Node g = config["governor"];
+            GovernorConfig g_cfg;
+            g_cfg.ENABLED = g["enabled"].as<bool>(g_cfg.ENABLED);
+            g_cfg.TARGET_MS = g["target_ms"].as<double>(g_cfg.TARGET_MS);
+            g_cfg.INTERVAL_MS = g["interval_ms"].as<double>(g_cfg.INTERVAL_MS);
+            g_cfg.MAX_DELAY_MS = g["max_delay_ms"].as<double>(g_cfg.MAX_DELAY_MS);
+            if (g_cfg.ENABLED && cfg.SYSTEM_MODE != Config::SystemMode::PULL) {
+                LOG(WARNING) << "The admission governor only applies in PULL mode; disabling it." << std::endl;
+                g_cfg.ENABLED = false;
+            }
+            governor = AdmissionGovernor(g_cfg);
+            if (g_cfg.ENABLED) {
+                LOG(INFO) << "Admission governor enabled: " << g_cfg.TARGET_MS << " ms target | "
+                          << g_cfg.INTERVAL_MS << " ms interval" << std::endl;
+            }
+        }
+        // Parse the optional queue section.
+        if (config["queue"]) {
+            YAML::Node q = config["queue"];
+            QueueConfig q_cfg;
+            q_cfg.BACKEND = static_cast<QueueConfig::Backend>(q["backend"].as<int>(0));
+            q_cfg.REDIS_ADDRESS = q["redis_address"].as<std::string>(q_cfg.REDIS_ADDRESS);
+            q_cfg.REDIS_PORT = q["redis_port"].as<int>(q_cfg.REDIS_PORT);
+            q_cfg.NAMESPACE = q["namespace"].as<std::string>(q_cfg.NAMESPACE);
+            q_cfg.CONSUMER = q["consumer"].as<std::string>(q_cfg.CONSUMER);
+            tx_buffer = QueueBackend::create(q_cfg, "tx", &MessageEntry::source);
+            rx_buffer = QueueBackend::create(q_cfg, "rx", &MessageEntry::destination);
+        }
+        // Parse the optional profiler section.
+        if (config["profiler"]) {
+            YAML::Node p = config["profiler"];
+            ProfilerConfig p_cfg;
+            p_cfg.SIGNAL = p["signal"].as<bool>(p_cfg.SIGNAL);
+            p_cfg.REMOTE = p["remote"].as<bool>(p_cfg.REMOTE);
+            p_cfg.DURATION_MS = p["duration_ms"].as<int>(p_cfg.DURATION_MS);
+            p_cfg.FREQUENCY_HZ = p["frequency_hz"].as<int>(p_cfg.FREQUENCY_HZ);
+            p_cfg.DIRECTORY = p["directory"].as<std::string>(p_cfg.DIRECTORY);
+            profiler = std::make_unique<SamplingProfiler>(p_cfg);
+        }
+        // Parse the optional heavy-hitter section.
+        if (config["heavy_hitters"]) {
+            YAML::Node hh = config["heavy_hitters"];
+            HeavyHitterConfig hh_cfg;
+            hh_cfg.ENABLED = hh["enabled"].as<bool>(hh_cfg.ENABLED);
+            hh_cfg.TOP_K = hh["top_k"].as<int>(hh_cfg.TOP_K);
+            hh_cfg.WIDTH = hh["width"].as<int>(hh_cfg.WIDTH);
+            hh_cfg.DEPTH = hh["depth"].as<int>(hh_cfg.DEPTH);
+            hh_cfg.HALF_LIFE_SECONDS = hh["half_life_s"].as<double>(hh_cfg.HALF_LIFE_SECONDS);
+            hot_sources = HeavyHitters(hh_cfg);
+            hot_destinations = HeavyHitters(hh_cfg);
         }
     }
 
@@ -91,25 +221,57 @@ namespace nsb {
             return;
         }
         LOG(INFO) << "Server started on port " << port << std::endl;
+        // Open the datagram server if configured.
+        if (cfg.USE_DGRAM) {
+            dgram_fd = open_datagram_server();
+            if (dgram_fd == -1) {
+                LOG(WARNING) << "Datagram channel disabled." << std::endl;
+                cfg.USE_DGRAM = false;
+            }
+        }
+        // Let SIGUSR2 start a profile, interrupting select() to do so.
+        if (profiler->getConfig().SIGNAL) {
+            struct sigaction action{};
+            action.sa_handler = request_profile;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGUSR2, &action, nullptr);
+        }
+        if (!to_control.open() || !to_data.open()) {
+            LOG(ERROR) << "Could not open the pipes between the control and data planes." << std::endl;
+            to_control.close();
+            to_data.close();
+            close(server_fd);
+            return;
+        }
+        // Serve the data plane on its own thread, leaving SIGUSR2 to this one.
+        sigset_t blocked;
+        sigset_t previous;
+        sigemptyset(&blocked);
+        sigaddset(&blocked, SIGUSR2);
+        pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+        data_plane = std::thread(&NSBDaemon::run_data_plane, this);
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
 
-        // Run server.
+        // Run the control plane.
         fd_set read_fds;
-        // Create vector to track client file descriptors.
-        std::vector<int> channel_fds;
         while (running) {
-            // Set server file descriptor.
+            // Set server and wake file descriptors.
             FD_ZERO(&read_fds);
             FD_SET(server_fd, &read_fds);
-            int max_fd = server_fd;
+            FD_SET(to_control.wake_fds[0], &read_fds);
+            int max_fd = std::max(server_fd, to_control.wake_fds[0]);
             // Set client file descriptors.
-            for (int channel_fd : channel_fds) {
+            for (int channel_fd : control_fds) {
                 FD_SET(channel_fd, &read_fds);
                 max_fd = std::max(max_fd, channel_fd);
             }
-            // Monitor select for activity on the file descriptors.
+            // Wake up soon if closed channels are waiting on the data plane to be closed.
             timeval timeout{};
-            timeout.tv_sec = 10;
-            timeout.tv_usec = 0;
+            if (rcu.reclaim() > 0) {
+                timeout.tv_usec = 10000;
+            } else {
+                timeout.tv_sec = 10;
+            }
             int activity = select(max_fd + 1, &read_fds, nullptr, nullptr, &timeout);
             if (activity < 0) {
                 // Check for errors, but excuse ones that come from non-blocking.
@@ -118,14 +280,159 @@ namespace nsb {
                     break;
                 }
             } else if (activity > 0) {
-                // First, monitor existing connections through client FDs.
-                for (auto it=channel_fds.begin(); it!=channel_fds.end();) {
+                // First, take what the data plane has handed back.
+                if (FD_ISSET(to_control.wake_fds[0], &read_fds)) {
+                    handle_handoffs(Plane::CONTROL);
+                }
+                // Then monitor existing connections through client FDs, which
+                // handling a message may hand over to the data plane.
+                std::vector<int> ready_fds;
+                for (int fd : control_fds) {
+                    if (FD_ISSET(fd, &read_fds)) {
+                        ready_fds.push_back(fd);
+                    }
+                }
+                for (int fd : ready_fds) {
+                    if (std::find(control_fds.begin(), control_fds.end(), fd) == control_fds.end()) {
+                        continue;
+                    }
+                    bool message_exists = false;
+                    char buffer[MAX_BUFFER_SIZE];
+                    ConnectionBuffer message;
+                    // Read buffer until there's nothing left.
+                    int bytes_read = recv(fd, buffer, sizeof(buffer)-1, 0);
+                    while(bytes_read > 0) {
+                        message_exists = true;
+                        DLOG(INFO) << "Picked up " << bytes_read << "B from FD " << fd << "." << std::endl;
+                        message.insert(message.end(), buffer, buffer+bytes_read);
+                        bytes_read = recv(fd, buffer, sizeof(buffer)-1, 0);
+                    }
+                    if (message_exists) {
+                        DLOG(INFO) << "Received message from FD " << fd << ": " << 
+                            std::string(message.begin()+1, message.end()) << std::endl;
+                        handle_message(fd, message.data(), message.size(), Plane::CONTROL);
+                    }
+                    else {
+                        LOG(WARNING) << "Disconnected from FD " << fd << "." << std::endl;
+                        shutdown(fd, SHUT_WR);
+                        control_fds.erase(std::find(control_fds.begin(), control_fds.end(), fd));
+                        detach_fd(fd);
+                    }
+                }
+                // Then handle all new connections.
+                if (FD_ISSET(server_fd, &read_fds)) {
+                    while (true) {
+                        sockaddr_in client_addr{};
+                        socklen_t client_len = sizeof(client_addr);
+                        int channel_fd = accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
+                        if (channel_fd == -1) {
+                            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                                LOG(ERROR) << "Accept failed." << std::endl;
+                            }
+                            break;
+                        }
+                        char client_ip[INET_ADDRSTRLEN];
+                        inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
+                        int client_port = ntohs(client_addr.sin_port);
+                        LOG(INFO) << "Channel connected from IP: " << client_ip 
+                                << ", Port: " << client_port << "." << std::endl;
+                        // Add to the FD lookup.
+                        std::string key = std::string(client_ip) + ":" + std::to_string(client_port);
+                        fd_lookup.emplace(key, channel_fd);
+                        // Serve the channel here until it is known to be a data channel.
+                        control_fds.push_back(channel_fd);
+                    }
+                }
+            }
+            // Forget clients that have not resumed their sessions in time.
+            expire_sessions();
+            // Start a profile if signalled to.
+            if (profile_requested) {
+                profile_requested = 0;
+                profiler->start();
+            }
+        }
+        LOG(INFO) << "Server is no longer running, closing connections..." << std::endl;
+        // Stop the data plane, which closes its own connections.
+        running = false;
+        to_data.wake();
+        data_plane.join();
+        // When running stops, close connections and close server.
+        for (int channel_fd : control_fds) {
+            DLOG(INFO) << "Closing connection to FD " << channel_fd << "." << std::endl;
+            close(channel_fd);
+        }
+        control_fds.clear();
+        to_control.close();
+        to_data.close();
+        close(server_fd);
+        LOG(INFO) << "Server stopped." << std::endl;
+    }
+
+    void NSBDaemon::run_data_plane() {
+        int reader = rcu.registerReader();
+        fd_set read_fds;
+        while (running) {
+            // Set wake file descriptor.
+            FD_ZERO(&read_fds);
+            FD_SET(to_data.wake_fds[0], &read_fds);
+            int max_fd = to_data.wake_fds[0];
+            // Wake up no later than when the next paused FD may be read again.
+            auto now = std::chrono::steady_clock::now();
+            auto wait = std::chrono::steady_clock::duration(std::chrono::seconds(10));
+            for (auto it = paused_fds.begin(); it != paused_fds.end();) {
+                if (it->second <= now) {
+                    it = paused_fds.erase(it);
+                } else {
+                    wait = std::min(wait, it->second - now);
+                    ++it;
+                }
+            }
+            // Set client file descriptors, skipping paused ones.
+            for (int channel_fd : data_fds) {
+                if (paused_fds.count(channel_fd)) {
+                    continue;
+                }
+                FD_SET(channel_fd, &read_fds);
+                max_fd = std::max(max_fd, channel_fd);
+            }
+            if (dgram_fd != -1) {
+                FD_SET(dgram_fd, &read_fds);
+                max_fd = std::max(max_fd, dgram_fd);
+            }
+            // Monitor select for activity on the file descriptors, holding no client lookups meanwhile.
+            auto wait_us = std::chrono::duration_cast<std::chrono::microseconds>(wait).count();
+            timeval timeout{};
+            timeout.tv_sec = wait_us / 1000000;
+            timeout.tv_usec = wait_us % 1000000;
+            rcu.offline(reader);
+            int activity = select(max_fd + 1, &read_fds, nullptr, nullptr, &timeout);
+            rcu.online(reader);
+            if (activity < 0) {
+                // Check for errors, but excuse ones that come from non-blocking.
+                if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    perror("Select error.");
+                    break;
+                }
+            } else if (activity > 0) {
+                // First, adopt any channels handed over by the control plane.
+                if (FD_ISSET(to_data.wake_fds[0], &read_fds)) {
+                    handle_handoffs(Plane::DATA);
+                }
+                // Then monitor existing connections through client FDs.
+                for (auto it=data_fds.begin(); it!=data_fds.end();) {
                     int fd = *it;
                     // Check to see if there's action on this client FD.
                     if (FD_ISSET(fd, &read_fds)) {
                         bool message_exists = false;
+                        bool intact = true;
+                        bool relay_link;
+                        {
+                            std::lock_guard<std::mutex> lock(relay_mutex);
+                            relay_link = relay_links.count(fd) > 0;
+                        }
                         char buffer[MAX_BUFFER_SIZE];
-                        std::vector<char> message;
+                        ConnectionBuffer message;
                         // Read buffer until there's nothing left.
                         int bytes_read = recv(fd, buffer, sizeof(buffer)-1, 0);
                         while(bytes_read > 0) {
@@ -134,56 +441,659 @@ namespace nsb {
                             message.insert(message.end(), buffer, buffer+bytes_read);
                             bytes_read = recv(fd, buffer, sizeof(buffer)-1, 0);
                         }
-                        if (message_exists) {
+                        if (message_exists && relay_link) {
+                            intact = handle_relay(fd, message.data(), message.size());
+                        } else if (message_exists) {
                             DLOG(INFO) << "Received message from FD " << fd << ": " << 
                                 std::string(message.begin()+1, message.end()) << std::endl;
-                            handle_message(fd, message);
+                            handle_message(fd, message.data(), message.size(), Plane::DATA);
+                        }
+                        if (message_exists && intact) {
                             ++it;
                         }
                         else {
-                            LOG(WARNING) << "Disconnected from FD " << fd << "." << std::endl;
+                            // Hand the channel back to the control plane to detach and close.
+                            LOG(WARNING) << (intact ? "Disconnected from FD " : "Dropping broken relay link on FD ")
+                                         << fd << "." << std::endl;
                             shutdown(fd, SHUT_WR);
-                            close(fd);
-                            channel_fds.erase(it);
+                            it = data_fds.erase(it);
+                            paused_fds.erase(fd);
+                            if (relay_link) {
+                                close_relay(fd);
+                            } else {
+                                to_control.post(Handoff(Handoff::Kind::CLOSED_FD, fd));
+                            }
                         }
                     }
                     else {++it;}
                 }
-                // Then handle any new connections.
-                if (FD_ISSET(server_fd, &read_fds)) {
-                    sockaddr_in client_addr{};
-                    socklen_t client_len = sizeof(client_addr);
-                    int channel_fd = accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
-                    if (channel_fd == -1) {
-                        LOG(ERROR) << "Accept failed." << std::endl;
-                        continue;
-                    }
-                    char client_ip[INET_ADDRSTRLEN];
-                    inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
-                    int client_port = ntohs(client_addr.sin_port);
-                    LOG(INFO) << "Channel connected from IP: " << client_ip 
-                            << ", Port: " << client_port << "." << std::endl;
-                    // Add to the FD lookup.
-                    std::string key = std::string(client_ip) + ":" + std::to_string(client_port);
-                    fd_lookup.emplace(key, channel_fd);
-                    // Add client FD to the pool of client FDs.
-                    channel_fds.push_back(channel_fd);
+                // Handle any datagrams.
+                if (dgram_fd != -1 && FD_ISSET(dgram_fd, &read_fds)) {
+                    receive_datagrams();
                 }
             }
+            // Announce messages queued for clients waiting on their doorbells.
+            ring_doorbells();
+            // Send any datagrams queued while handling messages.
+            flush_datagrams();
+            // Send the frames queued for relay links, one envelope per link.
+            flush_relays();
         }
-        LOG(INFO) << "Server is no longer running, closing connections..." << std::endl;
-        // When running stops, close connections and close server.
-        for (int channel_fd : channel_fds) {
+        rcu.unregisterReader(reader);
+        // When running stops, close the data plane's connections.
+        for (int channel_fd : data_fds) {
             DLOG(INFO) << "Closing connection to FD " << channel_fd << "." << std::endl;
             close(channel_fd);
         }
-        close(server_fd);
-        LOG(INFO) << "Server stopped." << std::endl;
+        data_fds.clear();
+        if (dgram_fd != -1) {
+            close(dgram_fd);
+            dgram_fd = -1;
+        }
+    }
+
+    bool NSBDaemon::Mailbox::open() {
+        if (pipe(wake_fds) == -1) {
+            wake_fds[0] = wake_fds[1] = -1;
+            return false;
+        }
+        // Never block: a full pipe already holds a pending wake-up.
+        for (int fd : wake_fds) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        }
+        return true;
+    }
+
+    void NSBDaemon::Mailbox::close() {
+        for (int& fd : wake_fds) {
+            if (fd != -1) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    }
+
+    void NSBDaemon::Mailbox::post(Handoff item) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            items.push_back(std::move(item));
+        }
+        wake();
+    }
+
+    void NSBDaemon::Mailbox::wake() {
+        if (wake_fds[1] != -1) {
+            char signal = 1;
+            (void)!write(wake_fds[1], &signal, 1);
+        }
+    }
+
+    std::vector<NSBDaemon::Handoff> NSBDaemon::Mailbox::drain() {
+        char buffer[64];
+        while (read(wake_fds[0], buffer, sizeof(buffer)) > 0) {}
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::exchange(items, {});
+    }
+
+    void NSBDaemon::handle_handoffs(Plane plane) {
+        for (Handoff& item : (plane == Plane::CONTROL ? to_control : to_data).drain()) {
+            switch (item.kind) {
+                case Handoff::Kind::ADOPT_FD:
+                    DLOG(INFO) << "Data plane adopted FD " << item.fd << "." << std::endl;
+                    data_fds.push_back(item.fd);
+                    if (!item.data.empty()) {
+                        handle_message(item.fd, item.data.data(), item.data.size(), Plane::DATA);
+                    }
+                    break;
+                case Handoff::Kind::RESUMED:
+                    for (const Registry<ClientDetails>* lookup : {&app_client_lookup.read(), &sim_client_lookup.read()}) {
+                        auto target = lookup->find(item.key);
+                        if (target != lookup->end()) {
+                            flush_pending_forwards(item.key, target->second);
+                        }
+                    }
+                    break;
+                case Handoff::Kind::EXPIRED: {
+                    auto pending = pending_forwards.find(item.key);
+                    if (pending != pending_forwards.end()) {
+                        LOG(WARNING) << "\tDiscarding " << pending->second.size() 
+                                     << " message(s) held for " << item.key << "." << std::endl;
+                        pending_forwards.erase(pending);
+                    }
+                    break;
+                }
+                case Handoff::Kind::CLOSED_FD:
+                    detach_fd(item.fd);
+                    break;
+                case Handoff::Kind::MESSAGE:
+                    handle_message(item.fd, item.data.data(), item.data.size(), Plane::CONTROL);
+                    break;
+                case Handoff::Kind::RELAY_CHANNEL:
+                    fd_lookup.emplace(item.key, item.fd);
+                    break;
+            }
+        }
+    }
+
+    void NSBDaemon::hand_over_fd(int fd, ConnectionBuffer data) {
+        auto owned = std::find(control_fds.begin(), control_fds.end(), fd);
+        if (fd == -1 || owned == control_fds.end()) {
+            return;
+        }
+        control_fds.erase(owned);
+        to_data.post(Handoff(Handoff::Kind::ADOPT_FD, fd, "", std::move(data)));
     }
 
-    void NSBDaemon::handle_message(int fd, std::vector<char> message) {
+    NSBDaemon::Plane NSBDaemon::plane_of(nsb::nsbm::Manifest::Operation op) {
+        switch (op) {
+            case nsb::nsbm::Manifest::SEND:
+            case nsb::nsbm::Manifest::FETCH:
+            case nsb::nsbm::Manifest::POST:
+            case nsb::nsbm::Manifest::RECEIVE:
+                return Plane::DATA;
+            default:
+                return Plane::CONTROL;
+        }
+    }
+
+    int NSBDaemon::write_channel(int fd, const char* data, std::size_t size, int flags) {
+        if (is_relay_fd(fd)) {
+            nsb::nsbm::Relay::Frame frame;
+            frame.set_data(data, size);
+            return relay_frame(fd, std::move(frame)) ? 0 : -1;
+        }
+        return send(fd, data, size, flags) < 0 ? -1 : 0;
+    }
+
+    bool NSBDaemon::relay_frame(int fd, nsb::nsbm::Relay::Frame frame) {
+        {
+            std::lock_guard<std::mutex> lock(relay_mutex);
+            auto channel = relay_channels.find(fd);
+            if (channel == relay_channels.end()) {
+                return false;
+            }
+            frame.set_channel(channel->second.channel);
+            *relay_links.at(channel->second.link_fd).outgoing.add_frames() = std::move(frame);
+        }
+        // Have the data plane send it, if this is the control plane.
+        if (std::this_thread::get_id() != data_plane.get_id()) {
+            to_data.wake();
+        }
+        return true;
+    }
+
+    bool NSBDaemon::handle_relay(int link_fd, const char* data, std::size_t size) {
+        std::vector<std::pair<int, nsb::nsbm::Relay::Frame>> frames;
+        bool intact = true;
+        {
+            std::lock_guard<std::mutex> lock(relay_mutex);
+            RelayLink& link = relay_links.at(link_fd);
+            link.reader.append(data, size);
+            nsb::nsbm::Relay relay;
+            int status;
+            while ((status = link.reader.next(&relay)) > 0) {
+                for (nsb::nsbm::Relay::Frame& frame : *relay.mutable_frames()) {
+                    auto channel = link.channels.find(frame.channel());
+                    if (channel == link.channels.end()) {
+                        if (frame.closed()) {
+                            continue;
+                        }
+                        // Register a new channel, as accepting a connection would.
+                        int fd = next_relay_fd++;
+                        channel = link.channels.emplace(frame.channel(), fd).first;
+                        relay_channels[fd] = RelayChannel{link_fd, frame.channel()};
+                        DLOG(INFO) << "Relay link " << link.address << " opened channel " << frame.channel()
+                                   << " as FD " << fd << "." << std::endl;
+                        to_control.post(Handoff(Handoff::Kind::RELAY_CHANNEL, fd,
+                                                link.address + ":" + std::to_string(frame.channel())));
+                    }
+                    int fd = channel->second;
+                    if (frame.closed()) {
+                        relay_channels.erase(fd);
+                        link.channels.erase(channel);
+                    }
+                    frames.emplace_back(fd, std::move(frame));
+                }
+                relay.Clear();
+            }
+            intact = (status == 0);
+        }
+        // Handle the messages outside the lock, as responses are relayed too.
+        for (auto& [fd, frame] : frames) {
+            if (frame.closed()) {
+                to_control.post(Handoff(Handoff::Kind::CLOSED_FD, fd));
+            } else if (!frame.data().empty()) {
+                handle_message(fd, frame.data().data(), frame.data().size(), Plane::DATA);
+            }
+        }
+        return intact;
+    }
+
+    void NSBDaemon::close_relay(int link_fd) {
+        std::vector<int> closed_fds;
+        {
+            std::lock_guard<std::mutex> lock(relay_mutex);
+            auto link = relay_links.find(link_fd);
+            if (link == relay_links.end()) {
+                return;
+            }
+            LOG(WARNING) << "Relay link " << link->second.address << " closed, detaching "
+                         << link->second.channels.size() << " channel(s)." << std::endl;
+            for (const auto& [channel, fd] : link->second.channels) {
+                relay_channels.erase(fd);
+                closed_fds.push_back(fd);
+            }
+            relay_links.erase(link);
+        }
+        for (int fd : closed_fds) {
+            to_control.post(Handoff(Handoff::Kind::CLOSED_FD, fd));
+        }
+        to_control.post(Handoff(Handoff::Kind::CLOSED_FD, link_fd));
+    }
+
+    void NSBDaemon::flush_relays() {
+        std::vector<std::pair<int, std::string>> envelopes;
+        {
+            std::lock_guard<std::mutex> lock(relay_mutex);
+            for (auto& [link_fd, link] : relay_links) {
+                if (link.outgoing.frames_size() == 0) {
+                    continue;
+                }
+                std::string envelope;
+                packRelay(link.outgoing, link.compress, &envelope);
+                link.outgoing.Clear();
+                envelopes.emplace_back(link_fd, std::move(envelope));
+            }
+        }
+        for (const auto& [link_fd, envelope] : envelopes) {
+            if (sendAll(link_fd, envelope.data(), envelope.size(), RELAY_SEND_TIMEOUT_MS) != 0) {
+                LOG(WARNING) << "Dropping relay link on FD " << link_fd << ": " << strerror(errno) << std::endl;
+                shutdown(link_fd, SHUT_WR);
+                data_fds.erase(std::remove(data_fds.begin(), data_fds.end(), link_fd), data_fds.end());
+                close_relay(link_fd);
+            }
+        }
+    }
+
+    int NSBDaemon::open_datagram_server() {
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd == -1) {
+            LOG(ERROR) << "Datagram socket creation failed." << std::endl;
+            return -1;
+        }
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+            LOG(ERROR) << "Set datagram socket flags failed." << std::endl;
+            close(fd);
+            return -1;
+        }
+        sockaddr_in dgram_addr{};
+        dgram_addr.sin_family = AF_INET;
+        dgram_addr.sin_addr.s_addr = inet_addr("0.0.0.0");
+        dgram_addr.sin_port = htons(cfg.DGRAM_PORT);
+        if (bind(fd, (struct sockaddr*)&dgram_addr, sizeof(dgram_addr)) == -1) {
+            LOG(ERROR) << "Datagram bind failed on port " << cfg.DGRAM_PORT << "." << std::endl;
+            close(fd);
+            return -1;
+        }
+        // Allocate receive slots for a full batch.
+        dgram_buffer.assign(static_cast<std::size_t>(DGRAM_BATCH_SIZE) * cfg.DGRAM_MAX_SIZE, 0);
+        LOG(INFO) << "Datagram server started on port " << cfg.DGRAM_PORT 
+                  << " (max " << cfg.DGRAM_MAX_SIZE << " B)" << std::endl;
+        return fd;
+    }
+
+    void NSBDaemon::receive_datagrams() {
+        const std::size_t slot_size = cfg.DGRAM_MAX_SIZE;
+#ifdef __linux__
+        mmsghdr msgs[DGRAM_BATCH_SIZE];
+        iovec iovecs[DGRAM_BATCH_SIZE];
+        sockaddr_in senders[DGRAM_BATCH_SIZE];
+        while (true) {
+            std::memset(msgs, 0, sizeof(msgs));
+            for (int i = 0; i < DGRAM_BATCH_SIZE; i++) {
+                iovecs[i].iov_base = dgram_buffer.data() + i * slot_size;
+                iovecs[i].iov_len = slot_size;
+                msgs[i].msg_hdr.msg_iov = &iovecs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                msgs[i].msg_hdr.msg_name = &senders[i];
+                msgs[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+            }
+            int received = recvmmsg(dgram_fd, msgs, DGRAM_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+            if (received <= 0) {
+                break;
+            }
+            DLOG(INFO) << "Picked up " << received << " datagram(s)." << std::endl;
+            for (int i = 0; i < received; i++) {
+                if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                    LOG(WARNING) << "Discarding truncated datagram." << std::endl;
+                    continue;
+                }
+                handle_datagram(senders[i], dgram_buffer.data() + i * slot_size, msgs[i].msg_len);
+            }
+            // A partial batch means the socket has been drained.
+            if (received < DGRAM_BATCH_SIZE) {
+                break;
+            }
+        }
+#else
+        while (true) {
+            sockaddr_in sender{};
+            socklen_t sender_len = sizeof(sender);
+            ssize_t received = recvfrom(dgram_fd, dgram_buffer.data(), slot_size, MSG_DONTWAIT,
+                                        (struct sockaddr*)&sender, &sender_len);
+            if (received <= 0) {
+                break;
+            }
+            handle_datagram(sender, dgram_buffer.data(), received);
+        }
+#endif
+    }
+
+    void NSBDaemon::handle_datagram(const sockaddr_in& from, const char* data, std::size_t size) {
         nsb::nsbm nsb_message;
-        nsb_message.ParseFromArray(message.data(), message.size());
+        if (from.sin_family != AF_INET || !nsb_message.ParseFromArray(data, size)) {
+            DLOG(WARNING) << "Discarding malformed datagram." << std::endl;
+            return;
+        }
+        // Applications SEND and simulators POST; nothing else is taken over datagrams.
+        const RcuPointer<Registry<ClientDetails>>* lookup;
+        switch (nsb_message.manifest().op()) {
+            case nsb::nsbm::Manifest::SEND:
+                lookup = &app_client_lookup;
+                break;
+            case nsb::nsbm::Manifest::POST:
+                lookup = &sim_client_lookup;
+                break;
+            default:
+                LOG(WARNING) << "Discarding " << nsb::nsbm::Manifest::Operation_Name(nsb_message.manifest().op())
+                             << " datagram." << std::endl;
+                return;
+        }
+        // Only take datagrams from the datagram channel of a registered client.
+        char sender_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &from.sin_addr, sender_ip, INET_ADDRSTRLEN);
+        int sender_port = ntohs(from.sin_port);
+        int send_fd = -1;
+        for (const auto& [key, client] : lookup->read()) {
+            if (client.ch_DGRAM_port == sender_port && client.address == sender_ip) {
+                send_fd = client.ch_SEND_fd;
+                break;
+            }
+        }
+        if (send_fd == -1) {
+            LOG(WARNING) << "Discarding datagram from unregistered " << sender_ip << ":" << sender_port << "." << std::endl;
+            return;
+        }
+        // Datagrams cannot be left in a socket to slow their sender, so drop SENDs while it is paused.
+        auto paused = paused_fds.find(send_fd);
+        if (nsb_message.manifest().op() == nsb::nsbm::Manifest::SEND && paused != paused_fds.end() &&
+            paused->second > std::chrono::steady_clock::now()) {
+            DLOG(INFO) << "Dropping SEND datagram from " << sender_ip << ":" << sender_port
+                       << " while its SEND channel is paused." << std::endl;
+            if (cfg.USE_DB && db && !nsb_message.msg_key().empty()) {
+                int64_t reclaimed = db->reclaim({nsb_message.msg_key()});
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                delivery_counts.reclaimed += reclaimed;
+            }
+            return;
+        }
+        handle_message(send_fd, data, size, Plane::DATA);
+    }
+
+    bool NSBDaemon::queue_datagram(const ClientDetails& target, nsb::nsbm* message) {
+        if (dgram_fd == -1 || target.ch_DGRAM_port == 0) {
+            return false;
+        }
+        std::size_t size = message->ByteSizeLong();
+        if (size > static_cast<std::size_t>(cfg.DGRAM_MAX_SIZE)) {
+            return false;
+        }
+        OutgoingDatagram datagram{};
+        datagram.address.sin_family = AF_INET;
+        datagram.address.sin_addr.s_addr = inet_addr(target.address.c_str());
+        datagram.address.sin_port = htons(target.ch_DGRAM_port);
+        datagram.data.resize(size);
+        message->SerializeToArray(datagram.data.data(), size);
+        dgram_outbox.push_back(std::move(datagram));
+        return true;
+    }
+
+    void NSBDaemon::flush_datagrams() {
+        if (dgram_outbox.empty()) {
+            return;
+        }
+#ifdef __linux__
+        mmsghdr msgs[DGRAM_BATCH_SIZE];
+        iovec iovecs[DGRAM_BATCH_SIZE];
+        for (std::size_t start = 0; start < dgram_outbox.size(); start += DGRAM_BATCH_SIZE) {
+            int count = static_cast<int>(std::min<std::size_t>(DGRAM_BATCH_SIZE, dgram_outbox.size() - start));
+            std::memset(msgs, 0, sizeof(msgs));
+            for (int i = 0; i < count; i++) {
+                OutgoingDatagram& datagram = dgram_outbox[start + i];
+                iovecs[i].iov_base = datagram.data.data();
+                iovecs[i].iov_len = datagram.data.size();
+                msgs[i].msg_hdr.msg_name = &datagram.address;
+                msgs[i].msg_hdr.msg_namelen = sizeof(datagram.address);
+                msgs[i].msg_hdr.msg_iov = &iovecs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            int sent = sendmmsg(dgram_fd, msgs, count, 0);
+            if (sent < count) {
+                LOG(WARNING) << "Only " << std::max(sent, 0) << " of " << count << " datagrams sent." << std::endl;
+            }
+        }
+#else
+        for (OutgoingDatagram& datagram : dgram_outbox) {
+            sendto(dgram_fd, datagram.data.data(), datagram.data.size(), 0,
+                   (struct sockaddr*)&datagram.address, sizeof(datagram.address));
+        }
+#endif
+        DLOG(INFO) << "Flushed " << dgram_outbox.size() << " datagram(s)." << std::endl;
+        dgram_outbox.clear();
+    }
+
+    std::string NSBDaemon::generate_session_token() {
+        std::ostringstream token;
+        token << std::hex << std::setfill('0') << std::setw(16) << token_generator()
+              << std::setw(16) << token_generator();
+        return token.str();
+    }
+
+    void NSBDaemon::detach_fd(int fd) {
+        for (auto it = fd_lookup.begin(); it != fd_lookup.end();) {
+            it = (it->second == fd) ? fd_lookup.erase(it) : std::next(it);
+        }
+        // Mark the client that owned the channel as detached, keeping its session.
+        auto now = std::chrono::steady_clock::now();
+        for (RcuPointer<Registry<ClientDetails>>* lookup : {&app_client_lookup, &sim_client_lookup}) {
+            auto owns = [fd](const std::pair<const std::string, ClientDetails>& entry) {
+                const ClientDetails& client = entry.second;
+                return client.ch_CTRL_fd == fd || client.ch_SEND_fd == fd || client.ch_RECV_fd == fd;
+            };
+            // Only copy the lookup if a client in it owned the channel.
+            if (std::none_of(lookup->read().begin(), lookup->read().end(), owns)) {
+                continue;
+            }
+            lookup->update([&](Registry<ClientDetails>& clients) {
+                for (auto& [key, client] : clients) {
+                    bool owned = false;
+                    for (int* ch_fd : {&client.ch_CTRL_fd, &client.ch_SEND_fd, &client.ch_RECV_fd}) {
+                        if (*ch_fd == fd) {
+                            *ch_fd = -1;
+                            owned = true;
+                        }
+                    }
+                    if (owned && !client.detached()) {
+                        client.detached_since = now;
+                        LOG(INFO) << "Client " << key << " detached, keeping session for " 
+                                  << session_timeout.count() << " s." << std::endl;
+                    }
+                }
+            });
+        }
+        // Close the channel once the data plane is done with lookups that refer to it.
+        if (!is_relay_fd(fd)) {
+            rcu.retire([fd]() { close(fd); });
+        }
+    }
+
+    void NSBDaemon::expire_sessions() {
+        auto now = std::chrono::steady_clock::now();
+        for (RcuPointer<Registry<ClientDetails>>* lookup : {&app_client_lookup, &sim_client_lookup}) {
+            std::vector<std::string> expired;
+            for (const auto& [key, client] : lookup->read()) {
+                if (client.detached() && now - client.detached_since > session_timeout) {
+                    expired.push_back(key);
+                }
+            }
+            if (expired.empty()) {
+                continue;
+            }
+            lookup->update([&](Registry<ClientDetails>& clients) {
+                for (const std::string& key : expired) {
+                    clients.erase(key);
+                }
+            });
+            for (std::string& key : expired) {
+                LOG(INFO) << "Session of " << key << " expired." << std::endl;
+                client_metrics.erase(key);
+                // Have the data plane discard any messages held for the client.
+                to_data.post(Handoff(Handoff::Kind::EXPIRED, -1, std::move(key)));
+            }
+        }
+    }
+
+    void NSBDaemon::forward(const Registry<ClientDetails>& lookup, const std::string& key, nsb::nsbm* message) {
+        auto target = lookup.find(key);
+        if (target == lookup.end()) {
+            LOG(ERROR) << "No client " << key << " available to forward message to." << std::endl;
+            return;
+        }
+        int target_fd = target->second.ch_RECV_fd;
+        if (!target->second.detached()) {
+            if (queue_datagram(target->second, message)) {
+                DLOG(INFO) << "\tQueued message for " << key << " DGRAM channel." << std::endl;
+                return;
+            }
+            DLOG(INFO) << "Attempting to forward message to " << key 
+                       << " RECV channel (FD:" << target_fd << ")..." << std::endl;
+        }
+        // Serialize the message and send it to the target RECV channel.
+        std::size_t size = message->ByteSizeLong();
+        ConnectionBuffer buffer(size);
+        message->SerializeToArray(buffer.data(), size);
+        if (target_fd != -1 && is_relay_fd(target_fd)) {
+            if (write_channel(target_fd, buffer.data(), size, MSG_NOSIGNAL) == 0) {
+                DLOG(INFO) << "\tRelayed message to " << key << " RECV channel (" << size << " B)" << std::endl;
+                return;
+            }
+        } else if (target_fd != -1) {
+            fd_set write_fd;
+            FD_ZERO(&write_fd);
+            FD_SET(target_fd, &write_fd);
+            // Check if the target RECV channel is available.
+            if (select(target_fd + 1, nullptr, &write_fd, nullptr, nullptr) > 0 && FD_ISSET(target_fd, &write_fd) &&
+                send(target_fd, buffer.data(), size, MSG_NOSIGNAL) >= 0) {
+                DLOG(INFO) << "\tForwarded message to " << key << " RECV channel (" << size << " B)" << std::endl;
+                return;
+            }
+            DLOG(ERROR) << key << " RECV channel not available for forwarding." << std::endl;
+        }
+        // Hold the message until the client resumes its session.
+        DLOG(INFO) << "\tHolding message for " << key << " until it reconnects." << std::endl;
+        pending_forwards[key].push_back(std::move(buffer));
+    }
+
+    void NSBDaemon::flush_pending_forwards(const std::string& key, const ClientDetails& target) {
+        auto pending = pending_forwards.find(key);
+        if (pending == pending_forwards.end()) {
+            return;
+        }
+        if (target.ch_RECV_fd == -1) {
+            LOG(WARNING) << "\tNo RECV channel to deliver held messages to " << key << "." << std::endl;
+            return;
+        }
+        LOG(INFO) << "\tDelivering " << pending->second.size() << " held message(s) to " << key << "." << std::endl;
+        for (const ConnectionBuffer& buffer : pending->second) {
+            write_channel(target.ch_RECV_fd, buffer.data(), buffer.size(), MSG_NOSIGNAL);
+        }
+        pending_forwards.erase(pending);
+    }
+
+    void NSBDaemon::ring_doorbells() {
+        ring_doorbells(tx_doorbells, *tx_buffer, tx_arrivals, sim_client_lookup.read());
+        ring_doorbells(rx_doorbells, *rx_buffer, rx_arrivals, app_client_lookup.read());
+    }
+
+    void NSBDaemon::ring_doorbells(Doorbells& doorbells, QueueBackend& buffer,
+                                   const Registry<ArrivalEstimator>& arrivals, const Registry<ClientDetails>& lookup) {
+        for (const std::string& key : doorbells.due) {
+            auto armed = doorbells.armed.find(key);
+            if (armed == doorbells.armed.end()) {
+                continue;
+            }
+            // Disarm regardless, as a client that has gone away resynchronizes by fetching.
+            std::string target_key = std::move(armed->second);
+            doorbells.armed.erase(armed);
+            auto target = lookup.find(target_key);
+            if (target == lookup.end() || target->second.detached()) {
+                continue;
+            }
+            nsb::nsbm notification;
+            nsb::nsbm::Manifest* manifest = notification.mutable_manifest();
+            manifest->set_op(nsb::nsbm::Manifest::NOTIFY);
+            manifest->set_og(nsb::nsbm::Manifest::DAEMON);
+            manifest->set_code(nsb::nsbm::Manifest::MESSAGE);
+            set_poll_hints(buffer, arrivals, key, &notification);
+            if (notification.hints().queue_depth() == 0) {
+                continue;
+            }
+            // List the keys of the waiting payloads so the client can prefetch them.
+            if (cfg.USE_DB) {
+                nsb::nsbm::Batch* batch = notification.mutable_batch();
+                for (std::string& payload_key : buffer.peekPayloads(key, DOORBELL_MAX_KEYS)) {
+                    batch->add_entries()->set_msg_key(std::move(payload_key));
+                }
+            }
+            DLOG(INFO) << "Ringing doorbell of " << target_key << ": " << notification.hints().queue_depth()
+                       << " message(s), " << notification.hints().queue_bytes() << " B." << std::endl;
+            if (queue_datagram(target->second, &notification)) {
+                continue;
+            }
+            std::string data = notification.SerializeAsString();
+            if (target->second.ch_RECV_fd == -1 ||
+                write_channel(target->second.ch_RECV_fd, data.data(), data.size(), MSG_NOSIGNAL | MSG_DONTWAIT) != 0) {
+                DLOG(WARNING) << "\tCould not ring doorbell of " << target_key << "." << std::endl;
+            }
+        }
+        doorbells.due.clear();
+    }
+
+    void NSBDaemon::handle_message(int fd, const char* data, std::size_t size, Plane plane) {
+        nsb::nsbm nsb_message;
+        nsb_message.ParseFromArray(data, size);
+        // Pass on messages meant for the other plane.
+        if (plane_of(nsb_message.manifest().op()) != plane) {
+            ConnectionBuffer message(data, data + size);
+            if (plane == Plane::CONTROL) {
+                hand_over_fd(fd, std::move(message));
+            } else {
+                to_control.post(Handoff(Handoff::Kind::MESSAGE, fd, "", std::move(message)));
+            }
+            return;
+        }
+        // Register relayed channels under their link's address, where they were found.
+        if (is_relay_fd(fd) && nsb_message.manifest().op() == nsb::nsbm::Manifest::INIT) {
+            std::lock_guard<std::mutex> lock(relay_mutex);
+            auto channel = relay_channels.find(fd);
+            if (channel != relay_channels.end()) {
+                nsb_message.mutable_intro()->set_address(relay_links.at(channel->second.link_fd).address);
+            }
+        }
+        // Account for the parsed message while it is being handled.
+        std::size_t message_space = nsb_message.SpaceUsedLong();
+        MemoryAccounting::record(MemoryTag::PROTOBUF, message_space);
         nsb::nsbm::Manifest manifest = nsb_message.manifest();
         DLOG(INFO) << "Manifest " << nsb::nsbm::Manifest::Operation_Name(manifest.op()) << "<--" 
                    << nsb::nsbm::Manifest::Originator_Name(manifest.og())
@@ -203,7 +1113,7 @@ namespace nsb {
                 handle_ping(&nsb_message, &nsb_response, &response_required);
                 break;
             case nsb::nsbm::Manifest::SEND:
-                handle_send(&nsb_message, &nsb_response, &response_required);
+                handle_send(fd, &nsb_message, &nsb_response, &response_required);
                 break;
             case nsb::nsbm::Manifest::FETCH:
                 handle_fetch(&nsb_message, &nsb_response, &response_required);
@@ -214,6 +1124,15 @@ namespace nsb {
             case nsb::nsbm::Manifest::RECEIVE:
                 handle_receive(&nsb_message, &nsb_response, &response_required);
                 break;
+            case nsb::nsbm::Manifest::STATS:
+                handle_stats(&nsb_message, &nsb_response, &response_required);
+                break;
+            case nsb::nsbm::Manifest::PROFILE:
+                handle_profile(&nsb_message, &nsb_response, &response_required);
+                break;
+            case nsb::nsbm::Manifest::RELAY:
+                handle_relay_link(fd, &nsb_message, &nsb_response, &response_required);
+                break;
             case nsb::nsbm::Manifest::EXIT:
                 LOG(INFO) << "Exiting." << std::endl;
                 // Stop the daemon.
@@ -230,11 +1149,35 @@ namespace nsb {
         // Send response if required.
         if (response_required) {
             std::size_t size = nsb_response.ByteSizeLong();
-            void* r_buffer = malloc(size);
-            nsb_response.SerializeToArray(r_buffer, size);
-            DLOG(INFO) << "Sending response back: (" << size << "B) " << r_buffer << std::endl;
-            send(fd, r_buffer, size, 0);
+            ConnectionBuffer r_buffer(size);
+            nsb_response.SerializeToArray(r_buffer.data(), size);
+            DLOG(INFO) << "Sending response back: (" << size << "B)" << std::endl;
+            if (write_channel(fd, r_buffer.data(), size, MSG_NOSIGNAL) != 0) {
+                LOG(WARNING) << "Failed to send response to FD " << fd << ": " << strerror(errno) << std::endl;
+                // Return a fetched or received message to its buffer so it is not lost.
+                nsb::nsbm::Manifest::Operation op = nsb_response.manifest().op();
+                if (nsb_response.manifest().code() == nsb::nsbm::Manifest::MESSAGE &&
+                    (op == nsb::nsbm::Manifest::FETCH || op == nsb::nsbm::Manifest::RECEIVE)) {
+                    MessageEntry entry(nsb_response.metadata().src_id(), nsb_response.metadata().dest_id(),
+                                       msg_get_payload_obj(&nsb_response), nsb_response.metadata().payload_size());
+                    entry_get_checksum(nsb_response.metadata(), &entry);
+                    (op == nsb::nsbm::Manifest::FETCH ? tx_buffer : rx_buffer)->push(entry, true);
+                }
+                // Likewise for a batch, keeping its order.
+                if (nsb_response.has_batch() &&
+                    (op == nsb::nsbm::Manifest::FETCH || op == nsb::nsbm::Manifest::RECEIVE)) {
+                    const auto& entries = nsb_response.batch().entries();
+                    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+                        MessageEntry entry(it->metadata().src_id(), it->metadata().dest_id(),
+                                           cfg.USE_DB ? it->msg_key() : it->payload(),
+                                           it->metadata().payload_size());
+                        entry_get_checksum(it->metadata(), &entry);
+                        (op == nsb::nsbm::Manifest::FETCH ? tx_buffer : rx_buffer)->push(entry, true);
+                    }
+                }
+            }
         }
+        MemoryAccounting::release(MemoryTag::PROTOBUF, message_space);
     }
 
     void NSBDaemon::handle_init(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required) {
@@ -243,33 +1186,58 @@ namespace nsb {
         LOG(INFO) << "Handling INIT message from client " 
                 << incoming_msg->intro().identifier() << "..." << std::endl;
         // Get client details.
-        if (incoming_msg->has_intro()) {
-            if (incoming_msg->manifest().og() == nsb::nsbm::Manifest::APP_CLIENT) {
-                app_client_lookup.emplace(incoming_msg->intro().identifier(), ClientDetails(incoming_msg, fd_lookup));
-                success = true;
-            } else if (incoming_msg->manifest().og() == nsb::nsbm::Manifest::SIM_CLIENT) {
-                if (cfg.SIMULATOR_MODE == Config::SimulatorMode::PER_NODE) {
-                    // If per-node simulator mode, use the identifier as the key.
-                    sim_client_lookup.emplace(incoming_msg->intro().identifier(), ClientDetails(incoming_msg, fd_lookup));
-                    success = true;
-                } else if (cfg.SIMULATOR_MODE == Config::SimulatorMode::SYSTEM_WIDE) {
-                    // If system-wide simulator mode, check that there isn't already one.
-                    if (sim_client_lookup.size() > 0) {
-                        LOG(ERROR) << "\tSystem-wide simulator mode only allows for one simulator client." << std::endl;
-                    } else {
-                        // Use a generic key as it's not important.
-                        sim_client_lookup.emplace("simulator", ClientDetails(incoming_msg, fd_lookup));
-                        success = true;
-                    }
-                }
-            } else {
-                LOG(ERROR) << "\tUnknown/unexpected originator." << std::endl;
-                return;
+        if (!incoming_msg->has_intro()) {
+            LOG(ERROR) << "\tNo client details provided in INIT message." << std::endl;
+            return;
+        }
+        // Find the lookup and key the client is registered under.
+        RcuPointer<Registry<ClientDetails>>* lookup;
+        std::string key = incoming_msg->intro().identifier();
+        if (incoming_msg->manifest().og() == nsb::nsbm::Manifest::APP_CLIENT) {
+            lookup = &app_client_lookup;
+        } else if (incoming_msg->manifest().og() == nsb::nsbm::Manifest::SIM_CLIENT) {
+            lookup = &sim_client_lookup;
+            // If system-wide simulator mode, use a generic key as it's not important.
+            if (cfg.SIMULATOR_MODE == Config::SimulatorMode::SYSTEM_WIDE) {
+                key = "simulator";
             }
         } else {
-            LOG(ERROR) << "\tNo client details provided in INIT message." << std::endl;
+            LOG(ERROR) << "\tUnknown/unexpected originator." << std::endl;
             return;
         }
+        ClientDetails details(incoming_msg, fd_lookup);
+        const std::string& token = incoming_msg->intro().session_token();
+        bool resumed = false;
+        const Registry<ClientDetails>& clients = lookup->read();
+        auto existing = clients.find(key);
+        bool registered = existing != clients.end();
+        if (!registered) {
+            success = true;
+        } else if (!token.empty() && token == existing->second.session_token) {
+            // The client is resuming its session on new connections.
+            LOG(INFO) << "\tResuming session of " << key << "." << std::endl;
+            resumed = true;
+            success = true;
+        } else if (existing->second.detached()) {
+            // A new client may take over a detached client's identifier.
+            LOG(INFO) << "\tReplacing detached session of " << key << "." << std::endl;
+            success = true;
+        } else if (lookup == &sim_client_lookup && cfg.SIMULATOR_MODE == Config::SimulatorMode::SYSTEM_WIDE) {
+            LOG(ERROR) << "\tSystem-wide simulator mode only allows for one simulator client." << std::endl;
+        } else {
+            LOG(ERROR) << "\tClient " << key << " is already connected." << std::endl;
+        }
+        if (success) {
+            details.session_token = resumed ? token : generate_session_token();
+            lookup->update([&](Registry<ClientDetails>& next) { next[key] = details; });
+            // Serve the client's data channels on the data plane from now on.
+            hand_over_fd(details.ch_SEND_fd);
+            hand_over_fd(details.ch_RECV_fd);
+            // Deliver anything that was held while the client was away.
+            if (registered) {
+                to_data.post(Handoff(Handoff::Kind::RESUMED, -1, key));
+            }
+        }
         *response_required = true;
         // Send back configuration details.
         nsb::nsbm::Manifest* out_manifest = outgoing_msg->mutable_manifest();
@@ -280,12 +1248,27 @@ namespace nsb {
         out_config->set_sys_mode(static_cast<nsb::nsbm::ConfigParams::SystemMode>(cfg.SYSTEM_MODE));
         out_config->set_use_db(cfg.USE_DB);
         out_config->set_sim_mode(static_cast<nsb::nsbm::ConfigParams::SimulatorMode>(cfg.SIMULATOR_MODE));
+        out_config->set_use_dgram(cfg.USE_DGRAM);
+        out_config->set_use_checksum(cfg.USE_CHECKSUM);
+        if (cfg.USE_DGRAM) {
+            out_config->set_dgram_port(cfg.DGRAM_PORT);
+            out_config->set_dgram_max_size(cfg.DGRAM_MAX_SIZE);
+        }
+        if (success) {
+            out_config->set_session_token(details.session_token);
+            out_config->set_resumed(resumed);
+        }
         LOG(INFO) << "\tReturning configuration: Mode " << nsb::nsbm::ConfigParams::SystemMode(out_config->sys_mode())
                 << " | Use DB? " << out_config->use_db() << std::endl;
         if (cfg.USE_DB) {
             out_config->set_db_address(cfg.DB_ADDRESS);
             out_config->set_db_port(cfg.DB_PORT);
             out_config->set_db_num(cfg.DB_NUM);
+            for (const DBShard& shard : cfg.DB_SHARDS) {
+                nsb::nsbm::ConfigParams::DBShard* out_shard = out_config->add_db_shards();
+                out_shard->set_address(shard.address);
+                out_shard->set_port(shard.port);
+            }
         }
         LOG(INFO) << "\tDatabase Address: " << cfg.DB_ADDRESS << " | Database Port: " << cfg.DB_PORT << std::endl;
     }
@@ -299,8 +1282,81 @@ namespace nsb {
         *response_required = true;
     }
 
-    void NSBDaemon::handle_send(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required) {
+    void NSBDaemon::handle_send(int fd, nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required) {
         *response_required = false;
+        // Identify the sender by the client registered with the channel, not the source it claims.
+        const Registry<ClientDetails>& app_clients = app_client_lookup.read();
+        auto client = app_clients.find(incoming_msg->metadata().src_id());
+        if (client == app_clients.end() || client->second.ch_SEND_fd != fd) {
+            client = std::find_if(app_clients.begin(), app_clients.end(),
+                [fd](const auto& entry) { return entry.second.ch_SEND_fd == fd; });
+        }
+        const std::string src_id = client != app_clients.end() ? client->first : "fd:" + std::to_string(fd);
+        // Count the message, and check it against the client's rate limits.
+        RateLimiter::Verdict verdict = RateLimiter::Verdict::ADMIT;
+        std::chrono::steady_clock::duration delay = std::chrono::steady_clock::duration::zero();
+        std::chrono::steady_clock::duration pace = std::chrono::steady_clock::duration::zero();
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            if (rate_limiter.enabled()) {
+                verdict = rate_limiter.admit(src_id, incoming_msg->metadata().payload_size(), &delay);
+            }
+            // Count only traffic that is let through; the rate limiter counts the rest.
+            if (verdict == RateLimiter::Verdict::ADMIT || verdict == RateLimiter::Verdict::DELAY) {
+                hot_sources.record(src_id, incoming_msg->metadata().payload_size());
+            }
+            // Pace messages that are accepted to what the simulator can drain.
+            if (governor.enabled() &&
+                (verdict == RateLimiter::Verdict::ADMIT || verdict == RateLimiter::Verdict::DELAY)) {
+                pace = governor.admit(std::chrono::steady_clock::now());
+            }
+        }
+        if (verdict == RateLimiter::Verdict::DELAY || pace > std::chrono::steady_clock::duration::zero()) {
+            // Accept this message, but stop reading from the client's SEND channel for a while.
+            delay = std::max(delay, pace);
+            if (client != app_clients.end() && is_relay_fd(client->second.ch_SEND_fd)) {
+                // Have the proxy pause reading the channel instead.
+                nsb::nsbm::Relay::Frame frame;
+                frame.set_pause_us(std::chrono::duration_cast<std::chrono::microseconds>(delay).count());
+                relay_frame(client->second.ch_SEND_fd, std::move(frame));
+            } else if (client != app_clients.end() && client->second.ch_SEND_fd != -1) {
+                paused_fds[client->second.ch_SEND_fd] = std::chrono::steady_clock::now() + delay;
+            }
+            if (client != app_clients.end() && client->second.ch_SEND_fd != -1) {
+                DLOG(INFO) << "SEND from " << src_id
+                    << (verdict == RateLimiter::Verdict::DELAY ? " rate limited" : " paced")
+                    << ", pausing SEND channel for "
+                    << std::chrono::duration_cast<std::chrono::microseconds>(delay).count() << " us." << std::endl;
+            }
+        } else if (verdict != RateLimiter::Verdict::ADMIT) {
+            // Reclaim the stored payload of a message that will never be delivered.
+            if (cfg.USE_DB && db && !incoming_msg->msg_key().empty()) {
+                int64_t reclaimed = db->reclaim({incoming_msg->msg_key()});
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                delivery_counts.reclaimed += reclaimed;
+            }
+            if (verdict == RateLimiter::Verdict::REJECT) {
+                LOG(INFO) << "SEND from " << src_id << " rejected (rate limited)." << std::endl;
+                nsb::nsbm::Manifest* out_manifest = outgoing_msg->mutable_manifest();
+                out_manifest->set_op(nsb::nsbm::Manifest::SEND);
+                out_manifest->set_og(nsb::nsbm::Manifest::DAEMON);
+                out_manifest->set_code(nsb::nsbm::Manifest::FAILURE);
+                outgoing_msg->mutable_metadata()->CopyFrom(incoming_msg->metadata());
+                if (!incoming_msg->msg_key().empty()) {
+                    outgoing_msg->set_msg_key(incoming_msg->msg_key());
+                }
+                // Rejections may be read several at a time, so frame each one.
+                std::string frame;
+                packFrame(outgoing_msg->SerializeAsString(), &frame);
+                if (write_channel(fd, frame.data(), frame.size(), MSG_NOSIGNAL) != 0) {
+                    DLOG(WARNING) << "\tCould not report rejection to " << src_id << "." << std::endl;
+                }
+                return;
+            } else if (verdict == RateLimiter::Verdict::DROP) {
+                LOG(INFO) << "SEND from " << src_id << " dropped (rate limited)." << std::endl;
+                return;
+            }
+        }
         LOG(INFO) << "Handling SEND message from client " 
                 << incoming_msg->intro().identifier() << " in ";
         if (cfg.SYSTEM_MODE == Config::SystemMode::PULL) {
@@ -316,13 +1372,16 @@ namespace nsb {
                 payload_obj,
                 in_metadata.payload_size()
             );
+            entry_get_checksum(in_metadata, &msg_entry);
             DLOG(INFO) << "TX entry created | " 
                 << in_metadata.payload_size() << " B | src: " 
                 << msg_entry.source << " | dest: " 
                 << msg_entry.destination << std::endl;
             DLOG(INFO) << (cfg.USE_DB ? "\tPayload ID: ": "\tPayload: ") << msg_entry.payload_obj << std::endl;
             // Add it to the buffer.
-            tx_buffer.push_back(msg_entry);
+            record_arrival(tx_arrivals, msg_entry.source);
+            mark_doorbells(tx_doorbells, msg_entry.source);
+            tx_buffer->push(msg_entry);
         } else if (cfg.SYSTEM_MODE == Config::SystemMode::PUSH) {
             LOG(INFO).NoPrefix() << "PUSH mode..." << std::endl;
             // Copy the incoming message to the outgoing message, replacing with SEND to FORWARD.
@@ -330,62 +1389,39 @@ namespace nsb {
             outgoing_msg->MergeFrom(*incoming_msg);
             nsb::nsbm::Manifest* out_manifest = outgoing_msg->mutable_manifest();
             out_manifest->set_op(nsb::nsbm::Manifest::FORWARD);
-            // Send to sim via RECV channel.
-            fd_set write_fd;
-            FD_ZERO(&write_fd);
-            // Select the target simulator if multiple simulator clients are used, else select the first and only one.
-            ClientDetails target_sim;
-            if (cfg.SIMULATOR_MODE == Config::SimulatorMode::SYSTEM_WIDE) {
-                // If system-wide simulator client, just get the only client in the lookup.
-                target_sim = sim_client_lookup.begin()->second;
-            } else if (cfg.SIMULATOR_MODE == Config::SimulatorMode::PER_NODE) {
-                // If per-node simulator client, use the source ID to specify the target sim.
-                target_sim = sim_client_lookup.at(incoming_msg->metadata().src_id());
-            } else {
-                LOG(ERROR) << "No simulator clients available to forward message." << std::endl;
-                return;
-            }
-            FD_SET(target_sim.ch_RECV_fd, &write_fd);
-            // Check if the sim RECV channel is available.
-            DLOG(INFO) << "Attempting to forward message to sim RECV channel (FD:" 
-                << target_sim.ch_RECV_fd << ")..." << std::endl;
-            if (select(target_sim.ch_RECV_fd + 1, nullptr, &write_fd, nullptr, nullptr) > 0) {
-                if (FD_ISSET(target_sim.ch_RECV_fd, &write_fd)) {
-                    // Serialize the message and send it to the sim RECV channel.
-                    std::size_t size = outgoing_msg->ByteSizeLong();
-                    void* buffer = malloc(size);
-                    outgoing_msg->SerializeToArray(buffer, size);
-                    send(target_sim.ch_RECV_fd, buffer, size, 0);
-                    DLOG(INFO) << "\tForwarded message to sim RECV channel (" << size << " B)" << std::endl;
-                    free(buffer);
-                }
-            } else {
-                DLOG(ERROR) << "Sim RECV channel not available for forwarding." << std::endl; 
-            }
+            // Select the target simulator if multiple simulator clients are used, else the only one.
+            std::string target_key = (cfg.SIMULATOR_MODE == Config::SimulatorMode::PER_NODE) ?
+                                     incoming_msg->metadata().src_id() : "simulator";
+            forward(sim_client_lookup.read(), target_key, outgoing_msg);
         }
     }
 
     void NSBDaemon::handle_fetch(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required) {
         *response_required = false;
         DLOG(INFO) << "Handling FETCH message on behalf of " << incoming_msg->metadata().src_id() << std::endl;
+        if (incoming_msg->max_batch() != 0) {
+            const std::string& src_id = incoming_msg->metadata().src_id();
+            std::string requester = (cfg.SIMULATOR_MODE == Config::SimulatorMode::PER_NODE) ? src_id : "simulator";
+            handle_batch_request(*tx_buffer, tx_arrivals, tx_doorbells, src_id, requester,
+                                 incoming_msg, outgoing_msg);
+            *response_required = true;
+            return;
+        }
         MessageEntry fetched_message;
+        std::string fetch_key = "";
         // Check to see if source has been specified.
         if (incoming_msg->has_metadata()) {
             nsb::nsbm::Metadata in_metadata = incoming_msg->metadata();
             if (in_metadata.has_src_id()) {
-                // Search for the message in the buffer.
-                auto it = std::find_if(tx_buffer.begin(), tx_buffer.end(),
-                          [&](const auto& msg) { return msg.source == in_metadata.src_id(); });
-                if (it != tx_buffer.end()) {
-                    fetched_message = *it;
-                    tx_buffer.erase(it);
-                }
-            } else {
-                // If source not specified, pop the next message in the queue.
-                if (!tx_buffer.empty()) {
-                    fetched_message = tx_buffer.front();
-                    tx_buffer.pop_front();
-                }
+                fetch_key = in_metadata.src_id();
+            }
+            // A single FETCH expects its response, not a NOTIFY.
+            disarm_doorbell(tx_doorbells, fetch_key);
+            // Take the next message from the source, or the next in the queue if not specified.
+            std::vector<MessageEntry> taken = tx_buffer->take(fetch_key, 1);
+            record_drain(taken);
+            if (!taken.empty()) {
+                fetched_message = std::move(taken.front());
             }
         }
         if (fetched_message.exists()) {
@@ -407,15 +1443,21 @@ namespace nsb {
             out_metadata->set_src_id(fetched_message.source);
             out_metadata->set_dest_id(fetched_message.destination);
             out_metadata->set_payload_size(static_cast<int>(fetched_message.payload_size));
+            entry_set_checksum(fetched_message, out_metadata);
             msg_set_payload_obj(fetched_message.payload_obj, outgoing_msg);
         } else {
             // Otherwise, indicate no message was fetched.
             out_manifest->set_code(nsb::nsbm::Manifest::NO_MESSAGE);
         }
+        set_poll_hints(*tx_buffer, tx_arrivals, fetch_key, outgoing_msg);
         *response_required = true;
     }
 
     void NSBDaemon::handle_post(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required) {
+        if (incoming_msg->has_batch()) {
+            handle_post_batch(incoming_msg, outgoing_msg, response_required);
+            return;
+        }
         *response_required = false;
         LOG(INFO) << "Handling POST message from client " 
                 << incoming_msg->intro().identifier() << " in ";
@@ -426,6 +1468,10 @@ namespace nsb {
             if (in_manifest.code() == nsb::nsbm::Manifest::MESSAGE) {
                 // Parse the metadata.
                 nsb::nsbm::Metadata in_metadata = incoming_msg->metadata();
+                {
+                    std::lock_guard<std::mutex> lock(stats_mutex);
+                    hot_destinations.record(in_metadata.dest_id(), in_metadata.payload_size());
+                }
                 // Retrieve payload if using database, otherwise no need.
                 std::string payload_obj = msg_get_payload_obj(incoming_msg);
                 // Store payload.
@@ -435,75 +1481,110 @@ namespace nsb {
                     payload_obj,
                     in_metadata.payload_size()
                 );
+                entry_get_checksum(in_metadata, &msg_entry);
                 DLOG(INFO) << "RX entry created | " 
                         << in_metadata.payload_size() << " B | src: " 
                         << msg_entry.source << " | dest: " 
                         << msg_entry.destination << "\n\tPayload: " 
                         << msg_entry.payload_obj << std::endl;
-                rx_buffer.push_back(msg_entry);
+                record_arrival(rx_arrivals, msg_entry.destination);
+                mark_doorbells(rx_doorbells, msg_entry.destination);
+                rx_buffer->push(msg_entry);
             }
         } else if (cfg.SYSTEM_MODE == Config::SystemMode::PUSH) {
             LOG(INFO).NoPrefix() << "PUSH mode..." << std::endl;
+            {
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                hot_destinations.record(incoming_msg->metadata().dest_id(), incoming_msg->metadata().payload_size());
+            }
             // Copy the incoming message to the outgoing message, replacing with SEND to FORWARD.
             outgoing_msg->Clear();
             outgoing_msg->MergeFrom(*incoming_msg);
             nsb::nsbm::Manifest* out_manifest = outgoing_msg->mutable_manifest();
             out_manifest->set_op(nsb::nsbm::Manifest::FORWARD);
-            // Get the destination to forward to.
-            std::string dest_id = incoming_msg->metadata().dest_id();
-            int target_fd = (app_client_lookup.find(dest_id) != app_client_lookup.end()) ? app_client_lookup[dest_id].ch_RECV_fd : -1;
-            // Send to sim via RECV channel.
-            if (target_fd != -1) {
-                fd_set write_fd;
-                FD_ZERO(&write_fd);
-                FD_SET(target_fd, &write_fd);
-                // Check if the client RECV channel is available.
-                DLOG(INFO) << "Attempting to forward message to " 
-                        << dest_id << " RECV channel (FD:" 
-                        << target_fd << ")..." << std::endl;
-                if (select(target_fd + 1, nullptr, &write_fd, nullptr, nullptr) > 0) {
-                    if (FD_ISSET(target_fd, &write_fd)) {
-                        // Serialize the message and send it to the target RECV channel.
-                        std::size_t size = outgoing_msg->ByteSizeLong();
-                        void* buffer = malloc(size);
-                        outgoing_msg->SerializeToArray(buffer, size);
-                        send(target_fd, buffer, size, 0);
-                        DLOG(INFO) << "\tForwarded message to " 
-                                << dest_id << " RECV channel (" 
-                                << size << " B)" << std::endl;
-                        free(buffer);
-                    }
+            // Forward to the destination application client.
+            forward(app_client_lookup.read(), incoming_msg->metadata().dest_id(), outgoing_msg);
+        }
+    }
+
+    void NSBDaemon::handle_post_batch(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required) {
+        *response_required = false;
+        const nsb::nsbm::Batch& batch = incoming_msg->batch();
+        LOG(INFO) << "Handling POST batch of " << batch.entries_size() << " message(s)..." << std::endl;
+        // Count the verdicts all at once.
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            for (const nsb::nsbm::Batch::Entry& entry : batch.entries()) {
+                if (entry.verdict() == nsb::nsbm::Batch::Entry::DELIVERED) {
+                    delivery_counts.delivered++;
+                    hot_destinations.record(entry.metadata().dest_id(), entry.metadata().payload_size());
+                } else if (entry.verdict() == nsb::nsbm::Batch::Entry::CORRUPTED) {
+                    delivery_counts.corrupted++;
                 } else {
-                    DLOG(ERROR) << dest_id << " RECV channel not available for forwarding." << std::endl; 
+                    delivery_counts.dropped++;
                 }
-            } else {
-                DLOG(ERROR) << "No destination FD found for forwarding to " 
-                            << dest_id << "." << std::endl;
             }
         }
+        const Registry<ClientDetails>& app_clients = app_client_lookup.read();
+        std::vector<std::string> reclaim_keys;
+        for (const nsb::nsbm::Batch::Entry& entry : batch.entries()) {
+            if (entry.verdict() != nsb::nsbm::Batch::Entry::DELIVERED) {
+                if (!entry.msg_key().empty()) {
+                    reclaim_keys.push_back(entry.msg_key());
+                }
+                continue;
+            }
+            const std::string& payload_obj = cfg.USE_DB ? entry.msg_key() : entry.payload();
+            if (cfg.SYSTEM_MODE == Config::SystemMode::PULL) {
+                MessageEntry msg_entry(entry.metadata().src_id(), entry.metadata().dest_id(),
+                                       payload_obj, entry.metadata().payload_size());
+                entry_get_checksum(entry.metadata(), &msg_entry);
+                record_arrival(rx_arrivals, msg_entry.destination);
+                mark_doorbells(rx_doorbells, msg_entry.destination);
+                rx_buffer->push(msg_entry);
+            } else if (cfg.SYSTEM_MODE == Config::SystemMode::PUSH) {
+                // Forward each delivered message on its own, as in handle_post().
+                outgoing_msg->Clear();
+                nsb::nsbm::Manifest* out_manifest = outgoing_msg->mutable_manifest();
+                out_manifest->set_op(nsb::nsbm::Manifest::FORWARD);
+                out_manifest->set_og(incoming_msg->manifest().og());
+                out_manifest->set_code(nsb::nsbm::Manifest::MESSAGE);
+                *outgoing_msg->mutable_metadata() = entry.metadata();
+                msg_set_payload_obj(payload_obj, outgoing_msg);
+                forward(app_clients, entry.metadata().dest_id(), outgoing_msg);
+            }
+        }
+        if (!reclaim_keys.empty() && db) {
+            int64_t reclaimed = db->reclaim(reclaim_keys);
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            delivery_counts.reclaimed += reclaimed;
+        }
     }
 
     void NSBDaemon::handle_receive(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required) {
         LOG(INFO) << "Handling RECEIVE message from client " 
                 << incoming_msg->intro().identifier() << "." << std::endl;
+        if (incoming_msg->max_batch() != 0) {
+            const std::string& dest_id = incoming_msg->metadata().dest_id();
+            handle_batch_request(*rx_buffer, rx_arrivals, rx_doorbells, dest_id, dest_id,
+                                 incoming_msg, outgoing_msg);
+            *response_required = true;
+            return;
+        }
         MessageEntry received_message;
+        std::string receive_key = "";
         // Check for destination.
         if (incoming_msg->has_metadata()) {
             nsb::nsbm::Metadata in_metadata = incoming_msg->metadata();
             if (in_metadata.has_dest_id()) {
-                // Search for the message in the buffer.
-                auto it = std::find_if(rx_buffer.begin(), rx_buffer.end(),
-                          [&](const auto& msg) { return msg.destination == in_metadata.dest_id(); });
-                if (it != rx_buffer.end()) {
-                    received_message = *it;
-                    rx_buffer.erase(it);
-                }
-            } else {
-                // If destination not specified, pop the next message in the queue.
-                if (!rx_buffer.empty()) {
-                    received_message = rx_buffer.front();
-                    rx_buffer.pop_front();
-                }
+                receive_key = in_metadata.dest_id();
+            }
+            // A single RECEIVE expects its response, not a NOTIFY.
+            disarm_doorbell(rx_doorbells, receive_key);
+            // Take the next message for the destination, or the next in the queue if not specified.
+            std::vector<MessageEntry> taken = rx_buffer->take(receive_key, 1);
+            if (!taken.empty()) {
+                received_message = std::move(taken.front());
             }
         }
         if (received_message.exists()) {
@@ -526,18 +1607,220 @@ namespace nsb {
             out_metadata->set_src_id(received_message.source);
             out_metadata->set_dest_id(received_message.destination);
             out_metadata->set_payload_size(static_cast<int>(received_message.payload_size));
+            entry_set_checksum(received_message, out_metadata);
             msg_set_payload_obj(received_message.payload_obj, outgoing_msg);
         } else {
             // Otherwise, indicate no message found.
             out_manifest->set_code(nsb::nsbm::Manifest::NO_MESSAGE);
         }
+        set_poll_hints(*rx_buffer, rx_arrivals, receive_key, outgoing_msg);
         *response_required = true;
     }
 
+    void NSBDaemon::handle_batch_request(QueueBackend& buffer, const Registry<ArrivalEstimator>& arrivals,
+                                         Doorbells& doorbells, const std::string& key, const std::string& requester,
+                                         nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg) {
+        nsb::nsbm::Batch* batch = outgoing_msg->mutable_batch();
+        std::vector<MessageEntry> taken = buffer.take(key, incoming_msg->max_batch());
+        if (&buffer == tx_buffer.get()) {
+            record_drain(taken);
+        }
+        for (MessageEntry& entry : taken) {
+            nsb::nsbm::Batch::Entry* out = batch->add_entries();
+            nsb::nsbm::Metadata* out_metadata = out->mutable_metadata();
+            out_metadata->set_src_id(entry.source);
+            out_metadata->set_dest_id(entry.destination);
+            out_metadata->set_payload_size(entry.payload_size);
+            entry_set_checksum(entry, out_metadata);
+            if (cfg.USE_DB) {
+                out->set_msg_key(std::move(entry.payload_obj));
+            } else {
+                out->set_payload(std::move(entry.payload_obj));
+            }
+        }
+        DLOG(INFO) << "Returning batch of " << batch->entries_size() << " message(s) for "
+                   << (key.empty() ? "any client" : key) << "." << std::endl;
+        // Prepare response.
+        nsb::nsbm::Manifest* out_manifest = outgoing_msg->mutable_manifest();
+        out_manifest->set_op(incoming_msg->manifest().op());
+        out_manifest->set_og(nsb::nsbm::Manifest::DAEMON);
+        out_manifest->set_code(batch->entries_size() > 0 ? nsb::nsbm::Manifest::MESSAGE
+                                                         : nsb::nsbm::Manifest::NO_MESSAGE);
+        set_poll_hints(buffer, arrivals, key, outgoing_msg);
+        // Once the requester has everything, ring its doorbell for the next message if it awaits one.
+        if (incoming_msg->arm_doorbell() && outgoing_msg->hints().queue_depth() == 0 && !requester.empty()) {
+            doorbells.armed[key] = requester;
+        } else {
+            disarm_doorbell(doorbells, key);
+        }
+    }
+
+    void NSBDaemon::set_poll_hints(QueueBackend& buffer, const Registry<ArrivalEstimator>& arrivals,
+                                   const std::string& key, nsb::nsbm* outgoing_msg) {
+        auto now = std::chrono::steady_clock::now();
+        // Count remaining messages for the key.
+        QueueBackend::Depth depth = buffer.depth(key);
+        nsb::nsbm::PollHints* hints = outgoing_msg->mutable_hints();
+        hints->set_queue_depth(depth.count);
+        hints->set_queue_bytes(depth.bytes);
+        if (depth.count > 0) {
+            hints->set_oldest_age_us(
+                std::chrono::duration_cast<std::chrono::microseconds>(now - depth.oldest).count());
+        }
+        // Suggest polling again right away while messages remain.
+        int64_t next_poll_us = 0;
+        if (depth.count == 0) {
+            auto it = arrivals.find(key);
+            double expected = (it != arrivals.end()) ? it->second.expected(now) : 0;
+            next_poll_us = (expected > 0) ? static_cast<int64_t>(expected * 0.5e6) : MAX_POLL_HINT_US;
+            next_poll_us = std::clamp(next_poll_us, MIN_POLL_HINT_US, MAX_POLL_HINT_US);
+        }
+        hints->set_next_poll_us(next_poll_us);
+    }
+
+    void NSBDaemon::handle_stats(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required) {
+        DLOG(INFO) << "Handling STATS message from "
+                   << nsb::nsbm::Manifest::Originator_Name(incoming_msg->manifest().og()) << "." << std::endl;
+        // Keep metrics pushed by clients without responding.
+        if (incoming_msg->manifest().code() == nsb::nsbm::Manifest::MESSAGE) {
+            for (const nsb::nsbm::StatsReport::ClientMetrics& pushed : incoming_msg->stats().clients()) {
+                client_metrics[pushed.client_id()] = pushed;
+            }
+            *response_required = false;
+            return;
+        }
+        nsb::nsbm::Manifest* out_manifest = outgoing_msg->mutable_manifest();
+        out_manifest->set_op(nsb::nsbm::Manifest::STATS);
+        out_manifest->set_og(nsb::nsbm::Manifest::DAEMON);
+        out_manifest->set_code(nsb::nsbm::Manifest::SUCCESS);
+        // Report memory accounting for each tag.
+        nsb::nsbm::StatsReport* out_stats = outgoing_msg->mutable_stats();
+        for (int i = 0; i < static_cast<int>(MemoryTag::COUNT); i++) {
+            MemoryTag tag = static_cast<MemoryTag>(i);
+            MemoryAccounting::Snapshot snap = MemoryAccounting::snapshot(tag);
+            nsb::nsbm::StatsReport::MemoryUsage* usage = out_stats->add_memory();
+            usage->set_tag(MemoryAccounting::tagName(tag));
+            usage->set_bytes(snap.bytes);
+            usage->set_peak_bytes(snap.peak_bytes);
+            usage->set_allocations(snap.allocations);
+            usage->set_total_bytes(snap.total_bytes);
+            usage->set_live_allocations(snap.live_allocations);
+        }
+        // Take the counters the data plane updates, briefly.
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        // Report rate limiting counters for each client and namespace.
+        for (const auto& [key, counters] : rate_limiter.counters()) {
+            nsb::nsbm::StatsReport::RateLimitUsage* usage = out_stats->add_rate_limits();
+            usage->set_key(key);
+            usage->set_admitted(counters.admitted);
+            usage->set_delayed(counters.delayed);
+            usage->set_rejected(counters.rejected);
+            usage->set_dropped(counters.dropped);
+        }
+        // Report verdicts from POST batches.
+        nsb::nsbm::StatsReport::Deliveries* deliveries = out_stats->mutable_deliveries();
+        deliveries->set_delivered(delivery_counts.delivered);
+        deliveries->set_dropped(delivery_counts.dropped);
+        deliveries->set_corrupted(delivery_counts.corrupted);
+        deliveries->set_reclaimed(delivery_counts.reclaimed);
+        // Report the admission governor's state.
+        if (governor.enabled()) {
+            AdmissionGovernor::Status status = governor.status();
+            nsb::nsbm::StatsReport::Governor* out_governor = out_stats->mutable_governor();
+            out_governor->set_throttling(status.throttling);
+            out_governor->set_drain_rate(status.drain_rate);
+            out_governor->set_admit_rate(status.admit_rate);
+            out_governor->set_sojourn_us(status.sojourn_us);
+            out_governor->set_throttles(status.throttles);
+            out_governor->set_paced(status.paced);
+        }
+        // Report the heaviest sources and destinations.
+        for (auto [hitters, report] : {std::make_pair(&hot_sources, out_stats->mutable_sources()),
+                                       std::make_pair(&hot_destinations, out_stats->mutable_destinations())}) {
+            if (!hitters->enabled()) {
+                continue;
+            }
+            for (bool by_bytes : {false, true}) {
+                for (const HeavyHitters::Entry& hitter : hitters->top(by_bytes)) {
+                    nsb::nsbm::StatsReport::HeavyHitters::Entry* entry =
+                        by_bytes ? report->add_by_bytes() : report->add_by_messages();
+                    entry->set_key(hitter.key);
+                    entry->set_messages(hitter.messages);
+                    entry->set_bytes(hitter.bytes);
+                }
+            }
+            report->set_total_messages(hitters->totalMessages());
+            report->set_total_bytes(hitters->totalBytes());
+        }
+        // Report the metrics last pushed by each client.
+        for (const auto& [client_id, pushed] : client_metrics) {
+            *out_stats->add_clients() = pushed;
+        }
+        *response_required = true;
+    }
+
+    void NSBDaemon::handle_profile(nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required) {
+        DLOG(INFO) << "Handling PROFILE message from "
+                   << nsb::nsbm::Manifest::Originator_Name(incoming_msg->manifest().og()) << "." << std::endl;
+        nsb::nsbm::Manifest* out_manifest = outgoing_msg->mutable_manifest();
+        out_manifest->set_op(nsb::nsbm::Manifest::PROFILE);
+        out_manifest->set_og(nsb::nsbm::Manifest::DAEMON);
+        *response_required = true;
+        // Any peer can reach the server port, so this must be turned on explicitly.
+        if (!profiler->getConfig().REMOTE) {
+            LOG(WARNING) << "PROFILE refused: remote profiling is disabled." << std::endl;
+            out_manifest->set_code(nsb::nsbm::Manifest::FAILURE);
+            return;
+        }
+        const nsb::nsbm::ProfileRequest& request = incoming_msg->profile();
+        int duration_ms = request.duration_ms() > 0 ? request.duration_ms() : profiler->getConfig().DURATION_MS;
+        int frequency_hz = request.frequency_hz() > 0 ? request.frequency_hz() : profiler->getConfig().FREQUENCY_HZ;
+        std::string path = profiler->start(duration_ms, frequency_hz, request.path());
+        out_manifest->set_code(path.empty() ? nsb::nsbm::Manifest::FAILURE : nsb::nsbm::Manifest::SUCCESS);
+        // Echo the parameters used so that the requester knows where and when to look.
+        nsb::nsbm::ProfileRequest* out_profile = outgoing_msg->mutable_profile();
+        out_profile->set_duration_ms(std::min(duration_ms, PROFILER_MAX_DURATION_MS));
+        out_profile->set_frequency_hz(std::min(frequency_hz, PROFILER_MAX_FREQUENCY_HZ));
+        out_profile->set_path(path);
+        *response_required = true;
+    }
+
+    void NSBDaemon::handle_relay_link(int fd, nsb::nsbm* incoming_msg, nsb::nsbm* outgoing_msg, bool* response_required) {
+        DLOG(INFO) << "Handling RELAY message from "
+                   << nsb::nsbm::Manifest::Originator_Name(incoming_msg->manifest().og()) << "." << std::endl;
+        nsb::nsbm::Manifest* out_manifest = outgoing_msg->mutable_manifest();
+        out_manifest->set_op(nsb::nsbm::Manifest::RELAY);
+        out_manifest->set_og(nsb::nsbm::Manifest::DAEMON);
+        *response_required = true;
+        // Only a fresh connection can become a link; proxies do not nest.
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (is_relay_fd(fd) || std::find(control_fds.begin(), control_fds.end(), fd) == control_fds.end() ||
+            flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+            LOG(WARNING) << "Refusing relay link on FD " << fd << "." << std::endl;
+            out_manifest->set_code(nsb::nsbm::Manifest::FAILURE);
+            return;
+        }
+        std::string address;
+        {
+            std::lock_guard<std::mutex> lock(relay_mutex);
+            RelayLink& link = relay_links[fd];
+            link.address = "relay-" + std::to_string(++relay_link_count);
+            link.compress = incoming_msg->relay().compress();
+            address = link.address;
+        }
+        LOG(INFO) << "Opened relay link " << address << " on FD " << fd
+                  << (incoming_msg->relay().compress() ? " (compressed)." : ".") << std::endl;
+        out_manifest->set_code(nsb::nsbm::Manifest::SUCCESS);
+        // The data plane reads the link's envelopes from now on.
+        hand_over_fd(fd);
+    }
+
     void NSBDaemon::stop() {
         // If the server is running, stop it.
         if (running) {
             running = false;
+            // Wake the data plane so that it stops too.
+            to_data.wake();
             LOG(INFO) << "NSBDaemon stopped." << std::endl;
         }
     }
@@ -0,0 +1,112 @@
+// nsb_governor.cc
+
+#include "nsb_governor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nsb {
+
+    namespace {
+        AdmissionGovernor::Clock::duration milliseconds(double ms) {
+            return std::chrono::duration_cast<AdmissionGovernor::Clock::duration>(
+                std::chrono::duration<double, std::milli>(ms));
+        }
+    }
+
+    AdmissionGovernor::AdmissionGovernor(const GovernorConfig& config)
+        : cfg(config), target(milliseconds(config.TARGET_MS)), interval(milliseconds(config.INTERVAL_MS)),
+          max_delay(milliseconds(config.MAX_DELAY_MS)) {}
+
+    void AdmissionGovernor::roll(Clock::time_point now) {
+        if (window_start == Clock::time_point{}) {
+            window_start = now;
+            return;
+        }
+        Clock::duration elapsed = now - window_start;
+        if (elapsed < interval) {
+            return;
+        }
+        // Only a backlogged simulator fetches at its capacity; otherwise the rate is the offered load.
+        if (window_backlogged && elapsed < 4 * interval) {
+            double sample = window_dequeued / std::chrono::duration<double>(elapsed).count();
+            drain_rate = (drain_rate > 0) ? 0.75 * drain_rate + 0.25 * sample : sample;
+        }
+        window_start = now;
+        window_dequeued = 0;
+        window_backlogged = throttling;
+    }
+
+    void AdmissionGovernor::dequeued(Clock::time_point queued, Clock::time_point now) {
+        roll(now);
+        window_dequeued++;
+        last_sojourn = now - queued;
+        if (last_sojourn < target) {
+            first_above = Clock::time_point{};
+            if (throttling) {
+                throttling = false;
+                hold_until = now + GOVERNOR_HOLD_INTERVALS * interval;
+            }
+            return;
+        }
+        window_backlogged = true;
+        if (first_above == Clock::time_point{}) {
+            first_above = now + interval;
+            return;
+        }
+        if (now < first_above) {
+            return;
+        }
+        // The sojourn has stayed above the target for a whole interval: a standing queue.
+        if (!throttling) {
+            throttling = true;
+            throttles++;
+            // Pick up near the last episode's pacing if it ended recently.
+            count = (count > 2 && now - next_tighten < GOVERNOR_HOLD_INTERVALS * interval) ? count - 2 : 1;
+            next_tighten = now + std::chrono::duration_cast<Clock::duration>(interval / std::sqrt(count));
+        } else if (now >= next_tighten) {
+            count++;
+            next_tighten += std::chrono::duration_cast<Clock::duration>(interval / std::sqrt(count));
+        }
+    }
+
+    double AdmissionGovernor::admitRate() const {
+        // Drain the excess queue (drain_rate * (sojourn - target) messages) within interval / sqrt(count).
+        double excess = std::chrono::duration<double>(last_sojourn - target).count();
+        double window = std::chrono::duration<double>(interval).count() / std::sqrt(std::max(count, 1));
+        double fraction = std::clamp(1.0 - excess / window, GOVERNOR_MIN_ADMIT_FRACTION, 1.0);
+        return drain_rate * fraction;
+    }
+
+    AdmissionGovernor::Clock::duration AdmissionGovernor::admit(Clock::time_point now) {
+        if (!cfg.ENABLED) {
+            return Clock::duration::zero();
+        }
+        roll(now);
+        if (drain_rate <= 0 || (!throttling && now >= hold_until)) {
+            return Clock::duration::zero();
+        }
+        double rate = throttling ? admitRate() : drain_rate * GOVERNOR_PROBE_FACTOR;
+        // Give each message its own slot at the paced rate, and hold the sender until the next.
+        Clock::time_point slot = std::max(next_slot, now);
+        Clock::duration spacing = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / rate));
+        next_slot = std::min(slot + spacing, now + max_delay);
+        paced++;
+        return next_slot - now;
+    }
+
+    AdmissionGovernor::Status AdmissionGovernor::status() const {
+        Status status;
+        status.throttling = throttling;
+        status.drain_rate = drain_rate;
+        status.admit_rate = (throttling && drain_rate > 0) ? admitRate() : drain_rate;
+        if (!throttling && hold_until > Clock::now()) {
+            status.admit_rate = drain_rate * GOVERNOR_PROBE_FACTOR;
+        }
+        status.sojourn_us = std::chrono::duration_cast<std::chrono::microseconds>(last_sojourn).count();
+        status.throttles = throttles;
+        status.paced = paced;
+        return status;
+    }
+}
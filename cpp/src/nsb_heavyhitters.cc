@@ -0,0 +1,140 @@
+// nsb_heavyhitters.cc
+
+#include "nsb_heavyhitters.h"
+
+#include <limits>
+
+namespace nsb {
+
+    namespace {
+        /** @brief Mixes a hash into a second, independent one (splitmix64's finalizer). */
+        uint64_t remix(uint64_t hash) {
+            hash ^= hash >> 30;
+            hash *= 0xbf58476d1ce4e5b9ULL;
+            hash ^= hash >> 27;
+            hash *= 0x94d049bb133111ebULL;
+            hash ^= hash >> 31;
+            return hash;
+        }
+    }
+
+    CountMinSketch::CountMinSketch(int width, int depth) :
+        width(static_cast<std::size_t>(std::max(width, 1))),
+        depth(static_cast<std::size_t>(std::clamp(depth, 1, SKETCH_MAX_DEPTH))),
+        counters(this->width * this->depth, 0) {}
+
+    std::size_t CountMinSketch::slot(uint64_t hash, std::size_t row) const {
+        // Derive an independent hash per row.
+        uint64_t row_hash = remix(hash + (row + 1) * 0x9e3779b97f4a7c15ULL);
+        return row * width + static_cast<std::size_t>(row_hash % width);
+    }
+
+    int64_t CountMinSketch::add(uint64_t hash, int64_t weight) {
+        std::array<std::size_t, SKETCH_MAX_DEPTH> slots;
+        int64_t estimate = std::numeric_limits<int64_t>::max();
+        for (std::size_t row = 0; row < depth; row++) {
+            slots[row] = slot(hash, row);
+            estimate = std::min(estimate, counters[slots[row]]);
+        }
+        estimate += weight;
+        for (std::size_t row = 0; row < depth; row++) {
+            counters[slots[row]] = std::max(counters[slots[row]], estimate);
+        }
+        return estimate;
+    }
+
+    int64_t CountMinSketch::estimate(uint64_t hash) const {
+        int64_t estimate = counters[slot(hash, 0)];
+        for (std::size_t row = 1; row < depth; row++) {
+            estimate = std::min(estimate, counters[slot(hash, row)]);
+        }
+        return estimate;
+    }
+
+    void CountMinSketch::decay(int shift) {
+        for (int64_t& counter : counters) {
+            counter >>= shift;
+        }
+    }
+
+    void HeavyHitters::Candidates::offer(const std::string& key, int64_t estimate, std::size_t capacity) {
+        auto it = counts.find(key);
+        if (it != counts.end()) {
+            it->second = estimate;
+            return;
+        }
+        if (counts.size() < capacity) {
+            counts.emplace(key, estimate);
+            floor = counts.size() == 1 ? estimate : std::min(floor, estimate);
+            return;
+        }
+        if (estimate <= floor) {
+            return;
+        }
+        // Evict the lightest candidate if this key is now heavier.
+        auto lightest = std::min_element(counts.begin(), counts.end(),
+            [](const auto& a, const auto& b) { return a.second < b.second; });
+        if (estimate > lightest->second) {
+            counts.erase(lightest);
+            counts.emplace(key, estimate);
+        }
+        floor = std::min_element(counts.begin(), counts.end(),
+            [](const auto& a, const auto& b) { return a.second < b.second; })->second;
+    }
+
+    HeavyHitters::HeavyHitters(HeavyHitterConfig config) : config(config),
+        message_sketch(config.WIDTH, config.DEPTH), byte_sketch(config.WIDTH, config.DEPTH),
+        total_messages(0), total_bytes(0), records(0), last_decay(std::chrono::steady_clock::now()) {}
+
+    void HeavyHitters::record(const std::string& key, int64_t bytes) {
+        if (!config.ENABLED) {
+            return;
+        }
+        // Check the clock only every so often, as it costs more than the update.
+        if (++records % HEAVY_HITTER_CLOCK_INTERVAL == 0) {
+            decay(std::chrono::steady_clock::now());
+        }
+        uint64_t hash = std::hash<std::string>()(key);
+        std::size_t capacity = static_cast<std::size_t>(std::max(config.TOP_K, 1));
+        message_candidates.offer(key, message_sketch.add(hash, 1), capacity);
+        byte_candidates.offer(key, byte_sketch.add(hash, bytes), capacity);
+        total_messages++;
+        total_bytes += bytes;
+    }
+
+    std::vector<HeavyHitters::Entry> HeavyHitters::top(bool by_bytes) const {
+        std::vector<Entry> entries;
+        for (const auto& [key, count] : (by_bytes ? byte_candidates : message_candidates).counts) {
+            uint64_t hash = std::hash<std::string>()(key);
+            entries.push_back({key, message_sketch.estimate(hash), byte_sketch.estimate(hash)});
+        }
+        std::sort(entries.begin(), entries.end(), [by_bytes](const Entry& a, const Entry& b) {
+            return by_bytes ? a.bytes > b.bytes : a.messages > b.messages;
+        });
+        return entries;
+    }
+
+    void HeavyHitters::decay(std::chrono::steady_clock::time_point now) {
+        if (config.HALF_LIFE_SECONDS <= 0) {
+            return;
+        }
+        auto half_life = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(config.HALF_LIFE_SECONDS));
+        if (now - last_decay < half_life) {
+            return;
+        }
+        int64_t periods = (now - last_decay) / half_life;
+        last_decay += periods * half_life;
+        int shift = static_cast<int>(std::min<int64_t>(periods, 62));
+        message_sketch.decay(shift);
+        byte_sketch.decay(shift);
+        for (Candidates* candidates : {&message_candidates, &byte_candidates}) {
+            for (auto& [key, count] : candidates->counts) {
+                count >>= shift;
+            }
+            candidates->floor >>= shift;
+        }
+        total_messages >>= shift;
+        total_bytes >>= shift;
+    }
+}
@@ -0,0 +1,141 @@
+// nsb_metrics.cc
+
+#include "nsb_metrics.h"
+
+#include <cmath>
+#include <limits>
+
+namespace nsb {
+
+    int LatencyHistogram::bucket(int64_t nanoseconds) {
+        uint64_t value = static_cast<uint64_t>(std::max<int64_t>(nanoseconds, 0));
+        if (value < SUB_BUCKETS) {
+            return static_cast<int>(value);
+        }
+        // Bucket by the highest set bit, then by the next SUB_BUCKET_BITS bits.
+        int exponent = 63 - __builtin_clzll(value);
+        int sub_bucket = static_cast<int>((value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+    }
+
+    int64_t LatencyHistogram::lowerBound(int bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+        int exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+        int64_t sub_bucket = bucket % SUB_BUCKETS;
+        return (SUB_BUCKETS + sub_bucket) << (exponent - SUB_BUCKET_BITS);
+    }
+
+    void LatencyHistogram::record(int64_t nanoseconds) {
+        nanoseconds = std::max<int64_t>(nanoseconds, 0);
+        counts[bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+        int64_t low = min_ns.load(std::memory_order_relaxed);
+        while (nanoseconds < low && !min_ns.compare_exchange_weak(low, nanoseconds, std::memory_order_relaxed)) {}
+        int64_t high = max_ns.load(std::memory_order_relaxed);
+        while (nanoseconds > high && !max_ns.compare_exchange_weak(high, nanoseconds, std::memory_order_relaxed)) {}
+    }
+
+    int64_t LatencyHistogram::min() const {
+        int64_t low = min_ns.load(std::memory_order_relaxed);
+        return low == std::numeric_limits<int64_t>::max() ? 0 : low;
+    }
+
+    int64_t LatencyHistogram::percentile(double quantile) const {
+        int64_t recorded = count();
+        if (recorded == 0) {
+            return 0;
+        }
+        // Find the bucket holding the rank, and report its midpoint.
+        int64_t rank = std::max<int64_t>(1, static_cast<int64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * recorded)));
+        int64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                int64_t low = lowerBound(i);
+                int64_t high = (i + 1 < BUCKETS) ? lowerBound(i + 1) - 1 : low;
+                return std::clamp(low + (high - low) / 2, min(), max());
+            }
+        }
+        return max();
+    }
+
+    void LatencyHistogram::reset() {
+        for (std::atomic<int64_t>& count : counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        total.store(0, std::memory_order_relaxed);
+        sum_ns.store(0, std::memory_order_relaxed);
+        min_ns.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+        max_ns.store(0, std::memory_order_relaxed);
+    }
+
+    std::string ClientMetrics::metricName(ClientMetric metric) {
+        switch (metric) {
+            case ClientMetric::SEND:          return "send";
+            case ClientMetric::RECEIVE:       return "receive";
+            case ClientMetric::RECEIVE_BATCH: return "receive_batch";
+            case ClientMetric::FETCH:         return "fetch";
+            case ClientMetric::FETCH_BATCH:   return "fetch_batch";
+            case ClientMetric::POST:          return "post";
+            case ClientMetric::POST_BATCH:    return "post_batch";
+            case ClientMetric::SERIALIZE:     return "serialize";
+            case ClientMetric::PARSE:         return "parse";
+            case ClientMetric::SOCKET_WRITE:  return "socket_write";
+            case ClientMetric::DAEMON_RTT:    return "daemon_rtt";
+            case ClientMetric::DB_STORE:      return "db_store";
+            case ClientMetric::DB_CHECKOUT:   return "db_checkout";
+            default:                          return "unknown";
+        }
+    }
+
+    void ClientMetrics::record(ClientMetric metric, std::chrono::steady_clock::duration elapsed, Outcome outcome) {
+        Counters& c = counters[static_cast<std::size_t>(metric)];
+        c.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        switch (outcome) {
+            case Outcome::ERROR:   c.errors.fetch_add(1, std::memory_order_relaxed); break;
+            case Outcome::TIMEOUT: c.timeouts.fetch_add(1, std::memory_order_relaxed); break;
+            case Outcome::EMPTY:   c.empty.fetch_add(1, std::memory_order_relaxed); break;
+            default: break;
+        }
+    }
+
+    ClientMetrics::Snapshot ClientMetrics::snapshot(ClientMetric metric) const {
+        const Counters& c = counters[static_cast<std::size_t>(metric)];
+        Snapshot snap;
+        snap.name = metricName(metric);
+        snap.count = c.latency.count();
+        snap.errors = c.errors.load(std::memory_order_relaxed);
+        snap.timeouts = c.timeouts.load(std::memory_order_relaxed);
+        snap.empty = c.empty.load(std::memory_order_relaxed);
+        snap.total_ns = c.latency.sum();
+        snap.min_ns = c.latency.min();
+        snap.max_ns = c.latency.max();
+        snap.p50_ns = c.latency.percentile(0.5);
+        snap.p90_ns = c.latency.percentile(0.9);
+        snap.p99_ns = c.latency.percentile(0.99);
+        snap.p999_ns = c.latency.percentile(0.999);
+        return snap;
+    }
+
+    std::vector<ClientMetrics::Snapshot> ClientMetrics::snapshots() const {
+        std::vector<Snapshot> snaps;
+        for (int i = 0; i < static_cast<int>(ClientMetric::COUNT); i++) {
+            if (counters[i].latency.count() > 0) {
+                snaps.push_back(snapshot(static_cast<ClientMetric>(i)));
+            }
+        }
+        return snaps;
+    }
+
+    void ClientMetrics::reset() {
+        for (Counters& c : counters) {
+            c.latency.reset();
+            c.errors.store(0, std::memory_order_relaxed);
+            c.timeouts.store(0, std::memory_order_relaxed);
+            c.empty.store(0, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,315 @@
+// nsb_profiler.cc
+
+#include "nsb_profiler.h"
+
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+#include <cxxabi.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <poll.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace nsb {
+
+    namespace {
+        /** @brief Pages in each ring buffer of samples (a power of two). */
+        const std::size_t PROFILER_RING_PAGES = 64;
+        /** @brief How often the collector drains the ring buffers. */
+        const std::chrono::milliseconds PROFILER_DRAIN_INTERVAL(50);
+
+        /** @brief Gets a thread's name, or its ID if it has none. */
+        std::string threadName(pid_t tid) {
+            std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+            std::string name;
+            if (!std::getline(comm, name) || name.empty()) {
+                name = std::to_string(tid);
+            }
+            return name;
+        }
+
+        /** @brief Gets a readable name for a code address. */
+        std::string symbolize(uint64_t address) {
+            Dl_info info;
+            if (dladdr(reinterpret_cast<void*>(address), &info) == 0 || info.dli_fname == nullptr) {
+                std::ostringstream unknown;
+                unknown << "[unknown] 0x" << std::hex << address;
+                return unknown.str();
+            }
+            if (info.dli_sname != nullptr) {
+                int status = 0;
+                char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                std::string name = (status == 0 && demangled != nullptr) ? demangled : info.dli_sname;
+                std::free(demangled);
+                return name;
+            }
+            // Fall back to the module and offset, e.g. for static functions.
+            const char* module = std::strrchr(info.dli_fname, '/');
+            module = module ? module + 1 : info.dli_fname;
+            std::ostringstream offset;
+            offset << module << "+0x" << std::hex << (address - reinterpret_cast<uint64_t>(info.dli_fbase));
+            return offset.str();
+        }
+    }
+
+    std::size_t SamplingProfiler::StackHash::operator()(const Stack& stack) const {
+        std::size_t hash = std::hash<std::string>()(stack.thread);
+        for (uint64_t frame : stack.frames) {
+            hash ^= std::hash<uint64_t>()(frame) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+
+    SamplingProfiler::SamplingProfiler(ProfilerConfig config) : config(std::move(config)), running(false),
+        stopping(false), lost_samples(0) {}
+
+    SamplingProfiler::~SamplingProfiler() {
+        stop();
+    }
+
+#if defined(__linux__)
+    std::string SamplingProfiler::start(int duration_ms, int frequency_hz, const std::string& name) {
+        if (running) {
+            LOG(WARNING) << "A profile is already in progress." << std::endl;
+            return "";
+        }
+        // Only write within the configured directory.
+        if (name.find('/') != std::string::npos || name.find("..") != std::string::npos) {
+            LOG(WARNING) << "Refusing to write a profile to " << name << "." << std::endl;
+            return "";
+        }
+        // Clean up after the previous profile.
+        if (collector.joinable()) {
+            collector.join();
+        }
+        duration_ms = std::clamp(duration_ms > 0 ? duration_ms : config.DURATION_MS, 1, PROFILER_MAX_DURATION_MS);
+        frequency_hz = std::clamp(frequency_hz > 0 ? frequency_hz : config.FREQUENCY_HZ, 1, PROFILER_MAX_FREQUENCY_HZ);
+        std::string out_path = config.DIRECTORY + "/" + name;
+        if (name.empty()) {
+            std::time_t now = std::time(nullptr);
+            std::tm local{};
+            localtime_r(&now, &local);
+            char stamp[32];
+            std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+            out_path = config.DIRECTORY + "/nsb_profile." + std::to_string(getpid()) + "." + stamp + ".folded";
+        }
+        samples.clear();
+        thread_names.clear();
+        lost_samples = 0;
+        // Open a sampling event on every thread of the process.
+        DIR* tasks = opendir("/proc/self/task");
+        if (tasks == nullptr) {
+            LOG(ERROR) << "Failed to list threads: " << strerror(errno) << std::endl;
+            return "";
+        }
+        while (dirent* task = readdir(tasks)) {
+            if (task->d_name[0] == '.') {
+                continue;
+            }
+            pid_t tid = static_cast<pid_t>(std::atoi(task->d_name));
+            if (open(tid, frequency_hz)) {
+                thread_names[tid] = threadName(tid);
+            }
+        }
+        closedir(tasks);
+        if (streams.empty()) {
+            LOG(ERROR) << "Failed to start profiling: " << strerror(errno)
+                       << " (check kernel.perf_event_paranoid)." << std::endl;
+            return "";
+        }
+        for (const Stream& stream : streams) {
+            ioctl(stream.fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        LOG(INFO) << "Profiling " << streams.size() << " thread(s) at " << frequency_hz << " Hz for "
+                  << duration_ms << " ms into " << out_path << std::endl;
+        running = true;
+        stopping = false;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(duration_ms);
+        collector = std::thread(&SamplingProfiler::collect, this, deadline, out_path);
+        return out_path;
+    }
+
+    bool SamplingProfiler::open(pid_t tid, int frequency_hz) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_CPU_CLOCK;
+        attr.freq = 1;
+        attr.sample_freq = static_cast<uint64_t>(frequency_hz);
+        attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+        attr.sample_max_stack = PROFILER_MAX_STACK_DEPTH;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        if (fd < 0) {
+            DLOG(WARNING) << "Could not open a sampling event on thread " << tid << ": "
+                          << strerror(errno) << std::endl;
+            return false;
+        }
+        std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        std::size_t ring_size = (PROFILER_RING_PAGES + 1) * page_size;
+        void* ring = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ring == MAP_FAILED) {
+            DLOG(WARNING) << "Could not map the ring buffer of thread " << tid << ": "
+                          << strerror(errno) << std::endl;
+            ::close(fd);
+            return false;
+        }
+        streams.push_back({fd, tid, ring, ring_size});
+        return true;
+    }
+
+    void SamplingProfiler::close() {
+        for (Stream& stream : streams) {
+            munmap(stream.ring, stream.ring_size);
+            ::close(stream.fd);
+        }
+        streams.clear();
+    }
+
+    void SamplingProfiler::collect(std::chrono::steady_clock::time_point deadline, std::string path) {
+        std::vector<pollfd> fds;
+        for (const Stream& stream : streams) {
+            fds.push_back({stream.fd, POLLIN, 0});
+        }
+        while (!stopping) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                break;
+            }
+            auto wait = std::min<std::chrono::steady_clock::duration>(deadline - now, PROFILER_DRAIN_INTERVAL);
+            poll(fds.data(), fds.size(), static_cast<int>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(wait).count()) + 1);
+            for (Stream& stream : streams) {
+                drain(stream);
+            }
+        }
+        for (Stream& stream : streams) {
+            ioctl(stream.fd, PERF_EVENT_IOC_DISABLE, 0);
+            drain(stream);
+        }
+        close();
+        write(path);
+        running = false;
+    }
+
+    void SamplingProfiler::drain(Stream& stream) {
+        std::size_t page_size = stream.ring_size / (PROFILER_RING_PAGES + 1);
+        perf_event_mmap_page* meta = static_cast<perf_event_mmap_page*>(stream.ring);
+        const char* data = static_cast<const char*>(stream.ring) + page_size;
+        std::size_t data_size = stream.ring_size - page_size;
+        uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+        uint64_t tail = meta->data_tail;
+        std::vector<char> record;
+        while (tail < head) {
+            // Copy the record out, as it may wrap around the end of the ring.
+            perf_event_header header;
+            for (std::size_t i = 0; i < sizeof(header); i++) {
+                reinterpret_cast<char*>(&header)[i] = data[(tail + i) % data_size];
+            }
+            if (header.size < sizeof(header) || tail + header.size > head) {
+                break;
+            }
+            record.resize(header.size);
+            for (std::size_t i = 0; i < header.size; i++) {
+                record[i] = data[(tail + i) % data_size];
+            }
+            tail += header.size;
+            const char* body = record.data() + sizeof(header);
+            if (header.type == PERF_RECORD_SAMPLE && header.size >= sizeof(header) + 16) {
+                // Laid out as { u32 pid, tid; u64 nr; u64 ips[nr]; }.
+                uint32_t tid;
+                uint64_t nr;
+                std::memcpy(&tid, body + 4, sizeof(tid));
+                std::memcpy(&nr, body + 8, sizeof(nr));
+                nr = std::min<uint64_t>(nr, (header.size - sizeof(header) - 16) / sizeof(uint64_t));
+                Stack stack;
+                auto name = thread_names.find(static_cast<pid_t>(tid));
+                stack.thread = name != thread_names.end() ? name->second : std::to_string(tid);
+                stack.frames.reserve(nr);
+                for (uint64_t i = 0; i < nr; i++) {
+                    uint64_t ip;
+                    std::memcpy(&ip, body + 16 + i * sizeof(ip), sizeof(ip));
+                    // Skip the markers separating kernel and user frames.
+                    if (ip < static_cast<uint64_t>(PERF_CONTEXT_MAX)) {
+                        stack.frames.push_back(ip);
+                    }
+                }
+                samples[std::move(stack)]++;
+            } else if (header.type == PERF_RECORD_LOST && header.size >= sizeof(header) + 16) {
+                // Laid out as { u64 id, lost; }.
+                uint64_t lost;
+                std::memcpy(&lost, body + 8, sizeof(lost));
+                lost_samples += static_cast<int64_t>(lost);
+            }
+        }
+        __atomic_store_n(&meta->data_tail, head, __ATOMIC_RELEASE);
+    }
+#else
+    std::string SamplingProfiler::start(int, int, const std::string&) {
+        LOG(ERROR) << "Profiling is only supported on Linux." << std::endl;
+        return "";
+    }
+
+    bool SamplingProfiler::open(pid_t, int) {
+        return false;
+    }
+
+    void SamplingProfiler::close() {}
+
+    void SamplingProfiler::collect(std::chrono::steady_clock::time_point, std::string) {}
+
+    void SamplingProfiler::drain(Stream&) {}
+#endif
+
+    void SamplingProfiler::stop() {
+        stopping = true;
+        if (collector.joinable()) {
+            collector.join();
+        }
+    }
+
+    bool SamplingProfiler::write(const std::string& path) {
+        // Symbolize each distinct address once, and merge stacks that only
+        // differ in addresses within the same functions.
+        std::unordered_map<uint64_t, std::string> symbols;
+        std::map<std::string, int64_t> folded;
+        int64_t total = 0;
+        for (const auto& [stack, count] : samples) {
+            std::string line = stack.thread;
+            for (auto it = stack.frames.rbegin(); it != stack.frames.rend(); ++it) {
+                // Callers' frames hold return addresses, which may belong to the next symbol.
+                uint64_t address = (it + 1 == stack.frames.rend()) ? *it : *it - 1;
+                auto symbol = symbols.find(address);
+                if (symbol == symbols.end()) {
+                    symbol = symbols.emplace(address, symbolize(address)).first;
+                }
+                line += ";" + symbol->second;
+            }
+            folded[line] += count;
+            total += count;
+        }
+        std::ofstream out(path);
+        for (const auto& [line, count] : folded) {
+            out << line << " " << count << "\n";
+        }
+        out.close();
+        if (!out) {
+            LOG(ERROR) << "Failed to write profile to " << path << std::endl;
+            return false;
+        }
+        LOG(INFO) << "Wrote profile of " << total << " samples (" << lost_samples << " lost) to "
+                  << path << std::endl;
+        return true;
+    }
+}
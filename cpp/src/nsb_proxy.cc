@@ -0,0 +1,372 @@
+// nsb_proxy.cc
+
+#include "nsb_proxy.h"
+
+#include <poll.h>
+
+namespace nsb {
+
+    NSBProxy::NSBProxy(std::string filename) : running(false), listen_fd(-1), link_fd(-1) {
+        GOOGLE_PROTOBUF_VERIFY_VERSION;
+        configure(filename);
+    }
+
+    NSBProxy::~NSBProxy() {
+        if (link_fd != -1) {
+            drop_link();
+        }
+        if (listen_fd != -1) {
+            close(listen_fd);
+            unlink(cfg.SOCKET_PATH.c_str());
+        }
+        google::protobuf::ShutdownProtobufLibrary();
+    }
+
+    void NSBProxy::configure(std::string filename) {
+        YAML::Node config = YAML::LoadFile(filename);
+        if (config.IsNull()) {
+            std::cerr << "Failed to load configuration file: " << filename << std::endl;
+            return;
+        }
+        cfg.DAEMON_ADDRESS = config["system"]["daemon_address"].as<std::string>(cfg.DAEMON_ADDRESS);
+        cfg.DAEMON_PORT = config["system"]["daemon_port"].as<int>(cfg.DAEMON_PORT);
+        // Parse the optional proxy section.
+        if (config["proxy"]) {
+            YAML::Node p = config["proxy"];
+            cfg.SOCKET_PATH = p["socket"].as<std::string>(cfg.SOCKET_PATH);
+            cfg.COMPRESS = p["compress"].as<bool>(cfg.COMPRESS);
+        }
+        LOG(INFO) << "Proxy configured: " << cfg.SOCKET_PATH << " -> " << cfg.DAEMON_ADDRESS << ":"
+                  << cfg.DAEMON_PORT << (cfg.COMPRESS ? " (compressed)" : "") << std::endl;
+    }
+
+    void NSBProxy::start() {
+        if (running || !open_listener()) {
+            return;
+        }
+        running = true;
+        LOG(INFO) << "NSBProxy started." << std::endl;
+        int backoff_ms = RECONNECT_INITIAL_BACKOFF_MS;
+        while (running) {
+            // Keep a link to the daemon before taking in any clients.
+            if (link_fd == -1) {
+                if (!connect_daemon()) {
+                    LOG(WARNING) << "Retrying daemon link in " << backoff_ms << " ms..." << std::endl;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+                    backoff_ms = std::min(backoff_ms * 2, PROXY_MAX_BACKOFF_MS);
+                    continue;
+                }
+                backoff_ms = RECONNECT_INITIAL_BACKOFF_MS;
+            }
+            // Watch the listener, the link, every channel that is not paused, and those with output queued.
+            auto now = std::chrono::steady_clock::now();
+            auto wake_at = now + std::chrono::milliseconds(100);
+            std::vector<pollfd> poll_fds;
+            poll_fds.reserve(channels.size() + 2);
+            poll_fds.push_back(pollfd{listen_fd, POLLIN, 0});
+            poll_fds.push_back(pollfd{link_fd, POLLIN, 0});
+            for (const auto& [fd, channel] : channels) {
+                short events = channel.pending.empty() ? 0 : POLLOUT;
+                if (channel.paused_until > now) {
+                    wake_at = std::min(wake_at, channel.paused_until);
+                } else {
+                    events |= POLLIN;
+                }
+                if (events != 0) {
+                    poll_fds.push_back(pollfd{fd, events, 0});
+                }
+            }
+            auto wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(wake_at - now).count();
+            if (poll(poll_fds.data(), poll_fds.size(), static_cast<int>(wait_ms)) < 0) {
+                if (errno != EINTR) {
+                    LOG(ERROR) << "Poll failed: " << strerror(errno) << std::endl;
+                    break;
+                }
+                continue;
+            }
+            if (poll_fds[1].revents != 0 && !read_link()) {
+                drop_link();
+                continue;
+            }
+            if (poll_fds[0].revents & POLLIN) {
+                accept_channels();
+            }
+            // Read every channel that is ready before sending anything, so that one envelope carries them all.
+            for (std::size_t i = 2; i < poll_fds.size(); i++) {
+                const pollfd& ready = poll_fds[i];
+                if (ready.revents == 0 || !channels.count(ready.fd)) {
+                    continue;
+                }
+                if (ready.revents & POLLOUT) {
+                    write_channel(ready.fd, std::string());
+                }
+                if (channels.count(ready.fd) && (ready.revents & (POLLIN | POLLHUP | POLLERR))) {
+                    read_channel(ready.fd);
+                }
+            }
+            if (!flush()) {
+                drop_link();
+            }
+        }
+        running = false;
+    }
+
+    void NSBProxy::stop() {
+        if (running) {
+            running = false;
+            LOG(INFO) << "NSBProxy stopped." << std::endl;
+        }
+    }
+
+    bool NSBProxy::is_running() const {
+        return running;
+    }
+
+    bool NSBProxy::open_listener() {
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd == -1) {
+            LOG(ERROR) << "Proxy socket creation failed." << std::endl;
+            return false;
+        }
+        sockaddr_un listen_addr{};
+        listen_addr.sun_family = AF_UNIX;
+        if (cfg.SOCKET_PATH.size() >= sizeof(listen_addr.sun_path)) {
+            LOG(ERROR) << "Proxy socket path is too long: " << cfg.SOCKET_PATH << std::endl;
+            close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        cfg.SOCKET_PATH.copy(listen_addr.sun_path, sizeof(listen_addr.sun_path) - 1);
+        // Replace the socket left behind by an earlier proxy.
+        unlink(cfg.SOCKET_PATH.c_str());
+        int flags = fcntl(listen_fd, F_GETFL, 0);
+        if (bind(listen_fd, (struct sockaddr*)&listen_addr, sizeof(listen_addr)) == -1 ||
+            listen(listen_fd, SOMAXCONN) == -1 || flags == -1 || fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+            LOG(ERROR) << "Could not listen on " << cfg.SOCKET_PATH << ": " << strerror(errno) << std::endl;
+            close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        LOG(INFO) << "Listening for local clients on " << cfg.SOCKET_PATH << "." << std::endl;
+        return true;
+    }
+
+    bool NSBProxy::connect_daemon() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd == -1) {
+            LOG(ERROR) << "Link socket creation failed." << std::endl;
+            return false;
+        }
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        sockaddr_in daemon_addr{};
+        daemon_addr.sin_family = AF_INET;
+        daemon_addr.sin_addr.s_addr = inet_addr(cfg.DAEMON_ADDRESS.c_str());
+        daemon_addr.sin_port = htons(cfg.DAEMON_PORT);
+        if (connect(fd, (struct sockaddr*)&daemon_addr, sizeof(daemon_addr)) == -1) {
+            close(fd);
+            return false;
+        }
+        // Ask the daemon to treat this connection as a link.
+        nsb::nsbm hello;
+        nsb::nsbm::Manifest* manifest = hello.mutable_manifest();
+        manifest->set_op(nsb::nsbm::Manifest::RELAY);
+        manifest->set_og(nsb::nsbm::Manifest::PROXY);
+        manifest->set_code(nsb::nsbm::Manifest::CLIENT_REQUEST);
+        hello.mutable_relay()->set_compress(cfg.COMPRESS);
+        std::string data = hello.SerializeAsString();
+        nsb::nsbm response;
+        char buffer[PROXY_BUFFER_SIZE];
+        pollfd readable{fd, POLLIN, 0};
+        int bytes_read = -1;
+        if (send(fd, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(data.size()) &&
+            poll(&readable, 1, PROXY_HELLO_TIMEOUT_MS) > 0) {
+            bytes_read = recv(fd, buffer, sizeof(buffer), 0);
+        }
+        if (bytes_read <= 0 || !response.ParseFromArray(buffer, bytes_read) ||
+            response.manifest().op() != nsb::nsbm::Manifest::RELAY ||
+            response.manifest().code() != nsb::nsbm::Manifest::SUCCESS) {
+            LOG(ERROR) << "Daemon refused the link." << std::endl;
+            close(fd);
+            return false;
+        }
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+            LOG(ERROR) << "Set link socket flags failed." << std::endl;
+            close(fd);
+            return false;
+        }
+        link_fd = fd;
+        reader = RelayReader();
+        outgoing.Clear();
+        LOG(INFO) << "Linked to daemon at " << cfg.DAEMON_ADDRESS << ":" << cfg.DAEMON_PORT << "." << std::endl;
+        return true;
+    }
+
+    void NSBProxy::drop_link() {
+        LOG(WARNING) << "Lost the daemon link, closing " << channels.size() << " local channel(s)." << std::endl;
+        // Clients reconnect (and resume their sessions) once the link is back.
+        while (!channels.empty()) {
+            close_channel(channels.begin()->first, false);
+        }
+        shutdown(link_fd, SHUT_RDWR);
+        close(link_fd);
+        link_fd = -1;
+    }
+
+    void NSBProxy::accept_channels() {
+        while (true) {
+            sockaddr_un peer_addr{};
+            socklen_t peer_len = sizeof(peer_addr);
+            int fd = accept(listen_fd, (struct sockaddr*)&peer_addr, &peer_len);
+            if (fd == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    LOG(ERROR) << "Accept failed: " << strerror(errno) << std::endl;
+                }
+                return;
+            }
+            // Channels are known by the abstract addresses that clients advertise in place of ports.
+            int id = SocketInterface::localChannelId(peer_addr, peer_len);
+            int flags = fcntl(fd, F_GETFL, 0);
+            if (id == -1 || channel_fds.count(id) || flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+                LOG(WARNING) << "Refusing local channel without a usable address." << std::endl;
+                close(fd);
+                continue;
+            }
+            channels[fd] = LocalChannel{static_cast<uint32_t>(id), {}, {}};
+            channel_fds[id] = fd;
+            DLOG(INFO) << "Accepted local channel " << id << " on FD " << fd << "." << std::endl;
+        }
+    }
+
+    void NSBProxy::read_channel(int fd) {
+        // Whatever one burst of reads returns is one message, as the daemon sees its own channels.
+        std::string data;
+        char buffer[PROXY_BUFFER_SIZE];
+        int bytes_read;
+        while ((bytes_read = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            data.append(buffer, bytes_read);
+        }
+        bool closed = (bytes_read == 0) || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+        if (!data.empty()) {
+            nsb::nsbm::Relay::Frame* frame = outgoing.add_frames();
+            frame->set_channel(channels.at(fd).id);
+            frame->set_data(std::move(data));
+        }
+        if (closed) {
+            close_channel(fd, true);
+        }
+    }
+
+    void NSBProxy::write_channel(int fd, const std::string& data) {
+        LocalChannel& channel = channels.at(fd);
+        channel.pending.append(data);
+        std::size_t sent = 0;
+        while (sent < channel.pending.size()) {
+            ssize_t bytes_sent = send(fd, channel.pending.data() + sent, channel.pending.size() - sent,
+                                      MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (bytes_sent >= 0) {
+                sent += bytes_sent;
+            } else if (errno != EINTR) {
+                break;
+            }
+        }
+        channel.pending.erase(0, sent);
+        // Leave the rest for when the channel is writable, unless it has failed or fallen too far behind.
+        bool failed = !channel.pending.empty() && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+        if (failed || channel.pending.size() > PROXY_MAX_PENDING_BYTES) {
+            LOG(WARNING) << "Could not write to local channel " << channel.id << "." << std::endl;
+            close_channel(fd, true);
+        }
+    }
+
+    void NSBProxy::close_channel(int fd, bool notify) {
+        auto channel = channels.find(fd);
+        if (channel == channels.end()) {
+            return;
+        }
+        DLOG(INFO) << "Closing local channel " << channel->second.id << "." << std::endl;
+        if (notify) {
+            nsb::nsbm::Relay::Frame* frame = outgoing.add_frames();
+            frame->set_channel(channel->second.id);
+            frame->set_closed(true);
+        }
+        channel_fds.erase(channel->second.id);
+        channels.erase(channel);
+        close(fd);
+    }
+
+    bool NSBProxy::read_link() {
+        char buffer[PROXY_BUFFER_SIZE];
+        int bytes_read;
+        while ((bytes_read = recv(link_fd, buffer, sizeof(buffer), 0)) > 0) {
+            reader.append(buffer, bytes_read);
+        }
+        if (bytes_read == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            return false;
+        }
+        nsb::nsbm::Relay relay;
+        int status;
+        while ((status = reader.next(&relay)) > 0) {
+            auto now = std::chrono::steady_clock::now();
+            for (const nsb::nsbm::Relay::Frame& frame : relay.frames()) {
+                auto target = channel_fds.find(frame.channel());
+                if (target == channel_fds.end()) {
+                    continue;
+                }
+                int fd = target->second;
+                if (frame.pause_us() > 0) {
+                    channels.at(fd).paused_until = now + std::chrono::microseconds(frame.pause_us());
+                }
+                if (!frame.data().empty()) {
+                    write_channel(fd, frame.data());
+                }
+            }
+            relay.Clear();
+        }
+        if (status < 0) {
+            LOG(ERROR) << "Daemon sent a malformed envelope." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool NSBProxy::flush() {
+        if (outgoing.frames_size() == 0) {
+            return true;
+        }
+        std::string envelope;
+        packRelay(outgoing, cfg.COMPRESS, &envelope);
+        DLOG(INFO) << "Relaying " << outgoing.frames_size() << " frame(s) in " << envelope.size() << " B." << std::endl;
+        outgoing.Clear();
+        return sendAll(link_fd, envelope.data(), envelope.size(), RELAY_SEND_TIMEOUT_MS) == 0;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace nsb;
+    // Set up logging.
+    NsbLogSink log_output = NsbLogSink();
+    absl::InitializeLog();
+    absl::log_internal::AddLogSink(&log_output);
+    // Check argument.
+    if (argc != 2) {
+        LOG(ERROR) << "Usage: " << argv[0] << " <config_file>" << std::endl;
+        return 1;
+    }
+    // Check if the provided config file exists.
+    if (access(argv[1], F_OK) == -1) {
+        LOG(ERROR) << "Configuration file does not exist: " << argv[1] << std::endl;
+        return 1;
+    }
+    // Start proxy.
+    LOG(INFO) << "Starting proxy...\n";
+    NSBProxy proxy = NSBProxy(argv[1]);
+    proxy.start();
+    proxy.stop();
+    LOG(INFO) << "Exit.";
+    return 0;
+}
@@ -0,0 +1,452 @@
+// nsb_queue.cc
+
+#include "nsb_queue.h"
+
+namespace nsb {
+
+    /* QueueBackend */
+
+    std::unique_ptr<QueueBackend> QueueBackend::create(const QueueConfig& config, const std::string& name,
+                                                       std::string MessageEntry::* field) {
+        if (config.BACKEND == QueueConfig::Backend::REDIS_STREAMS) {
+            auto queue = std::make_unique<RedisStreamQueue>(config, name, field);
+            if (queue->isConnected()) {
+                return queue;
+            }
+            LOG(WARNING) << "Redis Streams unavailable for the " << name
+                         << " buffer; keeping it in memory instead." << std::endl;
+        }
+        return std::make_unique<MemoryQueue>(field);
+    }
+
+    /* MemoryQueue */
+
+    MemoryQueue::~MemoryQueue() {
+        for (const MessageEntry& entry : entries) {
+            MemoryAccounting::release(MemoryTag::PAYLOAD, entry.payload_obj.size());
+        }
+    }
+
+    void MemoryQueue::push(MessageEntry entry, bool front) {
+        MemoryAccounting::record(MemoryTag::PAYLOAD, entry.payload_obj.size());
+        entry.timestamp = std::chrono::steady_clock::now();
+        if (front) {
+            entries.push_front(std::move(entry));
+        } else {
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    std::vector<MessageEntry> MemoryQueue::take(const std::string& key, int max) {
+        std::vector<MessageEntry> taken;
+        for (auto it = entries.begin(); it != entries.end() && (max < 0 || (int)taken.size() < max);) {
+            if (!matches(*it, key)) {
+                ++it;
+                continue;
+            }
+            MemoryAccounting::release(MemoryTag::PAYLOAD, it->payload_obj.size());
+            taken.push_back(std::move(*it));
+            it = entries.erase(it);
+        }
+        return taken;
+    }
+
+    QueueBackend::Depth MemoryQueue::depth(const std::string& key) {
+        // The first entry found is the oldest.
+        Depth depth;
+        for (const MessageEntry& entry : entries) {
+            if (matches(entry, key)) {
+                if (depth.count == 0) {
+                    depth.oldest = entry.timestamp;
+                }
+                depth.count++;
+                depth.bytes += entry.payload_size;
+            }
+        }
+        return depth;
+    }
+
+    std::vector<std::string> MemoryQueue::peekPayloads(const std::string& key, int max) {
+        std::vector<std::string> payloads;
+        for (auto it = entries.begin(); it != entries.end() && (int)payloads.size() < max; ++it) {
+            if (matches(*it, key)) {
+                payloads.push_back(it->payload_obj);
+            }
+        }
+        return payloads;
+    }
+
+    /* RedisStreamQueue */
+
+    namespace {
+        /** @brief The consumer group shared by all daemons. */
+        const std::string STREAM_GROUP = "nsb";
+
+        /** @brief Gets the milliseconds part of a stream ID. */
+        int64_t streamIdMillis(const std::string& id) {
+            return std::strtoll(id.c_str(), nullptr, 10);
+        }
+
+        /** @brief Orders stream IDs ("<ms>-<seq>") chronologically. */
+        bool streamIdLess(const std::string& a, const std::string& b) {
+            int64_t a_ms = streamIdMillis(a), b_ms = streamIdMillis(b);
+            if (a_ms != b_ms) {
+                return a_ms < b_ms;
+            }
+            std::size_t a_dash = a.find('-'), b_dash = b.find('-');
+            int64_t a_seq = a_dash == std::string::npos ? 0 : std::strtoll(a.c_str() + a_dash + 1, nullptr, 10);
+            int64_t b_seq = b_dash == std::string::npos ? 0 : std::strtoll(b.c_str() + b_dash + 1, nullptr, 10);
+            return a_seq < b_seq;
+        }
+
+        /** @brief Converts the time in a stream ID to the steady clock. */
+        std::chrono::steady_clock::time_point streamIdTime(const std::string& id) {
+            auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            auto age = std::chrono::milliseconds(std::max<int64_t>(0, now_ms - streamIdMillis(id)));
+            return std::chrono::steady_clock::now() - age;
+        }
+
+        std::string replyString(const redisReply* reply) {
+            return (reply && reply->str) ? std::string(reply->str, reply->len) : std::string();
+        }
+    }
+
+    RedisStreamQueue::RedisStreamQueue(const QueueConfig& config, const std::string& name,
+                                       std::string MessageEntry::* field) :
+        QueueBackend(field), prefix(config.NAMESPACE + ":" + name + ":"), consumer(config.CONSUMER) {
+        context = redisConnect(config.REDIS_ADDRESS.c_str(), config.REDIS_PORT);
+        if (context == nullptr || context->err) {
+            LOG(ERROR) << config.REDIS_ADDRESS << ":" << config.REDIS_PORT << ": "
+                       << (context ? context->errstr : "allocation failed") << std::endl;
+            return;
+        }
+        // Recover entries this consumer read but never acknowledged.
+        std::vector<std::string> streams;
+        for (const std::string& key : keysFor("")) {
+            streams.push_back(streamOf(key));
+        }
+        for (Held& pending : readGroup(streams, "0", -1)) {
+            held.push_back(std::move(pending));
+        }
+        LOG(INFO) << "RedisStreamQueue " << prefix << " initialized with " << keys.size()
+                  << " stream(s) and " << held.size() << " recovered entry(s)." << std::endl;
+    }
+
+    RedisStreamQueue::~RedisStreamQueue() {
+        if (context) {
+            redisFree(context);
+            context = nullptr;
+        }
+    }
+
+    bool RedisStreamQueue::isConnected() const {
+        return context != nullptr && context->err == REDIS_OK;
+    }
+
+    void RedisStreamQueue::append(const std::vector<std::string>& args) {
+        std::vector<const char*> argv;
+        std::vector<std::size_t> argvlen;
+        for (const std::string& arg : args) {
+            argv.push_back(arg.data());
+            argvlen.push_back(arg.size());
+        }
+        redisAppendCommandArgv(context, argv.size(), argv.data(), argvlen.data());
+    }
+
+    RedisStreamQueue::Reply RedisStreamQueue::reply() {
+        void* r = nullptr;
+        if (!isConnected() || redisGetReply(context, &r) != REDIS_OK) {
+            r = nullptr;
+        }
+        return Reply(static_cast<redisReply*>(r), freeReplyObject);
+    }
+
+    RedisStreamQueue::Reply RedisStreamQueue::command(const std::vector<std::string>& args) {
+        append(args);
+        return reply();
+    }
+
+    void RedisStreamQueue::ensureGroup(const std::string& stream) {
+        if (grouped.count(stream)) {
+            return;
+        }
+        // Start the group at the beginning of the stream; BUSYGROUP means it exists already.
+        Reply r = command({"XGROUP", "CREATE", stream, STREAM_GROUP, "0", "MKSTREAM"});
+        if (r && (r->type != REDIS_REPLY_ERROR || replyString(r.get()).rfind("BUSYGROUP", 0) == 0)) {
+            grouped.insert(stream);
+        } else {
+            LOG(ERROR) << "Failed to create consumer group for " << stream << ": "
+                       << replyString(r.get()) << std::endl;
+        }
+    }
+
+    std::vector<std::string> RedisStreamQueue::keysFor(const std::string& key) {
+        if (!key.empty()) {
+            keys.insert(key);
+            return {key};
+        }
+        // Other daemons may have added streams since.
+        Reply r = command({"SMEMBERS", prefix + "keys"});
+        if (r && r->type == REDIS_REPLY_ARRAY) {
+            for (std::size_t i = 0; i < r->elements; i++) {
+                keys.insert(replyString(r->element[i]));
+            }
+        }
+        return std::vector<std::string>(keys.begin(), keys.end());
+    }
+
+    std::vector<RedisStreamQueue::Held> RedisStreamQueue::readGroup(const std::vector<std::string>& streams,
+                                                                    const std::string& id, int count) {
+        std::vector<Held> read;
+        if (streams.empty() || !isConnected()) {
+            return read;
+        }
+        for (const std::string& stream : streams) {
+            ensureGroup(stream);
+        }
+        std::vector<std::string> args = {"XREADGROUP", "GROUP", STREAM_GROUP, consumer};
+        if (count >= 0) {
+            args.insert(args.end(), {"COUNT", std::to_string(count)});
+        }
+        args.push_back("STREAMS");
+        args.insert(args.end(), streams.begin(), streams.end());
+        args.insert(args.end(), streams.size(), id);
+        Reply r = command(args);
+        if (!r || r->type != REDIS_REPLY_ARRAY) {
+            if (r && r->type == REDIS_REPLY_ERROR) {
+                LOG(ERROR) << "XREADGROUP failed: " << replyString(r.get()) << std::endl;
+            }
+            return read;
+        }
+        // Each element is [stream, [[id, [field, value, ...]], ...]].
+        for (std::size_t s = 0; s < r->elements; s++) {
+            const redisReply* stream = r->element[s];
+            if (stream->type != REDIS_REPLY_ARRAY || stream->elements != 2) {
+                continue;
+            }
+            std::string name = replyString(stream->element[0]);
+            const redisReply* entries = stream->element[1];
+            for (std::size_t e = 0; entries->type == REDIS_REPLY_ARRAY && e < entries->elements; e++) {
+                const redisReply* item = entries->element[e];
+                // Pending entries deleted in the meantime come back without fields.
+                if (item->type != REDIS_REPLY_ARRAY || item->elements != 2 ||
+                    item->element[1]->type != REDIS_REPLY_ARRAY) {
+                    continue;
+                }
+                Held held_entry{name, replyString(item->element[0]), MessageEntry()};
+                const redisReply* fields = item->element[1];
+                for (std::size_t f = 0; f + 1 < fields->elements; f += 2) {
+                    std::string field_name = replyString(fields->element[f]);
+                    std::string value = replyString(fields->element[f + 1]);
+                    if (field_name == "src") {
+                        held_entry.entry.source = std::move(value);
+                    } else if (field_name == "dest") {
+                        held_entry.entry.destination = std::move(value);
+                    } else if (field_name == "size") {
+                        held_entry.entry.payload_size = std::atoi(value.c_str());
+                    } else if (field_name == "payload") {
+                        held_entry.entry.payload_obj = std::move(value);
+                    } else if (field_name == "crc") {
+                        held_entry.entry.checksum = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+                    }
+                }
+                held_entry.entry.timestamp = streamIdTime(held_entry.id);
+                read.push_back(std::move(held_entry));
+            }
+        }
+        std::stable_sort(read.begin(), read.end(),
+                         [](const Held& a, const Held& b) { return streamIdLess(a.id, b.id); });
+        return read;
+    }
+
+    void RedisStreamQueue::acknowledge(const std::vector<Held>& taken) {
+        int appended = 0;
+        for (const Held& entry : taken) {
+            if (entry.id.empty()) {
+                continue;
+            }
+            append({"XACK", entry.stream, STREAM_GROUP, entry.id});
+            append({"XDEL", entry.stream, entry.id});
+            append({"HINCRBY", prefix + "bytes", entry.entry.*field, std::to_string(-entry.entry.payload_size)});
+            appended += 3;
+        }
+        for (int i = 0; i < appended; i++) {
+            reply();
+        }
+    }
+
+    void RedisStreamQueue::push(MessageEntry entry, bool front) {
+        entry.timestamp = std::chrono::steady_clock::now();
+        if (front) {
+            // Returned entries were already acknowledged; keep them ahead of the streams.
+            held.push_front({"", "", std::move(entry)});
+            return;
+        }
+        const std::string& key = entry.*field;
+        std::string stream = streamOf(key);
+        ensureGroup(stream);
+        keys.insert(key);
+        std::vector<std::string> xadd = {"XADD", stream, "*", "src", entry.source, "dest", entry.destination,
+                                         "size", std::to_string(entry.payload_size), "payload", entry.payload_obj};
+        if (entry.checksum) {
+            xadd.insert(xadd.end(), {"crc", std::to_string(*entry.checksum)});
+        }
+        append(xadd);
+        append({"SADD", prefix + "keys", key});
+        append({"HINCRBY", prefix + "bytes", key, std::to_string(entry.payload_size)});
+        Reply added = reply();
+        reply();
+        reply();
+        if (!added || added->type == REDIS_REPLY_ERROR) {
+            LOG(ERROR) << "Failed to queue entry in " << stream << ": " << replyString(added.get()) << std::endl;
+        }
+    }
+
+    std::vector<MessageEntry> RedisStreamQueue::take(const std::string& key, int max) {
+        std::vector<Held> taken;
+        // Entries held by the daemon come first.
+        for (auto it = held.begin(); it != held.end() && (max < 0 || (int)taken.size() < max);) {
+            if (!matches(it->entry, key)) {
+                ++it;
+                continue;
+            }
+            taken.push_back(std::move(*it));
+            it = held.erase(it);
+        }
+        int wanted = max < 0 ? -1 : max - (int)taken.size();
+        if (wanted != 0) {
+            std::vector<std::string> streams;
+            for (const std::string& k : keysFor(key)) {
+                streams.push_back(streamOf(k));
+            }
+            // Read up to the wanted number from each stream, keeping the
+            // oldest and holding on to the rest.
+            for (Held& read : readGroup(streams, ">", wanted)) {
+                if (wanted != 0) {
+                    taken.push_back(std::move(read));
+                    if (wanted > 0) {
+                        wanted--;
+                    }
+                } else {
+                    held.push_back(std::move(read));
+                }
+            }
+        }
+        acknowledge(taken);
+        std::vector<MessageEntry> entries;
+        entries.reserve(taken.size());
+        for (Held& entry : taken) {
+            entries.push_back(std::move(entry.entry));
+        }
+        return entries;
+    }
+
+    QueueBackend::Depth RedisStreamQueue::depth(const std::string& key) {
+        Depth depth;
+        // Returned entries are no longer in the streams.
+        for (const Held& entry : held) {
+            if (entry.id.empty() && matches(entry.entry, key)) {
+                if (depth.count == 0 || entry.entry.timestamp < depth.oldest) {
+                    depth.oldest = entry.entry.timestamp;
+                }
+                depth.count++;
+                depth.bytes += entry.entry.payload_size;
+            }
+        }
+        if (!isConnected()) {
+            return depth;
+        }
+        std::vector<std::string> streams = keysFor(key);
+        for (const std::string& k : streams) {
+            append({"XLEN", streamOf(k)});
+            append({"HGET", prefix + "bytes", k});
+            append({"XRANGE", streamOf(k), "-", "+", "COUNT", "1"});
+        }
+        for (std::size_t i = 0; i < streams.size(); i++) {
+            Reply length = reply();
+            Reply bytes = reply();
+            Reply first = reply();
+            if (!length || length->type != REDIS_REPLY_INTEGER || length->integer == 0) {
+                continue;
+            }
+            depth.count += static_cast<int>(length->integer);
+            if (bytes && bytes->type == REDIS_REPLY_STRING) {
+                depth.bytes += std::strtoll(replyString(bytes.get()).c_str(), nullptr, 10);
+            }
+            if (first && first->type == REDIS_REPLY_ARRAY && first->elements > 0 &&
+                first->element[0]->type == REDIS_REPLY_ARRAY && first->element[0]->elements > 0) {
+                auto oldest = streamIdTime(replyString(first->element[0]->element[0]));
+                if (depth.oldest == std::chrono::steady_clock::time_point() || oldest < depth.oldest) {
+                    depth.oldest = oldest;
+                }
+            }
+        }
+        return depth;
+    }
+
+    std::vector<std::string> RedisStreamQueue::peekPayloads(const std::string& key, int max) {
+        std::vector<std::string> payloads;
+        // Entries held by this daemon, returned or read, come first.
+        for (auto it = held.begin(); it != held.end() && (int)payloads.size() < max; ++it) {
+            if (matches(it->entry, key)) {
+                payloads.push_back(it->entry.payload_obj);
+            }
+        }
+        if (!isConnected() || (int)payloads.size() >= max) {
+            return payloads;
+        }
+        // Then entries not yet read by any consumer: those after the group's
+        // last delivered ID. Entries pending for other daemons' consumers are
+        // theirs to hand out.
+        std::vector<std::string> streams = keysFor(key);
+        for (const std::string& k : streams) {
+            append({"XINFO", "GROUPS", streamOf(k)});
+        }
+        std::vector<std::pair<std::string, std::string>> starts;
+        for (const std::string& k : streams) {
+            Reply r = reply();
+            for (std::size_t g = 0; r && r->type == REDIS_REPLY_ARRAY && g < r->elements; g++) {
+                const redisReply* group = r->element[g];
+                std::string name, last_id;
+                for (std::size_t f = 0; group->type == REDIS_REPLY_ARRAY && f + 1 < group->elements; f += 2) {
+                    std::string field_name = replyString(group->element[f]);
+                    if (field_name == "name") {
+                        name = replyString(group->element[f + 1]);
+                    } else if (field_name == "last-delivered-id") {
+                        last_id = replyString(group->element[f + 1]);
+                    }
+                }
+                if (name == STREAM_GROUP && !last_id.empty()) {
+                    starts.emplace_back(streamOf(k), "(" + last_id);
+                }
+            }
+        }
+        std::string count = std::to_string(max - payloads.size());
+        for (const auto& [stream, start] : starts) {
+            append({"XRANGE", stream, start, "+", "COUNT", count});
+        }
+        std::vector<std::pair<std::string, std::string>> listed;
+        for (std::size_t i = 0; i < starts.size(); i++) {
+            Reply r = reply();
+            for (std::size_t e = 0; r && r->type == REDIS_REPLY_ARRAY && e < r->elements; e++) {
+                const redisReply* item = r->element[e];
+                if (item->type != REDIS_REPLY_ARRAY || item->elements != 2) {
+                    continue;
+                }
+                const redisReply* fields = item->element[1];
+                for (std::size_t f = 0; f + 1 < fields->elements; f += 2) {
+                    if (replyString(fields->element[f]) == "payload") {
+                        listed.emplace_back(replyString(item->element[0]), replyString(fields->element[f + 1]));
+                    }
+                }
+            }
+        }
+        std::stable_sort(listed.begin(), listed.end(),
+                         [](const auto& a, const auto& b) { return streamIdLess(a.first, b.first); });
+        for (auto it = listed.begin(); it != listed.end() && (int)payloads.size() < max; ++it) {
+            payloads.push_back(std::move(it->second));
+        }
+        return payloads;
+    }
+}
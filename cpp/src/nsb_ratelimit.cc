@@ -0,0 +1,112 @@
+// nsb_ratelimit.cc
+
+#include "nsb_ratelimit.h"
+
+#include <algorithm>
+
+namespace nsb {
+
+    TokenBucket::TokenBucket(double rate, double capacity)
+        : rate(rate), capacity(capacity), tokens(capacity), last(Clock::now()) {}
+
+    void TokenBucket::refill(Clock::time_point now) {
+        // A bucket created during admit() is stamped after the caller's time point.
+        if (now <= last) {
+            return;
+        }
+        double elapsed = std::chrono::duration<double>(now - last).count();
+        tokens = std::min(capacity, tokens + elapsed * rate);
+        last = now;
+    }
+
+    bool TokenBucket::available(double n, Clock::time_point now) {
+        if (unlimited()) {
+            return true;
+        }
+        refill(now);
+        return tokens >= std::min(n, capacity);
+    }
+
+    void TokenBucket::consume(double n, Clock::time_point now) {
+        if (unlimited()) {
+            return;
+        }
+        refill(now);
+        tokens -= n;
+    }
+
+    TokenBucket::Clock::duration TokenBucket::deficitWait(Clock::time_point now) {
+        if (unlimited()) {
+            return Clock::duration::zero();
+        }
+        refill(now);
+        if (tokens >= 0) {
+            return Clock::duration::zero();
+        }
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-tokens / rate));
+    }
+
+    RateLimiter::Buckets& RateLimiter::bucketsFor(const std::string& key, double messages_per_sec,
+                                                  double bytes_per_sec) {
+        auto it = buckets.find(key);
+        if (it == buckets.end()) {
+            it = buckets.emplace(key, Buckets{
+                TokenBucket(messages_per_sec, messages_per_sec * cfg.BURST_SECONDS),
+                TokenBucket(bytes_per_sec, bytes_per_sec * cfg.BURST_SECONDS)
+            }).first;
+        }
+        return it->second;
+    }
+
+    RateLimiter::Verdict RateLimiter::admit(const std::string& client_id, std::size_t bytes,
+                                            Clock::duration* delay) {
+        *delay = Clock::duration::zero();
+        if (!cfg.ENABLED) {
+            return Verdict::ADMIT;
+        }
+        Clock::time_point now = Clock::now();
+        // Collect the buckets that apply to this client.
+        std::vector<std::pair<std::string, Buckets*>> applicable;
+        applicable.emplace_back(client_id, &bucketsFor(client_id, cfg.CLIENT_MESSAGES_PER_SEC,
+                                                       cfg.CLIENT_BYTES_PER_SEC));
+        for (const RateLimitConfig::NamespaceLimit& ns : cfg.NAMESPACES) {
+            if (client_id.compare(0, ns.prefix.size(), ns.prefix) == 0) {
+                std::string key = ns.prefix + "*";
+                applicable.emplace_back(key, &bucketsFor(key, ns.messages_per_sec, ns.bytes_per_sec));
+            }
+        }
+        // Check whether every bucket can cover the message.
+        bool within_limits = std::all_of(applicable.begin(), applicable.end(), [&](const auto& entry) {
+            return entry.second->messages.available(1, now) &&
+                   entry.second->bytes.available(static_cast<double>(bytes), now);
+        });
+        Verdict verdict = Verdict::ADMIT;
+        if (!within_limits) {
+            switch (cfg.OVERFLOW_ACTION) {
+                case RateLimitConfig::OverflowAction::DELAY:  verdict = Verdict::DELAY; break;
+                case RateLimitConfig::OverflowAction::REJECT: verdict = Verdict::REJECT; break;
+                case RateLimitConfig::OverflowAction::DROP:   verdict = Verdict::DROP; break;
+            }
+        }
+        // Admitted and delayed messages are charged; delayed ones go into debt.
+        if (verdict == Verdict::ADMIT || verdict == Verdict::DELAY) {
+            for (auto& entry : applicable) {
+                entry.second->messages.consume(1, now);
+                entry.second->bytes.consume(static_cast<double>(bytes), now);
+                *delay = std::max({*delay, entry.second->messages.deficitWait(now),
+                                   entry.second->bytes.deficitWait(now)});
+            }
+        }
+        // Update counters.
+        for (auto& entry : applicable) {
+            Counters& counters = stats[entry.first];
+            switch (verdict) {
+                case Verdict::ADMIT:  counters.admitted++; break;
+                case Verdict::DELAY:  counters.delayed++; break;
+                case Verdict::REJECT: counters.rejected++; break;
+                case Verdict::DROP:   counters.dropped++; break;
+            }
+        }
+        return verdict;
+    }
+}
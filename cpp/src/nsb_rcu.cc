@@ -0,0 +1,56 @@
+// nsb_rcu.cc
+
+#include "nsb_rcu.h"
+
+namespace nsb {
+
+    QsbrDomain::QsbrDomain() : epoch(1) {}
+
+    QsbrDomain::~QsbrDomain() {
+        for (auto& [target, reclaim] : retired) {
+            reclaim();
+        }
+    }
+
+    int QsbrDomain::registerReader() {
+        for (int reader = 0; reader < RCU_MAX_READERS; reader++) {
+            uint64_t expected = UNUSED;
+            if (slots[reader].seen.compare_exchange_strong(expected, epoch.load(std::memory_order_acquire))) {
+                return reader;
+            }
+        }
+        LOG(ERROR) << "No more than " << RCU_MAX_READERS << " RCU readers may be registered." << std::endl;
+        return -1;
+    }
+
+    void QsbrDomain::unregisterReader(int reader) {
+        slots[reader].seen.store(UNUSED, std::memory_order_release);
+    }
+
+    void QsbrDomain::retire(std::function<void()> reclaim) {
+        // Readers that are quiescent at the new epoch or later have let go of the old data.
+        uint64_t target = epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+        // Order the publication before the scan, against readers coming online.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        retired.emplace_back(target, std::move(reclaim));
+        this->reclaim();
+    }
+
+    std::size_t QsbrDomain::reclaim() {
+        while (!retired.empty() && passed(retired.front().first)) {
+            retired.front().second();
+            retired.pop_front();
+        }
+        return retired.size();
+    }
+
+    bool QsbrDomain::passed(uint64_t target) const {
+        for (const Slot& slot : slots) {
+            uint64_t seen = slot.seen.load(std::memory_order_acquire);
+            if (seen != UNUSED && seen != OFFLINE && seen < target) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,132 @@
+// nsb_relay.cc
+
+#include "nsb_relay.h"
+
+#include <cstring>
+
+#include <google/protobuf/io/gzip_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <poll.h>
+
+namespace nsb {
+
+    void packRelay(const nsb::nsbm::Relay& relay, bool compress, std::string* out) {
+        std::string body = relay.SerializeAsString();
+        uint32_t header = static_cast<uint32_t>(body.size());
+        if (compress && body.size() >= RELAY_COMPRESS_MIN_SIZE) {
+            std::string compressed;
+            {
+                google::protobuf::io::StringOutputStream sink(&compressed);
+                google::protobuf::io::GzipOutputStream::Options options;
+                options.format = google::protobuf::io::GzipOutputStream::ZLIB;
+                google::protobuf::io::GzipOutputStream zlib(&sink, options);
+                relay.SerializeToZeroCopyStream(&zlib);
+            }
+            // Keep whichever is smaller.
+            if (compressed.size() < body.size()) {
+                body = std::move(compressed);
+                header = static_cast<uint32_t>(body.size()) | RELAY_COMPRESSED;
+            }
+        }
+        uint32_t network_header = htonl(header);
+        out->append(reinterpret_cast<const char*>(&network_header), sizeof(network_header));
+        out->append(body);
+    }
+
+    void RelayReader::append(const char* data, std::size_t size) {
+        // Drop consumed envelopes before growing the buffer.
+        if (offset > 0) {
+            buffer.erase(0, offset);
+            offset = 0;
+        }
+        buffer.append(data, size);
+    }
+
+    int RelayReader::next(nsb::nsbm::Relay* relay) {
+        uint32_t network_header;
+        if (buffer.size() - offset < sizeof(network_header)) {
+            return 0;
+        }
+        std::memcpy(&network_header, buffer.data() + offset, sizeof(network_header));
+        uint32_t header = ntohl(network_header);
+        std::size_t size = header & ~RELAY_COMPRESSED;
+        if (size > RELAY_MAX_ENVELOPE_SIZE) {
+            return -1;
+        }
+        if (buffer.size() - offset - sizeof(network_header) < size) {
+            return 0;
+        }
+        const char* body = buffer.data() + offset + sizeof(network_header);
+        bool parsed;
+        if (header & RELAY_COMPRESSED) {
+            google::protobuf::io::ArrayInputStream source(body, static_cast<int>(size));
+            google::protobuf::io::GzipInputStream zlib(&source, google::protobuf::io::GzipInputStream::ZLIB);
+            parsed = relay->ParseFromZeroCopyStream(&zlib);
+        } else {
+            parsed = relay->ParseFromArray(body, static_cast<int>(size));
+        }
+        offset += sizeof(network_header) + size;
+        return parsed ? 1 : -1;
+    }
+
+    void packFrame(const std::string& message, std::string* out) {
+        uint32_t network_header = htonl(static_cast<uint32_t>(message.size()));
+        out->append(reinterpret_cast<const char*>(&network_header), sizeof(network_header));
+        out->append(message);
+    }
+
+    void FrameReader::append(const char* data, std::size_t size) {
+        // Drop consumed frames before growing the buffer.
+        if (offset > 0) {
+            buffer.erase(0, offset);
+            offset = 0;
+        }
+        buffer.append(data, size);
+    }
+
+    int FrameReader::next(std::string* message) {
+        uint32_t network_header;
+        if (buffer.size() - offset < sizeof(network_header)) {
+            return 0;
+        }
+        std::memcpy(&network_header, buffer.data() + offset, sizeof(network_header));
+        std::size_t size = ntohl(network_header);
+        if (size > RELAY_MAX_ENVELOPE_SIZE) {
+            return -1;
+        }
+        if (buffer.size() - offset - sizeof(network_header) < size) {
+            return 0;
+        }
+        message->assign(buffer, offset + sizeof(network_header), size);
+        offset += sizeof(network_header) + size;
+        return 1;
+    }
+
+    void FrameReader::clear() {
+        buffer.clear();
+        offset = 0;
+    }
+
+    int sendAll(int fd, const char* data, std::size_t size, int timeout_ms) {
+        std::size_t sent = 0;
+        while (sent < size) {
+            ssize_t bytes_sent = send(fd, data + sent, size - sent, MSG_NOSIGNAL);
+            if (bytes_sent >= 0) {
+                sent += bytes_sent;
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            // Wait for the peer to catch up.
+            pollfd writable{fd, POLLOUT, 0};
+            if (poll(&writable, 1, timeout_ms) <= 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,520 @@
+// nsb_resp.cc
+
+#include "nsb_resp.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+namespace nsb {
+
+    namespace {
+        /** @brief How often the server loop wakes up to expire keys and check for stop(). */
+        const int RESP_TICK_MS = 100;
+
+        void replySimple(std::string& out, const std::string& status) {
+            out += '+';
+            out += status;
+            out += "\r\n";
+        }
+        void replyError(std::string& out, const std::string& error) {
+            out += '-';
+            out += error;
+            out += "\r\n";
+        }
+        void replyInteger(std::string& out, long long value) {
+            out += ':';
+            out += std::to_string(value);
+            out += "\r\n";
+        }
+        void replyBulk(std::string& out, const std::string& value) {
+            out += '$';
+            out += std::to_string(value.size());
+            out += "\r\n";
+            out += value;
+            out += "\r\n";
+        }
+        void replyNull(std::string& out, int protocol) {
+            out += (protocol >= 3) ? "_\r\n" : "$-1\r\n";
+        }
+        void replyArray(std::string& out, std::size_t count) {
+            out += '*';
+            out += std::to_string(count);
+            out += "\r\n";
+        }
+        void replyMap(std::string& out, std::size_t count, int protocol) {
+            out += (protocol >= 3) ? '%' : '*';
+            out += std::to_string(protocol >= 3 ? count : count * 2);
+            out += "\r\n";
+        }
+
+        /** @brief Parses a whole base-10 integer, as Redis does for arguments. */
+        bool parseInteger(const std::string& text, long long* value) {
+            if (text.empty()) {
+                return false;
+            }
+            char* end = nullptr;
+            errno = 0;
+            *value = std::strtoll(text.c_str(), &end, 10);
+            return errno == 0 && end == text.c_str() + text.size();
+        }
+
+        /** @brief Parses a "<number>\r\n" header starting at pos. */
+        int parseHeader(const std::string& in, std::size_t& pos, long long* value) {
+            std::size_t end = in.find("\r\n", pos);
+            if (end == std::string::npos) {
+                return 0;
+            }
+            if (!parseInteger(in.substr(pos, end - pos), value)) {
+                return -1;
+            }
+            pos = end + 2;
+            return 1;
+        }
+    }
+
+    RespServer::RespServer() : running(false), listen_fd(-1), port(-1), key_count(0), expiring(0) {}
+
+    RespServer::~RespServer() {
+        stop();
+    }
+
+    int RespServer::start(const std::string& address, int requested_port) {
+        if (running) {
+            return port;
+        }
+        if (!address.empty() && address[0] == '/') {
+            // Listen on a Unix domain socket.
+            sockaddr_un addr{};
+            if (address.size() >= sizeof(addr.sun_path)) {
+                LOG(ERROR) << "RespServer: socket path too long: " << address << std::endl;
+                return -1;
+            }
+            listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, address.c_str(), address.size() + 1);
+            unlink(address.c_str());
+            if (listen_fd == -1 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+                LOG(ERROR) << "RespServer: failed to bind " << address << ": " << strerror(errno) << std::endl;
+                stop();
+                return -1;
+            }
+            unix_path = address;
+            port = 0;
+        } else {
+            listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+            const int opt = 1;
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = inet_addr(address.c_str());
+            addr.sin_port = htons(requested_port);
+            socklen_t addr_len = sizeof(addr);
+            if (listen_fd == -1 || setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+                bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 ||
+                getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len) == -1) {
+                LOG(ERROR) << "RespServer: failed to bind " << address << ":" << requested_port << ": "
+                           << strerror(errno) << std::endl;
+                stop();
+                return -1;
+            }
+            port = ntohs(addr.sin_port);
+        }
+        if (listen(listen_fd, SOMAXCONN) == -1 ||
+            fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL, 0) | O_NONBLOCK) == -1) {
+            LOG(ERROR) << "RespServer: failed to listen: " << strerror(errno) << std::endl;
+            stop();
+            return -1;
+        }
+        running = true;
+        server_thread = std::thread(&RespServer::serve, this);
+        LOG(INFO) << "RespServer listening on " << (unix_path.empty() ? address + ":" + std::to_string(port)
+                                                                      : unix_path) << std::endl;
+        return port;
+    }
+
+    void RespServer::stop() {
+        running = false;
+        if (server_thread.joinable()) {
+            server_thread.join();
+        }
+        for (auto& [fd, conn] : connections) {
+            close(fd);
+        }
+        connections.clear();
+        if (listen_fd != -1) {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+        if (!unix_path.empty()) {
+            unlink(unix_path.c_str());
+            unix_path.clear();
+        }
+    }
+
+    void RespServer::serve() {
+        auto last_sweep = std::chrono::steady_clock::now();
+        while (running) {
+            fd_set read_fds, write_fds;
+            FD_ZERO(&read_fds);
+            FD_ZERO(&write_fds);
+            FD_SET(listen_fd, &read_fds);
+            int max_fd = listen_fd;
+            for (const auto& [fd, conn] : connections) {
+                FD_SET(fd, &read_fds);
+                if (!conn.out.empty()) {
+                    FD_SET(fd, &write_fds);
+                }
+                max_fd = std::max(max_fd, fd);
+            }
+            timeval timeout = {0, RESP_TICK_MS * 1000};
+            int activity = select(max_fd + 1, &read_fds, &write_fds, nullptr, &timeout);
+            if (activity < 0 && errno != EINTR) {
+                LOG(ERROR) << "RespServer: select failed: " << strerror(errno) << std::endl;
+                running = false;
+                break;
+            }
+            // Accept new connections.
+            if (activity > 0 && FD_ISSET(listen_fd, &read_fds)) {
+                int fd;
+                while ((fd = accept(listen_fd, nullptr, nullptr)) != -1) {
+                    if (fd >= FD_SETSIZE) {
+                        close(fd);
+                        continue;
+                    }
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+                    if (unix_path.empty()) {
+                        const int nodelay = 1;
+                        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+                    }
+                    connections[fd];
+                }
+            }
+            // Serve existing connections.
+            for (auto it = connections.begin(); activity > 0 && it != connections.end();) {
+                int fd = it->first;
+                Connection& conn = it->second;
+                if (FD_ISSET(fd, &read_fds)) {
+                    readConnection(fd, conn);
+                }
+                if (!conn.out.empty()) {
+                    writeConnection(fd, conn);
+                }
+                if (conn.closing && conn.out.empty()) {
+                    close(fd);
+                    it = connections.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            // Expire keys nobody has accessed.
+            auto now = std::chrono::steady_clock::now();
+            if (expiring > 0 && now - last_sweep >= std::chrono::milliseconds(RESP_TICK_MS)) {
+                expireKeys();
+                last_sweep = now;
+            }
+        }
+    }
+
+    void RespServer::readConnection(int fd, Connection& conn) {
+        char buffer[16384];
+        ssize_t received;
+        while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            conn.in.append(buffer, received);
+        }
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            conn.closing = true;
+            conn.out.clear();
+            return;
+        }
+        // Handle every complete command before replying.
+        std::size_t pos = 0;
+        std::vector<std::string> args;
+        while (!conn.closing) {
+            int parsed = parseCommand(conn.in, pos, args);
+            if (parsed == 0) {
+                break;
+            } else if (parsed < 0) {
+                replyError(conn.out, "ERR Protocol error");
+                conn.closing = true;
+                break;
+            }
+            if (!args.empty()) {
+                execute(args, conn);
+            }
+        }
+        conn.in.erase(0, pos);
+    }
+
+    void RespServer::writeConnection(int fd, Connection& conn) {
+        ssize_t sent = send(fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn.out.erase(0, sent);
+        } else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            conn.closing = true;
+            conn.out.clear();
+        }
+    }
+
+    int RespServer::parseCommand(const std::string& in, std::size_t& pos, std::vector<std::string>& args) {
+        args.clear();
+        if (pos >= in.size()) {
+            return 0;
+        }
+        std::size_t cursor = pos;
+        if (in[cursor] != '*') {
+            // Inline command, as typed into a terminal.
+            std::size_t end = in.find('\n', cursor);
+            if (end == std::string::npos) {
+                return 0;
+            }
+            std::istringstream line(in.substr(cursor, end - cursor));
+            std::string arg;
+            while (line >> arg) {
+                args.push_back(arg);
+            }
+            pos = end + 1;
+            return 1;
+        }
+        cursor++;
+        long long count;
+        int status = parseHeader(in, cursor, &count);
+        if (status <= 0) {
+            return status;
+        }
+        if (count > RESP_MAX_ARGS) {
+            return -1;
+        }
+        for (long long i = 0; i < count; i++) {
+            if (cursor >= in.size()) {
+                return 0;
+            }
+            if (in[cursor] != '$') {
+                return -1;
+            }
+            cursor++;
+            long long length;
+            status = parseHeader(in, cursor, &length);
+            if (status <= 0) {
+                return status;
+            }
+            if (length < 0 || length > RESP_MAX_BULK_SIZE) {
+                return -1;
+            }
+            if (in.size() < cursor + length + 2) {
+                return 0;
+            }
+            args.emplace_back(in, cursor, length);
+            cursor += length + 2;
+        }
+        pos = cursor;
+        return 1;
+    }
+
+    std::unordered_map<std::string, RespServer::Value>::iterator RespServer::lookup(const std::string& key) {
+        auto it = store.find(key);
+        if (it != store.end() && it->second.expiry != std::chrono::steady_clock::time_point() &&
+            it->second.expiry <= std::chrono::steady_clock::now()) {
+            erase(it);
+            return store.end();
+        }
+        return it;
+    }
+
+    void RespServer::erase(std::unordered_map<std::string, Value>::iterator it) {
+        if (it->second.expiry != std::chrono::steady_clock::time_point()) {
+            expiring--;
+        }
+        MemoryAccounting::release(MemoryTag::PAYLOAD, it->second.data.size());
+        store.erase(it);
+        key_count = store.size();
+    }
+
+    void RespServer::expireKeys() {
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = store.begin(); it != store.end();) {
+            auto next = std::next(it);
+            if (it->second.expiry != std::chrono::steady_clock::time_point() && it->second.expiry <= now) {
+                erase(it);
+            }
+            it = next;
+        }
+    }
+
+    void RespServer::execute(std::vector<std::string>& args, Connection& conn) {
+        std::string name = args[0];
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        std::string& out = conn.out;
+        std::size_t argc = args.size();
+        auto wrongArgs = [&]() {
+            replyError(out, "ERR wrong number of arguments for '" + args[0] + "' command");
+        };
+        if (name == "GET" || name == "GETDEL") {
+            if (argc != 2) {
+                return wrongArgs();
+            }
+            auto it = lookup(args[1]);
+            if (it == store.end()) {
+                return replyNull(out, conn.protocol);
+            }
+            replyBulk(out, it->second.data);
+            if (name == "GETDEL") {
+                erase(it);
+            }
+        } else if (name == "SET") {
+            if (argc < 3) {
+                return wrongArgs();
+            }
+            // Parse the options: EX seconds | PX milliseconds | NX | XX | KEEPTTL.
+            std::chrono::steady_clock::time_point expiry;
+            bool nx = false, xx = false, keep_ttl = false;
+            for (std::size_t i = 3; i < argc; i++) {
+                std::string option = args[i];
+                std::transform(option.begin(), option.end(), option.begin(), ::toupper);
+                long long amount;
+                if ((option == "EX" || option == "PX") && i + 1 < argc) {
+                    if (!parseInteger(args[++i], &amount) || amount <= 0) {
+                        return replyError(out, "ERR invalid expire time in 'set' command");
+                    }
+                    expiry = std::chrono::steady_clock::now() +
+                             (option == "EX" ? std::chrono::milliseconds(amount * 1000) : std::chrono::milliseconds(amount));
+                } else if (option == "NX") {
+                    nx = true;
+                } else if (option == "XX") {
+                    xx = true;
+                } else if (option == "KEEPTTL") {
+                    keep_ttl = true;
+                } else {
+                    return replyError(out, "ERR syntax error");
+                }
+            }
+            auto it = lookup(args[1]);
+            if ((nx && it != store.end()) || (xx && it == store.end())) {
+                return replyNull(out, conn.protocol);
+            }
+            if (it == store.end()) {
+                it = store.emplace(std::move(args[1]), Value()).first;
+            } else {
+                MemoryAccounting::release(MemoryTag::PAYLOAD, it->second.data.size());
+                if (it->second.expiry != std::chrono::steady_clock::time_point()) {
+                    if (keep_ttl) {
+                        expiry = it->second.expiry;
+                    }
+                    expiring--;
+                }
+            }
+            MemoryAccounting::record(MemoryTag::PAYLOAD, args[2].size());
+            it->second.data = std::move(args[2]);
+            it->second.expiry = expiry;
+            if (expiry != std::chrono::steady_clock::time_point()) {
+                expiring++;
+            }
+            key_count = store.size();
+            replySimple(out, "OK");
+        } else if (name == "DEL" || name == "UNLINK" || name == "EXISTS") {
+            if (argc < 2) {
+                return wrongArgs();
+            }
+            long long count = 0;
+            for (std::size_t i = 1; i < argc; i++) {
+                auto it = lookup(args[i]);
+                if (it != store.end()) {
+                    count++;
+                    if (name != "EXISTS") {
+                        erase(it);
+                    }
+                }
+            }
+            replyInteger(out, count);
+        } else if (name == "MGET") {
+            if (argc < 2) {
+                return wrongArgs();
+            }
+            replyArray(out, argc - 1);
+            for (std::size_t i = 1; i < argc; i++) {
+                auto it = lookup(args[i]);
+                if (it == store.end()) {
+                    replyNull(out, conn.protocol);
+                } else {
+                    replyBulk(out, it->second.data);
+                }
+            }
+        } else if (name == "EXPIRE" || name == "PEXPIRE") {
+            long long amount;
+            if (argc != 3) {
+                return wrongArgs();
+            }
+            if (!parseInteger(args[2], &amount)) {
+                return replyError(out, "ERR value is not an integer or out of range");
+            }
+            auto it = lookup(args[1]);
+            if (it == store.end()) {
+                return replyInteger(out, 0);
+            }
+            if (amount <= 0) {
+                erase(it);
+            } else {
+                if (it->second.expiry == std::chrono::steady_clock::time_point()) {
+                    expiring++;
+                }
+                it->second.expiry = std::chrono::steady_clock::now() +
+                    (name == "EXPIRE" ? std::chrono::milliseconds(amount * 1000) : std::chrono::milliseconds(amount));
+            }
+            replyInteger(out, 1);
+        } else if (name == "DBSIZE") {
+            replyInteger(out, store.size());
+        } else if (name == "FLUSHDB" || name == "FLUSHALL") {
+            for (const auto& [key, value] : store) {
+                MemoryAccounting::release(MemoryTag::PAYLOAD, value.data.size());
+            }
+            store.clear();
+            expiring = 0;
+            key_count = 0;
+            replySimple(out, "OK");
+        } else if (name == "PING") {
+            if (argc > 1) {
+                replyBulk(out, args[1]);
+            } else {
+                replySimple(out, "PONG");
+            }
+        } else if (name == "ECHO") {
+            if (argc != 2) {
+                return wrongArgs();
+            }
+            replyBulk(out, args[1]);
+        } else if (name == "HELLO") {
+            // Negotiate the protocol version; authentication is not supported.
+            if (argc > 1) {
+                long long version;
+                if (!parseInteger(args[1], &version) || version < 2 || version > 3) {
+                    return replyError(out, "NOPROTO unsupported protocol version");
+                }
+                conn.protocol = static_cast<int>(version);
+            }
+            replyMap(out, 7, conn.protocol);
+            replyBulk(out, "server");
+            replyBulk(out, "nsb");
+            replyBulk(out, "version");
+            replyBulk(out, "7.0.0");
+            replyBulk(out, "proto");
+            replyInteger(out, conn.protocol);
+            replyBulk(out, "id");
+            replyInteger(out, 0);
+            replyBulk(out, "mode");
+            replyBulk(out, "standalone");
+            replyBulk(out, "role");
+            replyBulk(out, "master");
+            replyBulk(out, "modules");
+            replyArray(out, 0);
+        } else if (name == "SELECT" || name == "CLIENT") {
+            // A single database, and no per-client settings to keep.
+            replySimple(out, "OK");
+        } else if (name == "COMMAND") {
+            replyArray(out, 0);
+        } else if (name == "QUIT") {
+            replySimple(out, "OK");
+            conn.closing = true;
+        } else {
+            replyError(out, "ERR unknown command '" + args[0] + "'");
+        }
+    }
+}
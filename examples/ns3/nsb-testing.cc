@@ -17,7 +17,7 @@
 #include <sys/stat.h>
 #include <ctime>
 // Add NSB include
-#include "nsb_client.h"
+#include "nsb_ns3.h"
 
 
 using namespace ns3;
@@ -26,6 +26,10 @@ NS_LOG_COMPONENT_DEFINE("NS3BasicSim");
 
 // Declare global NSBSimClient
 std::shared_ptr<nsb::NSBSimClient> simClient;
+// Maps NSB identifiers to nodes and addresses.
+nsb::Ns3NodeMap nodeMap;
+// Brings fetched payloads into the simulation and posts received ones.
+std::unique_ptr<nsb::Ns3Bridge> bridge;
 
 
 struct NodeMapping {
@@ -37,38 +41,6 @@ struct NodeMapping {
     std::ofstream* logFile;
 };
 
-//Tried this way, since we just have one simulator wide simClient, and not per-node 
-void PollToFetch() {
-    nsb::MessageEntry entry = simClient->fetch();
-    if (!entry.exists()) {
-        Simulator::Schedule(Seconds(1.0), &PollToFetch);
-        return;
-    }
-
-    std::string srcId = entry.source;
-    std::string destId = entry.destination;
-    std::string payload = entry.payload_obj;
-
-    //assumes that we have then the host mapping on the appside starting from 1 and corresponding same way to IP , checkout node mapping below 
-    std::string destIpStr = "10.1.1." + destId.substr(4);
-    Ipv4Address destAddr(destIpStr.c_str());
-
-    uint32_t srcIndex = std::stoi(srcId.substr(4));
-    Ptr<Node> srcNode = NodeList::GetNode(srcIndex);
-
-    Ptr<Socket> socket = Socket::CreateSocket(srcNode, UdpSocketFactory::GetTypeId());
-    InetSocketAddress remote = InetSocketAddress(destAddr, 5000);
-    socket->Connect(remote);
-
-    Ptr<Packet> pkt = Create<Packet>((uint8_t*)payload.c_str(), payload.size());
-    socket->Send(pkt);
-    socket->Close();
-
-    Simulator::Schedule(Seconds(1.0), &PollToFetch);
-}
-
-
-
 void CreateLogDirectory(const std::string& path, std::ostream* mainLog) {
     int status = mkdir(path.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
     if (mainLog) {
@@ -139,44 +111,8 @@ bool BuildNetworkTopology(const std::vector<NodeMapping>& nodeMappings,
     return true;
 }
 
-void ReceivePacket(Ptr<Socket> socket) {
-    Address from;
-    Ptr<Packet> pkt = socket->RecvFrom(from);
-
-    Ptr<Node> thisNode = socket->GetNode();
-    uint32_t nodeId = thisNode->GetId();
-    std::string destId = "host" + std::to_string(nodeId);
-
-    std::vector<uint8_t> buf(pkt->GetSize());
-    pkt->CopyData(buf.data(), pkt->GetSize());
-    std::string payload(buf.begin(), buf.end());
-
-    InetSocketAddress srcSockAddr = InetSocketAddress::ConvertFrom(from);
-    std::ostringstream oss;
-    oss << srcSockAddr.GetIpv4();
-    std::string srcIpStr = oss.str();
-    int srcIndex = std::stoi(srcIpStr.substr(srcIpStr.find_last_of('.') + 1)) - 1;
-    std::string srcId = "host" + std::to_string(srcIndex);
-
-    simClient->post(srcId, destId, payload);
-}
-
-void SetupUdpReceiveSockets(const std::vector<NodeMapping>& nodeMappings, const NodeContainer& allSimNodes, std::ostream& mainLog) {
-    for (size_t i = 0; i < nodeMappings.size(); ++i) {
-        Ptr<Socket> recvSocket = Socket::CreateSocket(allSimNodes.Get(i), UdpSocketFactory::GetTypeId());
-        InetSocketAddress local = InetSocketAddress(Ipv4Address::GetAny(), 5000);
-        recvSocket->Bind(local);
-        recvSocket->SetRecvCallback(MakeCallback(&ReceivePacket));
-    }
-}
-
 void SendGeneratedMessage(Ptr<Node> senderNode, Ipv4Address destAddr, std::string message) {
-    Ptr<Socket> socket = Socket::CreateSocket(senderNode, UdpSocketFactory::GetTypeId());
-    InetSocketAddress destination(destAddr, 5000);
-    socket->Connect(destination);
-    Ptr<Packet> packet = Create<Packet>((uint8_t*)message.c_str(), message.size());
-    socket->Send(packet);
-    socket->Close();
+    bridge->getSocketPool().send(senderNode, destAddr, message);
 }
 
 void GenerateTraffic(const std::vector<NodeMapping>& nodeMappings) {
@@ -195,11 +131,17 @@ void GenerateTraffic(const std::vector<NodeMapping>& nodeMappings) {
 
 int main(int argc, char* argv[]) {
     int numHosts = 10;
+    bool realtime = true;
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("numHosts", "Number of simulated NS-3 hosts", numHosts);
+    cmd.AddValue("realtime", "Run in real time, waking on NSB payloads instead of polling", realtime);
     cmd.Parse(argc, argv);
 
+    if (realtime) {
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+    }
+
     Time::SetResolution(Time::NS);
 
     std::ofstream mainLogFile;
@@ -224,7 +166,7 @@ if (!mainLogFile.is_open()) {
         std::ostringstream ipStream;
         ipStream << "10.1.1." << (i + 1);
         mapping.ipString = ipStream.str();
-        mapping.nodeIdString = "node" + std::to_string(i);
+        mapping.nodeIdString = "host" + std::to_string(i);
         mapping.logFile = nullptr;
         mapping.ipv4Addr = Ipv4Address(mapping.ipString.c_str());
         nodeMappings.push_back(mapping);
@@ -243,16 +185,20 @@ if (!mainLogFile.is_open()) {
     for (size_t i = 0; i < nodeMappings.size(); ++i) {
         nodeMappings[i].nodePtr = allSimNodes.Get(i);
         nodeMappings[i].wifiDeviceIndex = i;
+        nodeMap.add(nodeMappings[i].nodeIdString, nodeMappings[i].nodePtr, nodeMappings[i].ipv4Addr);
     }
 
-    SetupUdpReceiveSockets(nodeMappings, allSimNodes, mainLogFile);
+    bridge = std::make_unique<nsb::Ns3Bridge>(simClient, nodeMap, 5000);
+    for (size_t i = 0; i < nodeMappings.size(); ++i) {
+        bridge->installReceiver(nodeMappings[i].nodePtr);
+    }
     GenerateTraffic(nodeMappings);
 
     //Simulator::Stop(Seconds(20.0));
-    
-    Simulator::Schedule(Seconds(1.0), &PollToFetch);
 
-Simulator::Run();
+    bridge->start();
+    Simulator::Run();
+    bridge->stop();
     Simulator::Destroy();
     return 0;
 }
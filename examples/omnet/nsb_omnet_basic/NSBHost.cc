@@ -25,7 +25,16 @@ void NSBHost::initialize()
 
         simClient = new nsb::NSBSimClient(hostId, serverAddress, serverPort);
 
+        // With NSBScheduler, fetched messages arrive as events; otherwise poll.
+        scheduler = dynamic_cast<NSBScheduler*>(getSimulation()->getScheduler());
+        if (scheduler) {
+            scheduler->registerClient(this, simClient);
+            return;
+        }
+
         sendInterval = par("sendInterval");
+        // Poll no slower than sendInterval, faster when the daemon suggests it.
+        poller = new nsb::AdaptivePoller(0.001, sendInterval.dbl());
         selfMsg = new cMessage("sendTimer");
 
         scheduleAt(simTime() + sendInterval, selfMsg);
@@ -35,7 +44,10 @@ void NSBHost::handleMessage(cMessage *msg)
 {
     if (msg == selfMsg) {
             sendPacket();
-            scheduleAt(simTime() + sendInterval, selfMsg);
+            scheduleAt(simTime() + poller->nextDelay(), selfMsg);
+        } else if (auto event = dynamic_cast<NSBEvent*>(msg)) {
+            transmit(event->getEntry());
+            delete event;
         } else {
             auto nsbMsg = check_and_cast<NSBMessage*>(msg);
             processPacket(nsbMsg);
@@ -46,11 +58,16 @@ void NSBHost::sendPacket() {
     //int timeout = 20;
     //nsb::MessageEntry entry = simClient->fetch(nullptr, timeout);
     nsb::MessageEntry entry = simClient->fetch();
+    poller->update(entry, simClient->pollHints());
     if (!entry.exists()) {
         EV_WARN << "[" << hostId << "] No message fetched\n";
         return;
     }
 
+    transmit(entry);
+}
+
+void NSBHost::transmit(const nsb::MessageEntry& entry) {
     EV_INFO << "[" << hostId << "] Fetched message to " << entry.destination << "\n";
 
     auto msg = new NSBMessage("ForwardedMsg");
@@ -91,6 +108,9 @@ void NSBHost::processPacket(NSBMessage* msg) {
 }
 
 NSBHost::~NSBHost() {
+    if (scheduler)
+        scheduler->unregisterClient(this);
     cancelAndDelete(selfMsg);
+    delete poller;
     delete simClient;
 }
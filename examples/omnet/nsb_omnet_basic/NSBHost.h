@@ -20,6 +20,7 @@
 
 #include "nsb_client.h"
 #include "NSBMessage_m.h"
+#include "NSBScheduler.h"
 
 using namespace omnetpp;
 
@@ -30,11 +31,14 @@ class NSBHost : public cSimpleModule
     nsb::NSBSimClient* simClient;
     cMessage* selfMsg = nullptr;
     simtime_t sendInterval;
+    nsb::AdaptivePoller* poller = nullptr;
+    NSBScheduler* scheduler = nullptr;
 
   protected:
     virtual void initialize() override;
     virtual void handleMessage(cMessage* msg) override;
     virtual void sendPacket();
+    virtual void transmit(const nsb::MessageEntry& entry);
     virtual void processPacket(NSBMessage* msg);
 
   public:
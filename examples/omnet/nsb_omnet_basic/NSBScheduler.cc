@@ -0,0 +1,186 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "NSBScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sys/select.h>
+
+Register_Class(NSBScheduler);
+
+Register_GlobalConfigOption(CFGID_NSBSCHEDULER_REALTIME, "nsbscheduler-realtime", CFG_BOOL, "true",
+        "When true, NSBScheduler synchronizes simulation time to wall-clock time; otherwise it only waits for NSB when there are no other events.");
+
+int64_t NSBScheduler::currentTime()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string NSBScheduler::str() const
+{
+    return "NSB scheduler";
+}
+
+void NSBScheduler::registerClient(cModule* module, nsb::NSBSimClient* client)
+{
+    registrations.push_back({module, client, nsb::AdaptivePoller(), false, 0});
+}
+
+void NSBScheduler::unregisterClient(cModule* module)
+{
+    registrations.erase(std::remove_if(registrations.begin(), registrations.end(),
+            [module](const Registration& r) { return r.module == module; }), registrations.end());
+}
+
+void NSBScheduler::startRun()
+{
+    realtime = getEnvir()->getConfig()->getAsBool(CFGID_NSBSCHEDULER_REALTIME);
+    baseTime = currentTime();
+}
+
+void NSBScheduler::endRun()
+{
+    registrations.clear();
+}
+
+void NSBScheduler::executionResumed()
+{
+    baseTime = currentTime() - simTime().inUnit(SIMTIME_US);
+}
+
+void NSBScheduler::inject(Registration& registration, const nsb::MessageEntry& entry)
+{
+    simtime_t t = simTime();
+    if (realtime) {
+        // Never schedule into the past if we are running behind.
+        t = std::max(t, SimTime(currentTime() - baseTime, SIMTIME_US));
+    }
+    EV_DEBUG << "NSBScheduler: message from " << entry.source << " to " << entry.destination
+             << " for " << registration.module->getFullPath() << " at t=" << t << "\n";
+    NSBEvent* event = new NSBEvent(entry);
+    event->setArrival(registration.module->getId(), -1, t);
+    sim->getFES()->insert(event);
+}
+
+bool NSBScheduler::receiveWithTimeout(int64_t usec)
+{
+    int64_t now = currentTime();
+    // Send due FETCH requests, and wake up in time to send the next ones.
+    for (auto& r : registrations) {
+        if (r.awaiting || r.client->getConfig().SYSTEM_MODE != nsb::Config::SystemMode::PULL)
+            continue;
+        if (r.nextPoll <= now) {
+            if (r.client->requestFetch() == 0) {
+                r.awaiting = true;
+                continue;
+            }
+            r.nextPoll = now + static_cast<int64_t>(r.poller.update(nsb::MessageEntry(), nsb::nsbm::PollHints()) * 1e6);
+        }
+        usec = std::min(usec, r.nextPoll - now);
+    }
+    // Wait on every client's sockets at once.
+    fd_set readFDs;
+    FD_ZERO(&readFDs);
+    int maxFd = -1;
+    for (auto& r : registrations) {
+        for (nsb::Comms::Channel channel : {nsb::Comms::Channel::RECV, nsb::Comms::Channel::DGRAM}) {
+            int fd = r.client->getFd(channel);
+            if (fd != -1) {
+                FD_SET(fd, &readFDs);
+                maxFd = std::max(maxFd, fd);
+            }
+        }
+    }
+    usec = std::max<int64_t>(usec, 0);
+    timeval timeout;
+    timeout.tv_sec = usec / 1000000;
+    timeout.tv_usec = usec % 1000000;
+    if (select(maxFd + 1, &readFDs, nullptr, nullptr, &timeout) <= 0)
+        return false;
+    // Collect whatever arrived and schedule it.
+    bool received = false;
+    now = currentTime();
+    for (auto& r : registrations) {
+        int recvFd = r.client->getFd(nsb::Comms::Channel::RECV);
+        int dgramFd = r.client->getFd(nsb::Comms::Channel::DGRAM);
+        if (!(recvFd != -1 && FD_ISSET(recvFd, &readFDs)) && !(dgramFd != -1 && FD_ISSET(dgramFd, &readFDs)))
+            continue;
+        nsb::MessageEntry entry = r.client->collectFetch(0);
+        if (r.client->getConfig().SYSTEM_MODE == nsb::Config::SystemMode::PULL) {
+            r.awaiting = false;
+            r.nextPoll = now + static_cast<int64_t>(r.poller.update(entry, r.client->pollHints()) * 1e6);
+        }
+        if (entry.exists()) {
+            inject(r, entry);
+            received = true;
+        }
+    }
+    return received;
+}
+
+int NSBScheduler::receiveUntil(int64_t targetTime)
+{
+    // If there's more than 200ms to wait, wait in 100ms chunks
+    // in order to keep UI responsiveness by invoking getEnvir()->idle().
+    int64_t now = currentTime();
+    while (targetTime - now >= 200000) {
+        if (receiveWithTimeout(100000))
+            return 1;
+        if (getEnvir()->idle())
+            return -1;
+        now = currentTime();
+    }
+    // Difference is now at most 200ms, do it at once.
+    int64_t remaining = targetTime - now;
+    if (remaining > 0 && receiveWithTimeout(remaining))
+        return 1;
+    return 0;
+}
+
+cEvent* NSBScheduler::guessNextEvent()
+{
+    return sim->getFES()->peekFirst();
+}
+
+cEvent* NSBScheduler::takeNextEvent()
+{
+    cEvent* event = sim->getFES()->peekFirst();
+    if (!event && registrations.empty())
+        throw cTerminationException(E_ENDEDOK);
+    if (!event) {
+        // Nothing to do until something comes from NSB.
+        receiveUntil(INT64_MAX);
+    }
+    else if (realtime) {
+        // Wait until the event is due, picking up NSB messages meanwhile.
+        int64_t targetTime = baseTime + event->getArrivalTime().inUnit(SIMTIME_US);
+        if (receiveUntil(targetTime) == -1)
+            return nullptr;
+    }
+    else {
+        // Pick up messages that have already arrived without waiting.
+        receiveWithTimeout(0);
+    }
+    if (sim->getFES()->isEmpty())
+        return nullptr;  // interrupted by user
+    return sim->getFES()->removeFirst();
+}
+
+void NSBScheduler::putBackEvent(cEvent* event)
+{
+    sim->getFES()->putBackFirst(event);
+}
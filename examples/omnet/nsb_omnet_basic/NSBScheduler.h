@@ -0,0 +1,119 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __NSB_PURE_OMNET_NSBSCHEDULER_H_
+#define __NSB_PURE_OMNET_NSBSCHEDULER_H_
+
+#include <omnetpp.h>
+
+#include "nsb_client.h"
+
+using namespace omnetpp;
+
+/**
+ * @brief Event carrying a message fetched from (or forwarded by) NSB.
+ *
+ * NSBScheduler delivers one of these to the module that registered the
+ * client the message arrived on. The event arrives without a gate, so the
+ * receiving module should check for it before treating the message as a
+ * self-message.
+ */
+class NSBEvent : public cMessage
+{
+  private:
+    nsb::MessageEntry entry;
+
+  public:
+    NSBEvent(const nsb::MessageEntry& entry) : cMessage("NSBEvent"), entry(entry) {}
+    NSBEvent(const NSBEvent& other) = default;
+    virtual NSBEvent* dup() const override { return new NSBEvent(*this); }
+    /** @brief Gets the fetched message. */
+    const nsb::MessageEntry& getEntry() const { return entry; }
+};
+
+/**
+ * @brief Scheduler that multiplexes NSB client sockets into the event loop.
+ *
+ * Modeled on OMNeT++'s cSocketRTScheduler: while waiting for the next event,
+ * the scheduler waits on the RECV (and DGRAM) sockets of every registered
+ * NSBSimClient with _select_. Whenever a FORWARD (PUSH mode) or FETCH response
+ * (PULL mode) carrying a message arrives, it is inserted into the future
+ * event set as an NSBEvent for the registering module, so modules never block
+ * on the daemon and do not need polling timers.
+ *
+ * In PULL mode, the scheduler sends each client's FETCH request itself and
+ * paces the next one with an nsb::AdaptivePoller driven by the daemon's
+ * polling hints, measured in wall-clock time.
+ *
+ * With `nsbscheduler-realtime = true` (the default), simulation time is
+ * synchronized to wall-clock time and messages are injected at the simulation
+ * time corresponding to their arrival. Otherwise, the simulation runs as fast
+ * as possible, messages are injected at the current simulation time, and the
+ * scheduler only waits for NSB when there are no other events.
+ *
+ * @code
+ * [General]
+ * scheduler-class = "NSBScheduler"
+ * @endcode
+ */
+class NSBScheduler : public cScheduler
+{
+  protected:
+    struct Registration {
+        cModule* module;
+        nsb::NSBSimClient* client;
+        nsb::AdaptivePoller poller;
+        // Whether a FETCH request is waiting for its response.
+        bool awaiting;
+        // Wall-clock time (us) at which to send the next FETCH request.
+        int64_t nextPoll;
+    };
+    std::vector<Registration> registrations;
+    bool realtime = true;
+    int64_t baseTime = 0;
+
+    static int64_t currentTime();
+    virtual bool receiveWithTimeout(int64_t usec);
+    virtual int receiveUntil(int64_t targetTime);
+    virtual void inject(Registration& registration, const nsb::MessageEntry& entry);
+
+  public:
+    NSBScheduler() {}
+    virtual ~NSBScheduler() {}
+
+    virtual std::string str() const override;
+
+    /**
+     * @brief Registers a simulator client to be waited on.
+     *
+     * Messages arriving for the client are delivered to _module_ as NSBEvents.
+     *
+     * @param module The module to deliver the client's messages to.
+     * @param client The client, which must outlive its registration.
+     */
+    void registerClient(cModule* module, nsb::NSBSimClient* client);
+    /** @brief Stops waiting on the clients registered by a module. */
+    void unregisterClient(cModule* module);
+
+    virtual void startRun() override;
+    virtual void endRun() override;
+    virtual void executionResumed() override;
+
+    virtual cEvent* guessNextEvent() override;
+    virtual cEvent* takeNextEvent() override;
+    virtual void putBackEvent(cEvent* event) override;
+};
+
+#endif
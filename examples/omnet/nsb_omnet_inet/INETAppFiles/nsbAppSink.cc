@@ -5,6 +5,7 @@
 //
 
 #include "nsbAppSink.h"
+#include "nsbChunks.h"
 
 #include "inet/applications/base/ApplicationPacket_m.h"
 #include "inet/common/ModuleAccess.h"
@@ -176,29 +177,17 @@ void nsbAppSink::processPacket(Packet *pk)
     EV_INFO << "[RECV] Received packet: " << pk->getName()
             << ", total length: " << pk->getByteLength() << "\n";
 
-    const auto& payload = pk->peekData<BytesChunk>();
-    std::vector<uint8_t> vec = payload->getBytes();
-
-    std::istringstream stream(std::string(vec.begin(), vec.end()));
-
-    // Parse: [len1][srcId][len2][destId][payload]
-    uint16_t lenSrc, lenDest;
-    stream.read(reinterpret_cast<char*>(&lenSrc), sizeof(lenSrc));
-    std::string srcId(lenSrc, '\0');
-    stream.read(&srcId[0], lenSrc);
-
-    stream.read(reinterpret_cast<char*>(&lenDest), sizeof(lenDest));
-    std::string destId(lenDest, '\0');
-    stream.read(&destId[0], lenDest);
-
-    std::string payloadStr((std::istreambuf_iterator<char>(stream)),
-                            std::istreambuf_iterator<char>());
+    // Parse: [len1][srcId][len2][destId][payload], without copying the payload.
+    const auto& header = pk->popAtFront<NsbHeader>();
+    const auto& payload = pk->peekData<NsbPayloadChunk>();
+    const std::string& srcId = header->getSrcId();
+    const std::string& destId = header->getDestId();
 
     EV_INFO << "[RECV] src = " << srcId << ", dest = " << destId
-            << ", payload size = " << payloadStr.size() << "\n";
+            << ", payload size = " << payload->getPayload().size() << "\n";
 
     // Post to NSB Daemon
-    simClient->post(srcId, destId, payloadStr);
+    simClient->post(srcId, destId, payload->getPayload());
 
     delete pk;
     numReceived++;
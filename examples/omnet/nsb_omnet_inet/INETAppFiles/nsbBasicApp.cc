@@ -8,11 +8,11 @@
 
 //#include "inet/applications/udpapp/nsbBasicApp.h"
 
-#include <sstream>
 #include<arpa/inet.h>
 #include<fstream>
 
 #include "nsbBasicApp.h"
+#include "nsbChunks.h"
 
 #include "inet/applications/base/ApplicationPacket_m.h"
 #include "inet/common/ModuleAccess.h"
@@ -147,41 +147,20 @@ L3Address nsbBasicApp::chooseDestAddr()
 //this is going to fetch a message from the NSBdaemon and then send it through our INET network 
 void nsbBasicApp::sendPacket()
 {
-    std::ostringstream str;
-
     //using the fetch function to get a message from the NSB daemon
     nsb::MessageEntry FetchedMessage = simClient->fetch();
 
     //check using the expected function
     if(FetchedMessage.exists()){
-        std::string srcId = FetchedMessage.source;
         std::string destId = FetchedMessage.destination;
-        std::string payload = FetchedMessage.payload_obj;
-
-
-        EV_INFO << "[SEND] Preparing to send payload  " << payload << " to dest = " << destId << "\n";
-
-
-
-        // Serialize manually: [len1][srcId][len2][destId][payload]
-        std::ostringstream buffer;
-        uint16_t lenSrc = srcId.size();
-        uint16_t lenDest = destId.size();
 
-        buffer.write(reinterpret_cast<const char*>(&lenSrc), sizeof(lenSrc));
-        buffer.write(srcId.data(), lenSrc);
-        buffer.write(reinterpret_cast<const char*>(&lenDest), sizeof(lenDest));
-        buffer.write(destId.data(), lenDest);
-        buffer.write(payload.data(), payload.size());
+        EV_INFO << "[SEND] Preparing to send " << FetchedMessage.payload_obj.size() << " byte payload to dest = " << destId << "\n";
 
-        std::string raw = buffer.str();
+        // Header carries [len1][srcId][len2][destId]; the payload is moved, not copied.
+        Packet* packet = makeNsbPacket(packetName, std::move(FetchedMessage));
 
-        //converting now this raw string buffer to INET BytesChunk
-        auto rawBytesData = makeShared<BytesChunk>();
-        std::vector<uint8_t> vec(raw.begin(), raw.end());
-        rawBytesData->setBytes(vec);
-
-        Packet* packet = new Packet(packetName, rawBytesData);
+        if (dontFragment)
+            packet->addTag<FragmentationReq>()->setDontFragment(true);
 
         // Send to destination resolved from destId
         emit(packetSentSignal, packet);
@@ -189,9 +168,6 @@ void nsbBasicApp::sendPacket()
 
         numSent++;
         //bytesSent += payload.length();
-
-        if (dontFragment)
-            packet->addTag<FragmentationReq>()->setDontFragment(true);
     }
 
     else {
@@ -0,0 +1,73 @@
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+
+#include "nsbChunks.h"
+
+#include "inet/common/packet/serializer/ChunkSerializerRegistry.h"
+#include "inet/common/packet/serializer/FieldsChunkSerializer.h"
+
+namespace inet {
+
+Register_Class(NsbHeader);
+Register_Class(NsbPayloadChunk);
+
+/**
+ * Converts between NsbHeader and its [len1][srcId][len2][destId] encoding.
+ */
+class INET_API NsbHeaderSerializer : public FieldsChunkSerializer
+{
+  protected:
+    virtual void serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const override
+    {
+        const auto& header = staticPtrCast<const NsbHeader>(chunk);
+        for (const std::string *id : {&header->getSrcId(), &header->getDestId()}) {
+            stream.writeUint16Le(id->size());
+            stream.writeBytes(reinterpret_cast<const uint8_t *>(id->data()), B(id->size()));
+        }
+    }
+
+    virtual const Ptr<Chunk> deserialize(MemoryInputStream& stream) const override
+    {
+        std::string ids[2];
+        for (std::string& id : ids) {
+            id.resize(stream.readUint16Le());
+            stream.readBytes(reinterpret_cast<uint8_t *>(id.data()), B(id.size()));
+        }
+        return makeShared<NsbHeader>(ids[0], ids[1]);
+    }
+};
+
+/**
+ * Converts between NsbPayloadChunk and the raw payload bytes.
+ */
+class INET_API NsbPayloadChunkSerializer : public FieldsChunkSerializer
+{
+  protected:
+    virtual void serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const override
+    {
+        const std::string& payload = staticPtrCast<const NsbPayloadChunk>(chunk)->getPayload();
+        stream.writeBytes(reinterpret_cast<const uint8_t *>(payload.data()), B(payload.size()));
+    }
+
+    virtual const Ptr<Chunk> deserialize(MemoryInputStream& stream) const override
+    {
+        B length = stream.getRemainingLength();
+        std::string payload(length.get(), '\0');
+        stream.readBytes(reinterpret_cast<uint8_t *>(payload.data()), length);
+        return makeShared<NsbPayloadChunk>(std::move(payload));
+    }
+};
+
+Register_Serializer(NsbHeader, NsbHeaderSerializer);
+Register_Serializer(NsbPayloadChunk, NsbPayloadChunkSerializer);
+
+Packet *makeNsbPacket(const char *name, nsb::MessageEntry&& entry)
+{
+    Packet *packet = new Packet(name);
+    packet->insertAtBack(makeShared<NsbHeader>(entry.source, entry.destination));
+    packet->insertAtBack(makeShared<NsbPayloadChunk>(std::move(entry.payload_obj)));
+    return packet;
+}
+
+} // namespace inet
@@ -0,0 +1,84 @@
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+
+#ifndef __INET_NSBCHUNKS_H
+#define __INET_NSBCHUNKS_H
+
+#include <memory>
+#include <string>
+
+#include "inet/common/packet/Packet.h"
+#include "inet/common/packet/chunk/FieldsChunk.h"
+#include "nsb_client.h" //new for supporting the nsb_socket development
+
+namespace inet {
+
+/**
+ * Header carrying the NSB source and destination identifiers of a payload.
+ *
+ * On the wire (see NsbHeaderSerializer), it is encoded as
+ * [len1][srcId][len2][destId] with 16-bit little-endian lengths, which is the
+ * layout nsbBasicApp and nsbAppSink used before these chunks existed, so the
+ * simulated packet lengths are unchanged.
+ */
+class INET_API NsbHeader : public FieldsChunk
+{
+  protected:
+    std::string srcId;
+    std::string destId;
+
+    void updateChunkLength() { setChunkLength(B(2 + srcId.size() + 2 + destId.size())); }
+
+  public:
+    NsbHeader() { updateChunkLength(); }
+    NsbHeader(const std::string& srcId, const std::string& destId) : srcId(srcId), destId(destId) { updateChunkLength(); }
+    NsbHeader(const NsbHeader& other) = default;
+    virtual NsbHeader *dup() const override { return new NsbHeader(*this); }
+
+    const std::string& getSrcId() const { return srcId; }
+    const std::string& getDestId() const { return destId; }
+    void setSrcId(const std::string& id) { handleChange(); srcId = id; updateChunkLength(); }
+    void setDestId(const std::string& id) { handleChange(); destId = id; updateChunkLength(); }
+};
+
+/**
+ * Chunk carrying an NSB payload without copying it.
+ *
+ * The payload fetched from NSB is moved into a shared, immutable buffer, so
+ * building the packet and duplicating, slicing, or reassembling the chunk as
+ * it travels through the network never copies the payload bytes. The bytes
+ * are only copied when something actually needs them in serialized form, such
+ * as emulation interfaces or PCAP recording (see NsbPayloadChunkSerializer).
+ */
+class INET_API NsbPayloadChunk : public FieldsChunk
+{
+  protected:
+    std::shared_ptr<const std::string> data;
+
+  public:
+    NsbPayloadChunk() : data(std::make_shared<const std::string>()) { setChunkLength(B(0)); }
+    explicit NsbPayloadChunk(std::string&& payload) { setPayload(std::move(payload)); }
+    NsbPayloadChunk(const NsbPayloadChunk& other) = default;
+    virtual NsbPayloadChunk *dup() const override { return new NsbPayloadChunk(*this); }
+
+    /** Gets the payload, which stays valid as long as any copy of the chunk. */
+    const std::string& getPayload() const { return *data; }
+    /** Takes ownership of the payload without copying it. */
+    void setPayload(std::string&& payload)
+    {
+        handleChange();
+        data = std::make_shared<const std::string>(std::move(payload));
+        setChunkLength(B(data->size()));
+    }
+};
+
+/**
+ * Builds a packet carrying a fetched NSB message as an NsbHeader followed by
+ * an NsbPayloadChunk. The entry's payload is moved into the packet.
+ */
+INET_API Packet *makeNsbPacket(const char *name, nsb::MessageEntry&& entry);
+
+} // namespace inet
+
+#endif